@@ -0,0 +1,305 @@
+#ifndef PROJECT_BASE_BENCHMARK_HARNESS_H
+#define PROJECT_BASE_BENCHMARK_HARNESS_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Minimal micro-benchmark harness with the shape of Google Benchmark, so the suite needs nothing
+// beyond the engine's own dependencies:
+//
+//     void BM_Something(rg::bench::State &state) {
+//         Setup setup;                 // not timed
+//         for (auto _ : state) {       // timed, runs state.iterations() times
+//             rg::bench::doNotOptimize(work(setup));
+//         }
+//         state.setItemsProcessed(state.iterations() * itemsPerIteration);
+//     }
+//     RG_BENCHMARK(BM_Something);
+//
+// Every benchmark is calibrated until one repetition runs for at least --min-time seconds, then
+// repeated --repetitions times; the median time per iteration is reported together with the
+// coefficient of variation, so noisy results are visible instead of silently averaged away.
+namespace rg {
+namespace bench {
+
+template<typename T>
+inline void doNotOptimize(T const &value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+inline void clobberMemory() {
+    asm volatile("" : : : "memory");
+}
+
+class State {
+public:
+    explicit State(std::uint64_t iterations) : m_Iterations(iterations) {
+    }
+
+    struct Iterator {
+        std::uint64_t remaining;
+        State *state;
+
+        bool operator!=(const Iterator &) {
+            if (remaining == 0) {
+                state->stopTimer();
+                return false;
+            }
+            return true;
+        }
+
+        void operator++() {
+            --remaining;
+        }
+
+        int operator*() const {
+            return 0;
+        }
+    };
+
+    // the timer starts when the loop starts, setup before it is not measured
+    Iterator begin() {
+        startTimer();
+        return Iterator{m_Iterations, this};
+    }
+
+    Iterator end() {
+        return Iterator{0, this};
+    }
+
+    std::uint64_t iterations() const {
+        return m_Iterations;
+    }
+
+    // excludes per-iteration setup from the measurement
+    void pauseTiming() {
+        stopTimer();
+    }
+
+    void resumeTiming() {
+        startTimer();
+    }
+
+    void setItemsProcessed(std::uint64_t items) {
+        m_Items = items;
+    }
+
+    void setBytesProcessed(std::uint64_t bytes) {
+        m_Bytes = bytes;
+    }
+
+    void skipWithError(const std::string &message) {
+        m_Error = message;
+        m_Iterations = 0;
+    }
+
+    double seconds() const {
+        return m_Elapsed;
+    }
+
+    std::uint64_t items() const {
+        return m_Items;
+    }
+
+    std::uint64_t bytes() const {
+        return m_Bytes;
+    }
+
+    const std::string &error() const {
+        return m_Error;
+    }
+
+private:
+    void startTimer() {
+        m_Start = std::chrono::steady_clock::now();
+        m_Running = true;
+    }
+
+    void stopTimer() {
+        if (m_Running) {
+            m_Elapsed += std::chrono::duration<double>(std::chrono::steady_clock::now() - m_Start).count();
+            m_Running = false;
+        }
+    }
+
+    std::uint64_t m_Iterations;
+    std::uint64_t m_Items = 0;
+    std::uint64_t m_Bytes = 0;
+    std::chrono::steady_clock::time_point m_Start;
+    double m_Elapsed = 0.0;
+    bool m_Running = false;
+    std::string m_Error;
+};
+
+struct Benchmark {
+    std::string name;
+    std::function<void(State &)> function;
+};
+
+inline std::vector<Benchmark> &registry() {
+    static std::vector<Benchmark> benchmarks;
+    return benchmarks;
+}
+
+inline bool registerBenchmark(const std::string &name, std::function<void(State &)> function) {
+    registry().push_back({name, std::move(function)});
+    return true;
+}
+
+struct Options {
+    double minTime = 0.2;      // seconds per repetition
+    int repetitions = 5;
+    std::string filter;        // substring of the benchmark name
+    std::string json;          // optional machine readable output
+};
+
+struct Result {
+    std::string name;
+    std::uint64_t iterations = 0;
+    double nsPerIteration = 0.0; // median over the repetitions
+    double cv = 0.0;             // standard deviation / mean of the repetitions
+    double itemsPerSecond = 0.0;
+    double bytesPerSecond = 0.0;
+    std::string error;
+};
+
+inline Result runBenchmark(const Benchmark &benchmark, const Options &options) {
+    Result result;
+    result.name = benchmark.name;
+
+    // calibrate: grow the iteration count until one run is long enough to time reliably,
+    // the last calibration run doubles as the warm up
+    std::uint64_t iterations = 1;
+    while (true) {
+        State state(iterations);
+        benchmark.function(state);
+        if (!state.error().empty()) {
+            result.error = state.error();
+            return result;
+        }
+        if (state.seconds() >= options.minTime || iterations >= (1ull << 40)) {
+            break;
+        }
+        double scale = state.seconds() > 0.0 ? options.minTime * 1.4 / state.seconds() : 10.0;
+        iterations = std::max(iterations + 1, (std::uint64_t) (iterations * std::min(scale, 10.0)));
+    }
+
+    std::vector<double> times;
+    double items = 0.0, bytes = 0.0, seconds = 0.0;
+    for (int repetition = 0; repetition < options.repetitions; ++repetition) {
+        State state(iterations);
+        benchmark.function(state);
+        times.push_back(state.seconds() * 1.0e9 / iterations);
+        items += state.items();
+        bytes += state.bytes();
+        seconds += state.seconds();
+    }
+
+    double mean = 0.0;
+    for (double time : times) {
+        mean += time;
+    }
+    mean /= times.size();
+    double variance = 0.0;
+    for (double time : times) {
+        variance += (time - mean) * (time - mean);
+    }
+    variance /= times.size();
+
+    std::vector<double> sorted = times;
+    std::sort(sorted.begin(), sorted.end());
+    result.iterations = iterations;
+    result.nsPerIteration = sorted[sorted.size() / 2];
+    result.cv = mean > 0.0 ? std::sqrt(variance) / mean : 0.0;
+    result.itemsPerSecond = seconds > 0.0 ? items / seconds : 0.0;
+    result.bytesPerSecond = seconds > 0.0 ? bytes / seconds : 0.0;
+    return result;
+}
+
+inline void writeJson(const std::string &path, const std::vector<Result> &results) {
+    std::ofstream out(path);
+    out << "{\n  \"benchmarks\": [\n" << std::fixed << std::setprecision(3);
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result &result = results[i];
+        out << "    {\"name\": \"" << result.name << "\"";
+        if (result.error.empty()) {
+            out << ", \"iterations\": " << result.iterations
+                << ", \"ns_per_iteration\": " << result.nsPerIteration
+                << ", \"cv\": " << result.cv
+                << ", \"items_per_second\": " << result.itemsPerSecond
+                << ", \"bytes_per_second\": " << result.bytesPerSecond;
+        } else {
+            out << ", \"error\": \"" << result.error << "\"";
+        }
+        out << "}" << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n}" << std::endl;
+}
+
+inline bool parseOptions(int argc, char **argv, Options &options) {
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--min-time") == 0 && hasValue) {
+            options.minTime = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--repetitions") == 0 && hasValue) {
+            options.repetitions = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--filter") == 0 && hasValue) {
+            options.filter = argv[++i];
+        } else if (std::strcmp(argv[i], "--json") == 0 && hasValue) {
+            options.json = argv[++i];
+        } else {
+            return false;
+        }
+    }
+    return options.minTime > 0.0 && options.repetitions > 0;
+}
+
+inline int runAll(int argc, char **argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::cout << "Usage: " << argv[0] << " [--filter substring] [--min-time seconds] [--repetitions N]"
+                  << " [--json file]" << std::endl;
+        return -1;
+    }
+
+    std::vector<Result> results;
+    std::printf("%-48s %14s %8s %12s %14s\n", "benchmark", "ns/iter", "cv", "iterations", "items/s");
+    for (const Benchmark &benchmark : registry()) {
+        if (benchmark.name.find(options.filter) == std::string::npos) {
+            continue;
+        }
+        Result result = runBenchmark(benchmark, options);
+        if (result.error.empty()) {
+            std::printf("%-48s %14.1f %7.1f%% %12llu %14.4g\n", result.name.c_str(), result.nsPerIteration,
+                        result.cv * 100.0, (unsigned long long) result.iterations, result.itemsPerSecond);
+        } else {
+            std::printf("%-48s skipped: %s\n", result.name.c_str(), result.error.c_str());
+        }
+        std::fflush(stdout);
+        results.push_back(result);
+    }
+    if (!options.json.empty()) {
+        writeJson(options.json, results);
+    }
+    return 0;
+}
+
+};
+};
+
+// registers a function void(rg::bench::State &)
+#define RG_BENCHMARK(function) \
+    static bool registered_##function = rg::bench::registerBenchmark(#function, function)
+
+#endif //PROJECT_BASE_BENCHMARK_HARNESS_H
@@ -0,0 +1,365 @@
+// CPU-side hot paths of the engine, timed without a GL context. Run from anywhere:
+//     ./micro_benchmarks [--filter Decode] [--min-time 0.5] [--repetitions 10] [--json micro.json]
+// Resources are found through FileSystem like the main executable; missing files are reported as skipped.
+// Where EGL is available the BM_VertexShader benchmarks also draw in a headless context, with
+// LIBGL_ALWAYS_SOFTWARE=1 that is llvmpipe, which runs the vertex shaders on the CPU as well.
+
+#include "harness.h"
+
+#include <learnopengl/filesystem.h>
+#include <learnopengl/camera.h>
+#include <learnopengl/model.h>
+#include <rg/ProgramState.h>
+#include <rg/Rain.h>
+#ifdef RG_HEADLESS_EGL
+#include <rg/HeadlessContext.h>
+#endif
+
+#include <cstdio>
+
+namespace {
+
+const char *const Models[] = {
+        "resources/objects/airplane/piper_pa18.obj",
+        "resources/objects/OldBoat/OldBoat.obj",
+        "resources/objects/SmallTropicalIsland/Small_Tropical_Island.obj",
+        "resources/objects/Street_lamp_7_OBJ/Street_Lamp_7.obj",
+        "resources/objects/WoodenTable/Table.obj",
+        "resources/objects/WoodenTable/Chair.obj",
+        "resources/objects/light/Light.obj",
+        "resources/objects/apple/apple.obj",
+};
+
+const char *const Textures[] = {
+        "resources/textures/rain.png",
+        "resources/textures/lighting.png",
+        "resources/textures/floor/wood_0041_color_2k.jpg",
+        "resources/textures/floor/wood_0041_normal_opengl_2k.png",
+        "resources/textures/floor/wood_0041_height_2k.png",
+        "resources/textures/skyboxRain/px.jpg",
+        "resources/objects/OldBoat/boattex.jpg",
+        "resources/objects/SmallTropicalIsland/isld1.jpg",
+};
+
+std::string fileName(const std::string &path) {
+    return path.substr(path.find_last_of('/') + 1);
+}
+
+std::vector<unsigned char> readFile(const std::string &path) {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    std::vector<unsigned char> bytes;
+    if (in) {
+        bytes.resize((size_t) in.tellg());
+        in.seekg(0);
+        in.read((char *) bytes.data(), bytes.size());
+    }
+    return bytes;
+}
+
+// ReadFile plus the post-process steps, exactly what Model does before it touches GL
+void BM_AssimpImport(rg::bench::State &state, const char *path) {
+    std::string fullPath = FileSystem::getPath(path);
+    for (auto _ : state) {
+        Assimp::Importer importer;
+        const aiScene *scene = Model::ImportScene(importer, fullPath);
+        if (!scene) {
+            state.skipWithError("cannot import " + fullPath);
+            return;
+        }
+        rg::bench::doNotOptimize(scene);
+    }
+}
+
+// assimp mesh -> Vertex / index arrays, per model
+void BM_ProcessMesh(rg::bench::State &state, const char *path) {
+    std::string fullPath = FileSystem::getPath(path);
+    Assimp::Importer importer;
+    const aiScene *scene = Model::ImportScene(importer, fullPath);
+    if (!scene) {
+        state.skipWithError("cannot import " + fullPath);
+        return;
+    }
+    std::uint64_t vertexCount = 0;
+    for (unsigned int i = 0; i < scene->mNumMeshes; i++) {
+        vertexCount += scene->mMeshes[i]->mNumVertices;
+    }
+    for (auto _ : state) {
+        for (unsigned int i = 0; i < scene->mNumMeshes; i++) {
+            vector<Vertex> vertices;
+            vector<unsigned int> indices;
+            Model::ConvertMesh(scene->mMeshes[i], vertices, indices);
+            rg::bench::doNotOptimize(vertices.data());
+            rg::bench::doNotOptimize(indices.data());
+        }
+    }
+    state.setItemsProcessed(state.iterations() * vertexCount);
+    state.setBytesProcessed(state.iterations() * vertexCount * sizeof(Vertex));
+}
+
+// image decode from memory, the file read is not part of the measurement
+void BM_ImageDecode(rg::bench::State &state, const char *path) {
+    std::string fullPath = FileSystem::getPath(path);
+    std::vector<unsigned char> file = readFile(fullPath);
+    if (file.empty()) {
+        state.skipWithError("cannot read " + fullPath);
+        return;
+    }
+    int width = 0, height = 0, channels = 0;
+    for (auto _ : state) {
+        unsigned char *data = stbi_load_from_memory(file.data(), (int) file.size(), &width, &height, &channels, 0);
+        rg::bench::doNotOptimize(data);
+        stbi_image_free(data);
+    }
+    state.setItemsProcessed(state.iterations() * width * height);
+    state.setBytesProcessed(state.iterations() * file.size());
+}
+
+// one simulation step and one frame of matrices of the 30000 drop rain field
+void BM_RainUpdate(rg::bench::State &state) {
+    srand(1);
+    rg::Rain rain;
+    rain.spawn(30000);
+    for (auto _ : state) {
+        rain.fall(0.1f);
+        rain.buildModels(1.5f, 0.05f);
+        rg::bench::doNotOptimize(rain.models.data());
+        rg::bench::clobberMemory();
+    }
+    state.setItemsProcessed(state.iterations() * rain.positions.size());
+}
+
+void BM_CameraViewMatrix(rg::bench::State &state) {
+    Camera camera(glm::vec3(0.0f, 5.0f, 10.0f));
+    for (auto _ : state) {
+        glm::mat4 view = camera.GetViewMatrix();
+        rg::bench::doNotOptimize(view);
+        camera.Position.x += 0.001f;
+    }
+}
+
+// ProcessMouseMovement is the public way into updateCameraVectors
+void BM_CameraUpdateVectors(rg::bench::State &state) {
+    Camera camera(glm::vec3(0.0f, 5.0f, 10.0f));
+    float offset = 1.0f;
+    for (auto _ : state) {
+        camera.ProcessMouseMovement(offset, 0.5f * offset);
+        offset = -offset;
+        rg::bench::doNotOptimize(camera.Front);
+    }
+}
+
+void BM_ProgramStateSave(rg::bench::State &state) {
+    ProgramState programState;
+    std::string path = "micro_benchmarks_program_state.txt";
+    for (auto _ : state) {
+        programState.SaveToFile(path);
+    }
+    std::remove(path.c_str());
+}
+
+void BM_ProgramStateLoad(rg::bench::State &state) {
+    std::string path = "micro_benchmarks_program_state.txt";
+    ProgramState().SaveToFile(path);
+    ProgramState programState;
+    for (auto _ : state) {
+        programState.LoadFromFile(path);
+        rg::bench::doNotOptimize(programState.camera.Position);
+    }
+    std::remove(path.c_str());
+}
+
+#ifdef RG_HEADLESS_EGL
+// A 512 x 512 vertex grid in the Vertex layout of Mesh, drawn with model.vs and GL_RASTERIZER_DISCARD,
+// so the time is spent fetching and shading vertices and none on triangle setup or fragments.
+class VertexShaderScene {
+public:
+    static const unsigned int GridSize = 512;
+
+    // the shared context and grid, nullptr (with error()) when there is no GL
+    static VertexShaderScene *get(std::string &error) {
+        static VertexShaderScene scene;
+        error = scene.m_Error;
+        return scene.m_Error.empty() ? &scene : nullptr;
+    }
+
+    // model.vs as it is, or with the normal matrix computed per vertex as before it became a uniform
+    unsigned int program(bool normalMatrixInShader, std::string &error) {
+        std::string source;
+        rg::ShaderPreprocessor preprocessor;
+        if (!preprocessor.process(FileSystem::getPath("resources/shaders/model.vs"), source)) {
+            error = preprocessor.error();
+            return 0;
+        }
+        if (normalMatrixInShader) {
+            std::string uniform = "uniform mat3 normalMatrix;";
+            std::string main = "void main()\n{\n";
+            if (source.find(uniform) == std::string::npos || source.find(main) == std::string::npos) {
+                error = "model.vs doesn't declare the normalMatrix uniform";
+                return 0;
+            }
+            source.replace(source.find(uniform), uniform.size(), "");
+            source.insert(source.find(main) + main.size(), "    mat3 normalMatrix = transpose(inverse(mat3(model)));\n");
+        }
+        // reads every output of model.vs, so none of the per-vertex work is optimized away
+        const char *fragment = "#version 330 core\n"
+                               "in vec2 TexCoords; in vec3 FragPos; in vec3 TangentLightPos; in vec3 TangentFragPos;\n"
+                               "in vec3 TangentViewPos; out vec4 FragColor;\n"
+                               "void main() { FragColor = vec4(TangentLightPos + TangentFragPos + TangentViewPos + FragPos"
+                               " + TexCoords.xyx, 1.0); }\n";
+        unsigned int program = glCreateProgram();
+        const char *vertex = source.c_str();
+        for (unsigned int i = 0; i < 2; i++) {
+            unsigned int shader = glCreateShader(i == 0 ? GL_VERTEX_SHADER : GL_FRAGMENT_SHADER);
+            glShaderSource(shader, 1, i == 0 ? &vertex : &fragment, NULL);
+            glCompileShader(shader);
+            glAttachShader(program, shader);
+            glDeleteShader(shader);
+        }
+        glLinkProgram(program);
+        int success = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success) {
+            char log[1024];
+            glGetProgramInfoLog(program, sizeof(log), NULL, log);
+            error = std::string("model.vs doesn't link: ") + log;
+            glDeleteProgram(program);
+            return 0;
+        }
+        return program;
+    }
+
+    void draw() {
+        glDrawElements(GL_TRIANGLES, m_IndexCount, GL_UNSIGNED_INT, 0);
+        glFinish();
+    }
+
+    unsigned int vertexCount() const {
+        return GridSize * GridSize;
+    }
+
+private:
+    VertexShaderScene() {
+        if (!m_Context.create()) {
+            m_Error = "no headless GL context";
+            return;
+        }
+        gladLoadGLLoader((GLADloadproc) rg::HeadlessContext::getProcAddress);
+
+        vector<Vertex> vertices(GridSize * GridSize);
+        for (unsigned int y = 0; y < GridSize; y++) {
+            for (unsigned int x = 0; x < GridSize; x++) {
+                Vertex &vertex = vertices[y * GridSize + x];
+                vertex = Vertex();
+                vertex.Position = glm::vec3((float) x / GridSize - 0.5f, (float) y / GridSize - 0.5f, 0.0f);
+                vertex.TexCoords = glm::vec2((float) x / GridSize, (float) y / GridSize);
+                rg::packTangentFrame(glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f),
+                                     vertex.TangentFrame);
+            }
+        }
+        vector<unsigned int> indices;
+        for (unsigned int y = 0; y + 1 < GridSize; y++) {
+            for (unsigned int x = 0; x + 1 < GridSize; x++) {
+                unsigned int corner = y * GridSize + x;
+                indices.insert(indices.end(), {corner, corner + 1, corner + GridSize,
+                                               corner + 1, corner + GridSize + 1, corner + GridSize});
+            }
+        }
+        m_IndexCount = indices.size();
+
+        unsigned int vao, vbo, ebo;
+        glGenVertexArrays(1, &vao);
+        glGenBuffers(1, &vbo);
+        glGenBuffers(1, &ebo);
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *) offsetof(Vertex, Position));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 4, GL_SHORT, GL_TRUE, sizeof(Vertex), (void *) offsetof(Vertex, TangentFrame));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void *) offsetof(Vertex, TexCoords));
+
+        // the draws still need a complete framebuffer, the context has no default one
+        unsigned int framebuffer, color;
+        glGenFramebuffers(1, &framebuffer);
+        glGenRenderbuffers(1, &color);
+        glBindRenderbuffer(GL_RENDERBUFFER, color);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, 64, 64);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+        glViewport(0, 0, 64, 64);
+        glEnable(GL_RASTERIZER_DISCARD);
+    }
+
+    rg::HeadlessContext m_Context;
+    std::string m_Error;
+    size_t m_IndexCount = 0;
+};
+
+// one draw of the grid with a rotated, non-uniformly scaled model matrix, like the lamp and island
+void BM_VertexShader(rg::bench::State &state, bool normalMatrixInShader) {
+    std::string error;
+    VertexShaderScene *scene = VertexShaderScene::get(error);
+    unsigned int program = scene ? scene->program(normalMatrixInShader, error) : 0;
+    if (!program) {
+        state.skipWithError(error);
+        return;
+    }
+    glm::mat4 model = glm::rotate(glm::mat4(1.0f), 0.3f, glm::vec3(0.0f, 1.0f, 0.2f));
+    model = glm::scale(model, glm::vec3(1.5f, 1.0f, 0.7f));
+    glUseProgram(program);
+    glUniformMatrix4fv(glGetUniformLocation(program, "model"), 1, GL_FALSE, glm::value_ptr(model));
+    glUniformMatrix4fv(glGetUniformLocation(program, "view"), 1, GL_FALSE, glm::value_ptr(glm::mat4(1.0f)));
+    glUniformMatrix4fv(glGetUniformLocation(program, "projection"), 1, GL_FALSE, glm::value_ptr(glm::mat4(1.0f)));
+    if (!normalMatrixInShader) {
+        glm::mat3 normal = rg::normalMatrix(model);
+        glUniformMatrix3fv(glGetUniformLocation(program, "normalMatrix"), 1, GL_FALSE, glm::value_ptr(normal));
+    }
+    scene->draw();
+    for (auto _ : state) {
+        scene->draw();
+    }
+    state.setItemsProcessed(state.iterations() * scene->vertexCount());
+    glDeleteProgram(program);
+}
+#endif
+
+bool registerAssetBenchmarks() {
+    for (const char *path : Models) {
+        rg::bench::registerBenchmark("BM_AssimpImport/" + fileName(path),
+                                     [path](rg::bench::State &state) { BM_AssimpImport(state, path); });
+    }
+    for (const char *path : Models) {
+        rg::bench::registerBenchmark("BM_ProcessMesh/" + fileName(path),
+                                     [path](rg::bench::State &state) { BM_ProcessMesh(state, path); });
+    }
+    for (const char *path : Textures) {
+        rg::bench::registerBenchmark("BM_ImageDecode/" + fileName(path),
+                                     [path](rg::bench::State &state) { BM_ImageDecode(state, path); });
+    }
+#ifdef RG_HEADLESS_EGL
+    rg::bench::registerBenchmark("BM_VertexShader/NormalMatrixPerVertex",
+                                 [](rg::bench::State &state) { BM_VertexShader(state, true); });
+    rg::bench::registerBenchmark("BM_VertexShader/NormalMatrixUniform",
+                                 [](rg::bench::State &state) { BM_VertexShader(state, false); });
+#endif
+    return true;
+}
+
+}
+
+static bool assetBenchmarks = registerAssetBenchmarks();
+RG_BENCHMARK(BM_RainUpdate);
+RG_BENCHMARK(BM_CameraViewMatrix);
+RG_BENCHMARK(BM_CameraUpdateVectors);
+RG_BENCHMARK(BM_ProgramStateSave);
+RG_BENCHMARK(BM_ProgramStateLoad);
+
+int main(int argc, char **argv) {
+    // the loaders record into the startup trace, which would only grow here
+    rg::startupTrace().finish();
+    return rg::bench::runAll(argc, argv);
+}
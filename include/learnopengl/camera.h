@@ -118,6 +118,15 @@ public:
             Zoom = 45.0f; 
     }
 
+    // turns the camera towards a point, keeping the position
+    void LookAt(glm::vec3 target)
+    {
+        glm::vec3 direction = glm::normalize(target - Position);
+        Yaw = glm::degrees(atan2(direction.z, direction.x));
+        Pitch = glm::degrees(asin(direction.y));
+        updateCameraVectors();
+    }
+
 private:
     // calculates the front vector from the Camera's (updated) Euler Angles
     void updateCameraVectors()
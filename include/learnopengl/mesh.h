@@ -7,7 +7,14 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <learnopengl/shader.h>
-
+#include <rg/CommandList.h>
+#include <rg/GLState.h>
+#include <rg/GpuMemory.h>
+#include <rg/InstanceBuffer.h>
+#include <rg/ShaderVariants.h>
+#include <rg/TangentFrame.h>
+
+#include <cstdint>
 #include <string>
 #include <vector>
 using namespace std;
@@ -15,14 +22,10 @@ using namespace std;
 struct Vertex {
     // position
     glm::vec3 Position;
-    // normal
-    glm::vec3 Normal;
     // texCoords
     glm::vec2 TexCoords;
-    // tangent
-    glm::vec3 Tangent;
-    // bitangent
-    glm::vec3 Bitangent;
+    // normal, tangent and bitangent handedness as a quaternion, see rg::packTangentFrame
+    std::int16_t TangentFrame[4];
 };
 
 
@@ -42,6 +45,10 @@ public:
 
     unsigned int VAO;
     std::string glslIdentifierPrefix;
+    // sampler uniform and texture per unit, built from textures and glslIdentifierPrefix
+    rg::Material material;
+    // rg::ShaderFeature bits of the maps in textures, selects the shader variant
+    unsigned int features = 0;
     // constructor
     Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
     {
@@ -51,52 +58,113 @@ public:
 
         // now that we have all the required data, set the vertex buffers and its attribute pointers.
         setupMesh();
+        setupMaterial();
+    }
+
+    void SetShaderTextureNamePrefix(std::string prefix)
+    {
+        glslIdentifierPrefix = prefix;
+        setupMaterial();
     }
 
     // render the mesh
     void Draw(Shader &shader)
     {
-        // bind appropriate textures
+        bindTextures(shader);
+
+        // draw mesh; the VAO and texture units are left bound, the state cache filters
+        // the rebinds when the next mesh or model uses the same ones
+        rg::glState().bindVertexArray(VAO);
+        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+    }
+
+    // render the mesh once per model matrix with a single draw call; the matrices are streamed
+    // into a per-instance vertex buffer that feeds attribute locations 5-11 (see model_instanced.vs)
+    void DrawInstanced(Shader &shader, const vector<glm::mat4> &models)
+    {
+        if (models.empty())
+            return;
+
+        bindTextures(shader);
+
+        rg::glState().bindVertexArray(VAO);
+        instances.upload(&models[0], models.size());
+        glDrawElementsInstanced(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0, models.size());
+    }
+
+    // same as Draw, but recorded into a command list instead of calling GL, so any thread can do it
+    void Record(rg::CommandList &list, const Shader &shader) const
+    {
+        list.bindMaterial(shader.ID, material);
+        list.bindVertexArray(VAO);
+        list.drawIndexed(indices.size());
+    }
+
+    // same as DrawInstanced; the instance buffer is written when the list is executed
+    void RecordInstanced(rg::CommandList &list, const Shader &shader, const vector<glm::mat4> &models)
+    {
+        if (models.empty())
+            return;
+
+        list.bindMaterial(shader.ID, material);
+        list.bindVertexArray(VAO);
+        list.drawIndexedInstanced(indices.size(), instances, &models[0], models.size());
+    }
+
+private:
+    // render data
+    unsigned int VBO, EBO;
+    rg::InstanceBuffer instances;
+
+    // binds every texture of the mesh to its own unit and points the matching sampler at it
+    void bindTextures(Shader &shader)
+    {
+        for(unsigned int i = 0; i < material.textures.size(); i++)
+        {
+            glUniform1i(glGetUniformLocation(shader.ID, material.samplers[i].c_str()), i);
+            // the unit is only activated if the binding changes
+            rg::glState().bindTexture(GL_TEXTURE_2D, i, material.textures[i]);
+        }
+    }
+
+    void setupMaterial()
+    {
+        material.samplers.clear();
+        material.textures.clear();
+        features = 0;
         unsigned int diffuseNr  = 1;
         unsigned int specularNr = 1;
         unsigned int normalNr   = 1;
         unsigned int heightNr   = 1;
         for(unsigned int i = 0; i < textures.size(); i++)
         {
-            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
             // retrieve texture number (the N in diffuse_textureN)
             string number;
             string name = textures[i].type;
             if(name == "texture_diffuse")
+            {
                 number = std::to_string(diffuseNr++);
+                features |= rg::FeatureDiffuseMap;
+            }
             else if(name == "texture_specular")
+            {
                 number = std::to_string(specularNr++); // transfer unsigned int to stream
+                features |= rg::FeatureSpecularMap;
+            }
             else if(name == "texture_normal")
+            {
                 number = std::to_string(normalNr++); // transfer unsigned int to stream
+                features |= rg::FeatureNormalMap;
+            }
             else if(name == "texture_height")
                 number = std::to_string(heightNr++); // transfer unsigned int to stream
 
-            // now set the sampler to the correct texture unit
-            glUniform1i(glGetUniformLocation(shader.ID, (glslIdentifierPrefix + name + number).c_str()), i);
-            // and finally bind the texture
-            glBindTexture(GL_TEXTURE_2D, textures[i].id);
+            // texture i goes to unit i, the sampler is named e.g. material.texture_diffuse1
+            material.samplers.push_back(glslIdentifierPrefix + name + number);
+            material.textures.push_back(textures[i].id);
         }
-
-
-
-        // draw mesh
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
-
-        // always good practice to set everything back to defaults once configured.
-        glActiveTexture(GL_TEXTURE0);
     }
 
-private:
-    // render data
-    unsigned int VBO, EBO;
-
     // initializes all the buffer objects/arrays
     void setupMesh()
     {
@@ -105,35 +173,31 @@ private:
         glGenBuffers(1, &VBO);
         glGenBuffers(1, &EBO);
 
-        glBindVertexArray(VAO);
+        rg::glState().bindVertexArray(VAO);
         // load data into vertex buffers
         glBindBuffer(GL_ARRAY_BUFFER, VBO);
         // A great thing about structs is that their memory layout is sequential for all its items.
         // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
         // again translates to 3/2 floats which translates to a byte array.
         glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+        rg::gpuMemory().track(rg::GpuMemory::Kind::Buffer, VBO, "mesh vertices", vertices.size() * sizeof(Vertex));
 
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
         glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+        rg::gpuMemory().track(rg::GpuMemory::Kind::Buffer, EBO, "mesh indices", indices.size() * sizeof(unsigned int));
 
         // set the vertex attribute pointers
         // vertex Positions
         glEnableVertexAttribArray(0);
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-        // vertex normals
+        // vertex tangent frames, snorm16 quaternions
         glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+        glVertexAttribPointer(1, 4, GL_SHORT, GL_TRUE, sizeof(Vertex), (void*)offsetof(Vertex, TangentFrame));
         // vertex texture coords
         glEnableVertexAttribArray(2);
         glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
-        // vertex tangent
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
-        // vertex bitangent
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
-
-        glBindVertexArray(0);
+
+        rg::glState().bindVertexArray(0);
     }
 };
 #endif
\ No newline at end of file
@@ -12,7 +12,10 @@
 
 #include <learnopengl/mesh.h>
 #include <learnopengl/shader.h>
+#include <rg/StartupTrace.h>
+#include <rg/GpuMemory.h>
 
+#include <algorithm>
 #include <string>
 #include <fstream>
 #include <sstream>
@@ -31,6 +34,8 @@ public:
     // model data
     vector<Texture> textures_loaded;	// stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
     vector<Mesh>    meshes;
+    // the distinct Mesh::features of the meshes, one shader variant each
+    vector<unsigned int> featureSets;
     string directory;
     bool gammaCorrection;
 
@@ -47,58 +52,79 @@ public:
             meshes[i].Draw(shader);
     }
 
-    void SetShaderTextureNamePrefix(std::string prefix) {
-        for (Mesh& mesh: meshes) {
-            mesh.glslIdentifierPrefix = prefix;
-        }
+    // draws every placement of the model in one instanced call per mesh
+    void DrawInstanced(Shader &shader, const vector<glm::mat4> &models)
+    {
+        for(unsigned int i = 0; i < meshes.size(); i++)
+            meshes[i].DrawInstanced(shader, models);
     }
-private:
-    // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
-    void loadModel(string const &path)
+
+    // Draw and DrawInstanced recorded into a command list, safe on any thread once loading is done
+    void Record(rg::CommandList &list, const Shader &shader) const
     {
-        // read file via ASSIMP
-        Assimp::Importer importer;
-        const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
-        // check for errors
-        if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
-        {
-            cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
-            return;
-        }
-        // retrieve the directory path of the filepath
-        directory = path.substr(0, path.find_last_of('/'));
+        for(unsigned int i = 0; i < meshes.size(); i++)
+            meshes[i].Record(list, shader);
+    }
 
-        // process ASSIMP's root node recursively
-        processNode(scene->mRootNode, scene);
+    void RecordInstanced(rg::CommandList &list, const Shader &shader, const vector<glm::mat4> &models)
+    {
+        for(unsigned int i = 0; i < meshes.size(); i++)
+            meshes[i].RecordInstanced(list, shader, models);
     }
 
-    // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
-    void processNode(aiNode *node, const aiScene *scene)
+    // the same for only the meshes with the given features (AllMeshes: every mesh), so each
+    // part can be drawn with the shader variant built for it
+    static const unsigned int AllMeshes = ~0u;
+
+    void DrawVariant(Shader &shader, unsigned int features)
     {
-        // process each mesh located at the current node
-        for(unsigned int i = 0; i < node->mNumMeshes; i++)
-        {
-            // the node object only contains indices to index the actual objects in the scene.
-            // the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
-            aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-            meshes.push_back(processMesh(mesh, scene));
-        }
-        // after we've processed all of the meshes (if any) we then recursively process each of the children nodes
-        for(unsigned int i = 0; i < node->mNumChildren; i++)
-        {
-            processNode(node->mChildren[i], scene);
-        }
+        for(unsigned int i = 0; i < meshes.size(); i++)
+            if(features == AllMeshes || meshes[i].features == features)
+                meshes[i].Draw(shader);
+    }
 
+    void DrawInstancedVariant(Shader &shader, unsigned int features, const vector<glm::mat4> &models)
+    {
+        for(unsigned int i = 0; i < meshes.size(); i++)
+            if(features == AllMeshes || meshes[i].features == features)
+                meshes[i].DrawInstanced(shader, models);
     }
 
-    Mesh processMesh(aiMesh *mesh, const aiScene *scene)
+    void RecordVariant(rg::CommandList &list, const Shader &shader, unsigned int features) const
     {
-        // data to fill
-        vector<Vertex> vertices;
-        vector<unsigned int> indices;
-        vector<Texture> textures;
+        for(unsigned int i = 0; i < meshes.size(); i++)
+            if(features == AllMeshes || meshes[i].features == features)
+                meshes[i].Record(list, shader);
+    }
+
+    void RecordInstancedVariant(rg::CommandList &list, const Shader &shader, unsigned int features,
+                                const vector<glm::mat4> &models)
+    {
+        for(unsigned int i = 0; i < meshes.size(); i++)
+            if(features == AllMeshes || meshes[i].features == features)
+                meshes[i].RecordInstanced(list, shader, models);
+    }
 
+    // texture of the first mesh, used to group draws that share a material
+    unsigned int MaterialId() const
+    {
+        for(const Mesh &mesh : meshes)
+            if(!mesh.textures.empty())
+                return mesh.textures[0].id;
+        return 0;
+    }
+
+    void SetShaderTextureNamePrefix(std::string prefix) {
+        for (Mesh& mesh: meshes) {
+            mesh.SetShaderTextureNamePrefix(prefix);
+        }
+    }
+
+    // converts the vertices and faces of an imported mesh to the layout the Mesh VAO expects, no GL involved
+    static void ConvertMesh(const aiMesh *mesh, vector<Vertex> &vertices, vector<unsigned int> &indices)
+    {
         // walk through each of the mesh's vertices
+        vertices.reserve(vertices.size() + mesh->mNumVertices);
         for(unsigned int i = 0; i < mesh->mNumVertices; i++)
         {
             Vertex vertex;
@@ -109,12 +135,10 @@ private:
             vector.z = mesh->mVertices[i].z;
             vertex.Position = vector;
             // normals
+            glm::vec3 normal(0.0f), tangent(0.0f), bitangent(0.0f);
             if (mesh->HasNormals())
             {
-                vector.x = mesh->mNormals[i].x;
-                vector.y = mesh->mNormals[i].y;
-                vector.z = mesh->mNormals[i].z;
-                vertex.Normal = vector;
+                normal = glm::vec3(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z);
             }
             // texture coordinates
             if(mesh->mTextureCoords[0]) // does the mesh contain texture coordinates?
@@ -125,19 +149,19 @@ private:
                 vec.x = mesh->mTextureCoords[0][i].x;
                 vec.y = mesh->mTextureCoords[0][i].y;
                 vertex.TexCoords = vec;
-                // tangent
-                vector.x = mesh->mTangents[i].x;
-                vector.y = mesh->mTangents[i].y;
-                vector.z = mesh->mTangents[i].z;
-                vertex.Tangent = vector;
-                // bitangent
-                vector.x = mesh->mBitangents[i].x;
-                vector.y = mesh->mBitangents[i].y;
-                vector.z = mesh->mBitangents[i].z;
-                vertex.Bitangent = vector;
             }
             else
                 vertex.TexCoords = glm::vec2(0.0f, 0.0f);
+            // tangent and bitangent, CalcTangentSpace only computes them for meshes with texture coordinates;
+            // it runs before FlipUVs (see ImportScene), so the bitangent's handedness is that of the texture
+            // as uploaded and only mirrored UVs pack -1
+            if (mesh->HasTangentsAndBitangents())
+            {
+                tangent = glm::vec3(mesh->mTangents[i].x, mesh->mTangents[i].y, mesh->mTangents[i].z);
+                bitangent = glm::vec3(mesh->mBitangents[i].x, mesh->mBitangents[i].y, mesh->mBitangents[i].z);
+            }
+            // the whole frame in 8 bytes; missing or degenerate vectors get a valid frame
+            rg::packTangentFrame(normal, tangent, bitangent, vertex.TangentFrame);
 
             vertices.push_back(vertex);
 
@@ -151,6 +175,92 @@ private:
             for(unsigned int j = 0; j < face.mNumIndices; j++)
                 indices.push_back(face.mIndices[j]);
         }
+    }
+
+    // reads a model file and runs the post-process steps the renderer needs (see loadModel), no GL involved
+    static const aiScene* ImportScene(Assimp::Importer &importer, string const &path)
+    {
+        const aiScene* scene;
+        {
+            rg::StartupScope read("import", path);
+            scene = importer.ReadFile(path, 0);
+            if(scene)
+                read.arg("meshes", scene->mNumMeshes);
+        }
+        // the steps run one by one so the startup trace can time each of them; FlipUVs comes last so
+        // CalcTangentSpace's bitangents follow the texture's V (textures are uploaded unflipped)
+        const std::pair<aiPostProcessSteps, const char*> steps[] = {
+            {aiProcess_Triangulate, "Triangulate"},
+            {aiProcess_GenSmoothNormals, "GenSmoothNormals"},
+            {aiProcess_CalcTangentSpace, "CalcTangentSpace"},
+            {aiProcess_FlipUVs, "FlipUVs"},
+        };
+        for(const auto &step : steps)
+        {
+            if(!scene)
+                break;
+            rg::StartupScope postProcess("postprocess", step.second);
+            scene = importer.ApplyPostProcessing(step.first);
+        }
+        return scene;
+    }
+
+private:
+    // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
+    void loadModel(string const &path)
+    {
+        rg::StartupScope trace("model", path);
+        rg::GpuMemoryOwner owner(path.substr(path.find_last_of('/') + 1));
+        // read file via ASSIMP
+        Assimp::Importer importer;
+        const aiScene* scene = ImportScene(importer, path);
+        // check for errors
+        if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
+        {
+            cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
+            return;
+        }
+        // retrieve the directory path of the filepath
+        directory = path.substr(0, path.find_last_of('/'));
+
+        // process ASSIMP's root node recursively
+        {
+            rg::StartupScope process("process", path);
+            processNode(scene->mRootNode, scene);
+        }
+        for(const Mesh &mesh : meshes)
+            if(std::find(featureSets.begin(), featureSets.end(), mesh.features) == featureSets.end())
+                featureSets.push_back(mesh.features);
+    }
+
+    // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
+    void processNode(aiNode *node, const aiScene *scene)
+    {
+        // process each mesh located at the current node
+        for(unsigned int i = 0; i < node->mNumMeshes; i++)
+        {
+            // the node object only contains indices to index the actual objects in the scene.
+            // the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
+            aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
+            meshes.push_back(processMesh(mesh, scene));
+        }
+        // after we've processed all of the meshes (if any) we then recursively process each of the children nodes
+        for(unsigned int i = 0; i < node->mNumChildren; i++)
+        {
+            processNode(node->mChildren[i], scene);
+        }
+
+    }
+
+    Mesh processMesh(aiMesh *mesh, const aiScene *scene)
+    {
+        // data to fill
+        vector<Vertex> vertices;
+        vector<unsigned int> indices;
+        vector<Texture> textures;
+
+        ConvertMesh(mesh, vertices, indices);
+
         // process materials
         aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
         // we assume a convention for sampler names in the shaders. Each diffuse texture should be named
@@ -205,7 +315,8 @@ private:
             if(!skip)
             {   // if texture hasn't been loaded already, load it
                 Texture texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory);
+                // diffuse maps hold sRGB colors, the others (specular, normal, height) hold data
+                texture.id = TextureFromFile(str.C_Str(), this->directory, typeName == "texture_diffuse");
                 texture.type = typeName;
                 texture.path = str.C_Str();
                 textures.push_back(texture);
@@ -221,25 +332,34 @@ unsigned int TextureFromFile(const char *path, const string &directory, bool gam
 {
     string filename = string(path);
     filename = directory + '/' + filename;
+    rg::StartupScope trace("texture", filename);
 
     unsigned int textureID;
     glGenTextures(1, &textureID);
 
     int width, height, nrComponents;
-    unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
+    unsigned char *data = rg::loadImageTraced(filename, &width, &height, &nrComponents);
     if (data)
     {
+        rg::StartupScope upload("upload", filename);
+        upload.arg("bytes", (uint64_t) width * height * nrComponents);
+        GLenum internalFormat;
         GLenum format;
         if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
+            internalFormat = format = GL_RED;
+        else if (nrComponents == 3) {
+            internalFormat = gamma ? GL_SRGB : GL_RGB;
             format = GL_RGB;
-        else if (nrComponents == 4)
+        } else if (nrComponents == 4) {
+            internalFormat = gamma ? GL_SRGB_ALPHA : GL_RGBA;
             format = GL_RGBA;
+        }
 
         glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, GL_UNSIGNED_BYTE, data);
         glGenerateMipmap(GL_TEXTURE_2D);
+        rg::gpuMemory().track(rg::GpuMemory::Kind::Texture, textureID, "model textures",
+                              rg::GpuMemory::textureBytes(internalFormat, width, height, 0), path);
 
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
@@ -4,80 +4,85 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include <algorithm>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
 #include <common.h>
+#include <rg/GLState.h>
+#include <rg/ProgramBinaryCache.h>
+#include <rg/ShaderPreprocessor.h>
+#include <rg/StartupTrace.h>
+
+// KHR_parallel_shader_compile, not in the 3.3 glad loader
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
 class Shader
 {
 public:
     unsigned int ID;
     // constructor generates the shader on the fly
     // ------------------------------------------------------------------------
-    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr)
+    // defines are inserted after the #version line of every stage, see rg::ShaderVariants.
+    // Sources may #include other files, see rg::ShaderPreprocessor
+    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr,
+           const std::string &defines = "") : defines(defines)
     {
         std::string vertexPathString(vertexPath);
         std::string fragmentPathString(fragmentPath);
+        paths.push_back(vertexPathString);
+        paths.push_back(fragmentPathString);
+        if (geometryPath != nullptr)
+            paths.push_back(geometryPath);
+        rg::StartupScope trace("shader", vertexPathString + " + " + fragmentPathString);
 
-        vertexPath = vertexPathString.c_str();
-        fragmentPath= fragmentPathString.c_str();
-        // 1. retrieve the vertex/fragment source code from filePath
+        // 1. retrieve the vertex/fragment source code from filePath, #includes expanded
         std::string vertexCode;
         std::string fragmentCode;
         std::string geometryCode;
-        std::ifstream vShaderFile;
-        std::ifstream fShaderFile;
-        std::ifstream gShaderFile;
-        // ensure ifstream objects can throw exceptions:
-        vShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        fShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        gShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        try 
         {
-            // open files
-            vShaderFile.open(vertexPath);
-            fShaderFile.open(fragmentPath);
-            std::stringstream vShaderStream, fShaderStream;
-            // read file's buffer contents into streams
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();		
-            // close file handlers
-            vShaderFile.close();
-            fShaderFile.close();
-            // convert stream into string
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();			
-            // if geometry shader path is present, also load a geometry shader
-            if(geometryPath != nullptr)
-            {
-                std::string geometryPathString(geometryPath);
-                geometryPath = geometryPathString.c_str();
-                gShaderFile.open(geometryPath);
-                std::stringstream gShaderStream;
-                gShaderStream << gShaderFile.rdbuf();
-                gShaderFile.close();
-                geometryCode = gShaderStream.str();
-            }
+            rg::StartupScope read("read", vertexPathString);
+            if (readSource(0, vertexCode) && readSource(1, fragmentCode) && geometryPath != nullptr)
+                readSource(2, geometryCode);
+            read.arg("bytes", vertexCode.size() + fragmentCode.size() + geometryCode.size());
         }
-        catch (std::ifstream::failure& e)
+        // 2. a binary of the same sources linked by the same driver skips compile and link
+        ID = glCreateProgram();
+        std::string binaryKey;
+        if (rg::programBinaryCache().enabled())
         {
-            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
+            binaryKey = rg::programBinaryCache().key({&vertexCode, &fragmentCode, &geometryCode});
+            rg::StartupScope binary("program binary", vertexPathString + " + " + fragmentPathString);
+            if (rg::programBinaryCache().load(ID, binaryKey))
+                return;
+            // a rejected binary leaves the program in an undefined state, link into a fresh one
+            glDeleteProgram(ID);
+            ID = glCreateProgram();
         }
         const char* vShaderCode = vertexCode.c_str();
         const char * fShaderCode = fragmentCode.c_str();
-        // 2. compile shaders
+        // 3. compile shaders
         unsigned int vertex, fragment;
-        // vertex shader
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
-        glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
+        // vertex shader, the status query in checkCompileErrors waits for the compile so the trace covers it
+        {
+            rg::StartupScope compile("compile", vertexPathString);
+            vertex = glCreateShader(GL_VERTEX_SHADER);
+            glShaderSource(vertex, 1, &vShaderCode, NULL);
+            glCompileShader(vertex);
+            checkCompileErrors(vertex, "VERTEX");
+        }
         // fragment Shader
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
+        {
+            rg::StartupScope compile("compile", fragmentPathString);
+            fragment = glCreateShader(GL_FRAGMENT_SHADER);
+            glShaderSource(fragment, 1, &fShaderCode, NULL);
+            glCompileShader(fragment);
+            checkCompileErrors(fragment, "FRAGMENT");
+        }
         // if geometry shader is given, compile geometry shader
         unsigned int geometry;
         if(geometryPath != nullptr)
@@ -89,13 +94,17 @@ public:
             checkCompileErrors(geometry, "GEOMETRY");
         }
         // shader Program
-        ID = glCreateProgram();
         glAttachShader(ID, vertex);
         glAttachShader(ID, fragment);
         if(geometryPath != nullptr)
             glAttachShader(ID, geometry);
-        glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
+        {
+            rg::StartupScope link("link", vertexPathString + " + " + fragmentPathString);
+            rg::programBinaryCache().prepare(ID);
+            glLinkProgram(ID);
+            checkCompileErrors(ID, "PROGRAM");
+        }
+        rg::programBinaryCache().store(ID, binaryKey);
         // delete the shaders as they're linked into our program now and no longer necessery
         glDeleteShader(vertex);
         glDeleteShader(fragment);
@@ -107,7 +116,7 @@ public:
     // ------------------------------------------------------------------------
     void use() 
     { 
-        glUseProgram(ID); 
+        rg::glState().useProgram(ID);
     }
     // utility uniform functions
     // ------------------------------------------------------------------------
@@ -168,10 +177,134 @@ public:
         glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
     }
 
+    // hot reload
+    // ------------------------------------------------------------------------
+    enum ReloadStatus { RELOAD_IDLE, RELOAD_PENDING, RELOAD_SWAPPED, RELOAD_FAILED };
+
+    // vertex, fragment and (if given) geometry source files
+    const std::vector<std::string>& sourcePaths() const
+    {
+        return paths;
+    }
+
+    // the source files and every file they include, a change to any of them needs a rebuild
+    const std::vector<std::string>& dependencies() const
+    {
+        return dependencyFiles;
+    }
+
+    bool reloading() const
+    {
+        return pending != 0;
+    }
+
+    // rereads the sources and starts compiling and linking them into a new program without waiting
+    // for the result; ID keeps the current program until pollReload() swaps the new one in
+    bool beginReload()
+    {
+        if (pending != 0)
+            return false;
+        std::vector<std::string> sources(paths.size());
+        for (size_t i = 0; i < paths.size(); i++)
+        {
+            if (!readSource(i, sources[i]))
+                return false;
+        }
+        const GLenum types[] = {GL_VERTEX_SHADER, GL_FRAGMENT_SHADER, GL_GEOMETRY_SHADER};
+        pending = glCreateProgram();
+        pendingStages.clear();
+        for (size_t i = 0; i < sources.size(); i++)
+        {
+            const char *code = sources[i].c_str();
+            unsigned int stage = glCreateShader(types[i]);
+            glShaderSource(stage, 1, &code, NULL);
+            glCompileShader(stage);
+            glAttachShader(pending, stage);
+            pendingStages.push_back(stage);
+        }
+        if (rg::programBinaryCache().enabled())
+        {
+            std::vector<const std::string *> keySources;
+            for (const std::string &source : sources)
+                keySources.push_back(&source);
+            // the constructor always hashes a geometry source, an empty one when there is none
+            std::string noGeometry;
+            if (sources.size() < 3)
+                keySources.push_back(&noGeometry);
+            pendingKey = rg::programBinaryCache().key(keySources);
+        }
+        rg::programBinaryCache().prepare(pending);
+        glLinkProgram(pending);
+        return true;
+    }
+
+    // checks on a reload started by beginReload(). With parallel compile (KHR_parallel_shader_compile)
+    // an unfinished link reports RELOAD_PENDING, otherwise the status query waits for the driver.
+    // A failed build prints its log and keeps the old program
+    ReloadStatus pollReload(bool parallelCompile)
+    {
+        if (pending == 0)
+            return RELOAD_IDLE;
+        if (parallelCompile)
+        {
+            GLint completed = GL_FALSE;
+            glGetProgramiv(pending, GL_COMPLETION_STATUS_KHR, &completed);
+            if (!completed)
+                return RELOAD_PENDING;
+        }
+        const char *stageNames[] = {"VERTEX", "FRAGMENT", "GEOMETRY"};
+        bool compiled = true;
+        for (size_t i = 0; i < pendingStages.size(); i++)
+            compiled = checkCompileErrors(pendingStages[i], stageNames[i]) && compiled;
+        bool linked = compiled && checkCompileErrors(pending, "PROGRAM");
+        for (unsigned int stage : pendingStages)
+            glDeleteShader(stage);
+        pendingStages.clear();
+        if (!linked)
+        {
+            glDeleteProgram(pending);
+            pending = 0;
+            return RELOAD_FAILED;
+        }
+        rg::programBinaryCache().store(pending, pendingKey);
+        // unbind first, so the state cache can't mistake a later program reusing the name for this one
+        rg::glState().useProgram(0);
+        glDeleteProgram(ID);
+        ID = pending;
+        pending = 0;
+        return RELOAD_SWAPPED;
+    }
+
 private:
+    std::vector<std::string> paths;
+    std::string defines;
+    std::vector<std::string> dependencyFiles;
+    // files of each stage in the order of their source string numbers
+    std::vector<std::string> stageFiles[3];
+    // program being rebuilt by a hot reload and its shader stages, 0 when none is in flight
+    unsigned int pending = 0;
+    std::vector<unsigned int> pendingStages;
+    std::string pendingKey;
+
+    // reads a stage with its includes expanded and the defines inserted, and records the files it used
+    bool readSource(size_t stage, std::string &code)
+    {
+        rg::ShaderPreprocessor preprocessor(defines);
+        if (!preprocessor.process(paths[stage], code))
+        {
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ " << preprocessor.error() << std::endl;
+            return false;
+        }
+        stageFiles[stage] = preprocessor.files();
+        for (const std::string &file : stageFiles[stage])
+            if (std::find(dependencyFiles.begin(), dependencyFiles.end(), file) == dependencyFiles.end())
+                dependencyFiles.push_back(file);
+        return true;
+    }
+
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
-    void checkCompileErrors(GLuint shader, std::string type)
+    bool checkCompileErrors(GLuint shader, std::string type)
     {
         GLint success;
         GLchar infoLog[1024];
@@ -181,7 +314,12 @@ private:
             if(!success)
             {
                 glGetShaderInfoLog(shader, 1024, NULL, infoLog);
-                std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
+                std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: " << type << "\n" << infoLog;
+                // the number in front of the line in the log is the file's source string number
+                const std::vector<std::string> &files = stageFiles[type == "VERTEX" ? 0 : type == "FRAGMENT" ? 1 : 2];
+                for (size_t i = 0; i < files.size(); i++)
+                    std::cout << "source " << i << ": " << files[i] << "\n";
+                std::cout << " -- --------------------------------------------------- -- " << std::endl;
             }
         }
         else
@@ -193,6 +331,7 @@ private:
                 std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
             }
         }
+        return success;
     }
 };
 #endif
@@ -0,0 +1,222 @@
+#ifndef PROJECT_BASE_BENCHMARK_H
+#define PROJECT_BASE_BENCHMARK_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <rg/Error.h>
+
+namespace rg {
+
+// Recorded camera flight for benchmark runs. Text file, one entry per line, '#' starts a comment:
+//   key   <time> <x> <y> <z> <targetX> <targetY> <targetZ>   camera position and the point it looks at
+//   event <time> <name>                                      scene toggle fired once at that time
+// Positions and targets are interpolated with a Catmull-Rom spline through the keys.
+class CameraScript {
+public:
+    struct Event {
+        float time;
+        std::string name;
+    };
+
+    bool load(const std::string &path) {
+        std::ifstream in(path);
+        if (!in) {
+            std::cerr << "Failed to open camera script " << path << '\n';
+            return false;
+        }
+        m_Keys.clear();
+        m_Events.clear();
+        std::string line;
+        int lineNumber = 0;
+        while (std::getline(in, line)) {
+            ++lineNumber;
+            line = line.substr(0, line.find('#'));
+            std::istringstream fields(line);
+            std::string kind;
+            if (!(fields >> kind)) {
+                continue;
+            }
+            bool valid = false;
+            if (kind == "key") {
+                Key key;
+                valid = (bool) (fields >> key.time >> key.position.x >> key.position.y >> key.position.z
+                                       >> key.target.x >> key.target.y >> key.target.z);
+                if (valid) {
+                    m_Keys.push_back(key);
+                }
+            } else if (kind == "event") {
+                Event event;
+                valid = (bool) (fields >> event.time >> event.name);
+                if (valid) {
+                    m_Events.push_back(event);
+                }
+            }
+            if (!valid) {
+                std::cerr << path << ":" << lineNumber << ": malformed line\n";
+                return false;
+            }
+        }
+        if (m_Keys.size() < 2) {
+            std::cerr << path << ": a camera script needs at least two keys\n";
+            return false;
+        }
+        std::stable_sort(m_Keys.begin(), m_Keys.end(), [](const Key &a, const Key &b) { return a.time < b.time; });
+        std::stable_sort(m_Events.begin(), m_Events.end(), [](const Event &a, const Event &b) { return a.time < b.time; });
+        return true;
+    }
+
+    float duration() const {
+        return m_Keys.back().time;
+    }
+
+    void sample(float time, glm::vec3 &position, glm::vec3 &target) const {
+        time = std::max(m_Keys.front().time, std::min(time, m_Keys.back().time));
+        size_t segment = 0;
+        while (segment + 2 < m_Keys.size() && m_Keys[segment + 1].time <= time) {
+            ++segment;
+        }
+        const Key &k1 = m_Keys[segment];
+        const Key &k2 = m_Keys[segment + 1];
+        const Key &k0 = m_Keys[segment > 0 ? segment - 1 : segment];
+        const Key &k3 = m_Keys[std::min(segment + 2, m_Keys.size() - 1)];
+        float length = k2.time - k1.time;
+        float t = length > 0.0f ? (time - k1.time) / length : 0.0f;
+        position = catmullRom(k0.position, k1.position, k2.position, k3.position, t);
+        target = catmullRom(k0.target, k1.target, k2.target, k3.target, t);
+    }
+
+    // events with from < time <= to, in script order
+    std::vector<Event> eventsBetween(float from, float to) const {
+        std::vector<Event> events;
+        for (const Event &event : m_Events) {
+            if (event.time > from && event.time <= to) {
+                events.push_back(event);
+            }
+        }
+        return events;
+    }
+
+private:
+    struct Key {
+        float time;
+        glm::vec3 position;
+        glm::vec3 target;
+    };
+
+    static glm::vec3 catmullRom(const glm::vec3 &p0, const glm::vec3 &p1, const glm::vec3 &p2, const glm::vec3 &p3, float t) {
+        float t2 = t * t;
+        float t3 = t2 * t;
+        return 0.5f * ((2.0f * p1) + (p2 - p0) * t + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2
+                       + (3.0f * p1 - p0 - 3.0f * p2 + p3) * t3);
+    }
+
+    std::vector<Key> m_Keys;
+    std::vector<Event> m_Events;
+};
+
+// GPU time of whole frames with GL_TIME_ELAPSED queries. A small ring of query objects is cycled
+// so a result is only read back a few frames after it was issued, when the GPU is long done with it.
+// Without keepTimes only the latest result is kept, for timing every frame of an interactive run.
+class GpuFrameTimer {
+public:
+    static const unsigned int Latency = 4;
+
+    explicit GpuFrameTimer(bool keepTimes = true) : m_KeepTimes(keepTimes) {
+        glGenQueries(Latency, m_Queries);
+    }
+
+    ~GpuFrameTimer() {
+        glDeleteQueries(Latency, m_Queries);
+    }
+
+    GpuFrameTimer(const GpuFrameTimer&) = delete;
+    GpuFrameTimer& operator=(const GpuFrameTimer&) = delete;
+
+    // returns whether an earlier frame's time was read back, see latest()
+    bool begin() {
+        unsigned int slot = m_Issued % Latency;
+        bool collected = m_Issued >= Latency;
+        if (collected) {
+            collect(slot);
+        }
+        glBeginQuery(GL_TIME_ELAPSED, m_Queries[slot]);
+        return collected;
+    }
+
+    void end() {
+        glEndQuery(GL_TIME_ELAPSED);
+        ++m_Issued;
+    }
+
+    // reads the queries still in flight, call once after the last frame
+    void finish() {
+        unsigned int first = m_Issued > Latency ? m_Issued - Latency : 0;
+        for (unsigned int frame = first; frame < m_Issued; ++frame) {
+            collect(frame % Latency);
+        }
+        m_Issued = 0;
+    }
+
+    // milliseconds per frame, in frame order
+    const std::vector<double> &times() const {
+        return m_Times;
+    }
+
+    // milliseconds of the last frame read back
+    double latest() const {
+        return m_Latest;
+    }
+
+private:
+    void collect(unsigned int slot) {
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(m_Queries[slot], GL_QUERY_RESULT, &nanoseconds);
+        m_Latest = nanoseconds / 1.0e6;
+        if (m_KeepTimes) {
+            m_Times.push_back(m_Latest);
+        }
+    }
+
+    bool m_KeepTimes;
+    double m_Latest = 0.0;
+    unsigned int m_Queries[Latency];
+    unsigned int m_Issued = 0;
+    std::vector<double> m_Times;
+};
+
+// nearest-rank percentile, p in [0, 100]
+inline double percentile(std::vector<double> values, double p) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    std::sort(values.begin(), values.end());
+    size_t rank = (size_t) std::ceil(p / 100.0 * values.size());
+    return values[rank > 0 ? rank - 1 : 0];
+}
+
+// one {"mean", "p50", "p95", "p99", "max"} object, fixed precision so runs diff cleanly
+inline void writeTimingJson(std::ostream &out, const char *name, const std::vector<double> &times, bool last) {
+    double total = 0.0;
+    for (double time : times) {
+        total += time;
+    }
+    out << "  \"" << name << "\": {\n"
+        << std::fixed << std::setprecision(3)
+        << "    \"mean\": " << (times.empty() ? 0.0 : total / times.size()) << ",\n"
+        << "    \"p50\": " << percentile(times, 50.0) << ",\n"
+        << "    \"p95\": " << percentile(times, 95.0) << ",\n"
+        << "    \"p99\": " << percentile(times, 99.0) << ",\n"
+        << "    \"max\": " << percentile(times, 100.0) << "\n"
+        << "  }" << (last ? "\n" : ",\n");
+}
+
+};
+
+#endif //PROJECT_BASE_BENCHMARK_H
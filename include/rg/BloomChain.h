@@ -0,0 +1,122 @@
+#ifndef PROJECT_BASE_BLOOMCHAIN_H
+#define PROJECT_BASE_BLOOMCHAIN_H
+
+#include <glad/glad.h>
+#include <algorithm>
+#include <rg/Error.h>
+#include <rg/GLState.h>
+#include <rg/GpuMemory.h>
+
+namespace rg {
+
+// Mip chain the bloom is blurred on (R11F_G11F_B10F), level 0 at half the scene target's size and
+// every further level half of the one above, down to a few pixels:
+//   - downsample (bloom_downsample.fs): level 0 keeps what is brighter than the threshold of the
+//     scene, every further level is a 4x4 box of the one above
+//   - upsample (bloom_upsample.fs): from the smallest level up, each level is blurred with a tent
+//     and added onto the one above (additive blending)
+// Level 0 then holds the sum of all levels, the post pass adds it to the scene before tone mapping.
+// All passes are at half size or less; together they fetch about as many texels as one full size pass.
+class BloomChain {
+public:
+    static const int MaxLevels = 6;
+
+    ~BloomChain() {
+        destroyLevels();
+    }
+
+    // (re)creates the levels when the scene's size changed
+    void resize(int width, int height) {
+        if (width == m_Width && height == m_Height) {
+            return;
+        }
+        destroyLevels();
+        m_Width = width;
+        m_Height = height;
+        int levelWidth = std::max(width / 2, 1);
+        int levelHeight = std::max(height / 2, 1);
+        // levels narrower than 8 pixels add nothing a wider blur of the level above doesn't
+        for (m_Levels = 0; m_Levels < MaxLevels; ++m_Levels) {
+            if (m_Levels > 0 && std::min(levelWidth, levelHeight) < 8) {
+                break;
+            }
+            createLevel(m_Levels, levelWidth, levelHeight);
+            levelWidth = std::max(levelWidth / 2, 1);
+            levelHeight = std::max(levelHeight / 2, 1);
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        // texture creation went around the state cache
+        glState().invalidate();
+    }
+
+    int levels() const {
+        return m_Levels;
+    }
+
+    int levelWidth(int level) const {
+        return m_LevelWidth[level];
+    }
+
+    int levelHeight(int level) const {
+        return m_LevelHeight[level];
+    }
+
+    void bindLevelTarget(int level) {
+        glBindFramebuffer(GL_FRAMEBUFFER, m_Framebuffers[level]);
+        glViewport(0, 0, m_LevelWidth[level], m_LevelHeight[level]);
+    }
+
+    void bindLevelTexture(int level, unsigned int unit) {
+        glState().bindTexture(GL_TEXTURE_2D, unit, m_Textures[level]);
+    }
+
+    // level 0 without bloom, so the post pass can keep sampling it
+    void clear() {
+        bindLevelTarget(0);
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+    }
+
+private:
+    void createLevel(int level, int width, int height) {
+        m_LevelWidth[level] = width;
+        m_LevelHeight[level] = height;
+        glGenFramebuffers(1, &m_Framebuffers[level]);
+        glBindFramebuffer(GL_FRAMEBUFFER, m_Framebuffers[level]);
+        glGenTextures(1, &m_Textures[level]);
+        glBindTexture(GL_TEXTURE_2D, m_Textures[level]);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R11F_G11F_B10F, width, height, 0, GL_RGB, GL_FLOAT, NULL);
+        // the filters place their taps between texels, bilinear filtering averages them
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        gpuMemory().track(GpuMemory::Kind::Texture, m_Textures[level], "render targets",
+                          GpuMemory::textureBytes(GL_R11F_G11F_B10F, width, height), "bloom chain");
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_Textures[level], 0);
+        ASSERT(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE, "Bloom level is not complete!");
+    }
+
+    void destroyLevels() {
+        for (int level = 0; level < m_Levels; ++level) {
+            gpuMemory().release(GpuMemory::Kind::Texture, m_Textures[level]);
+            glDeleteTextures(1, &m_Textures[level]);
+            glDeleteFramebuffers(1, &m_Framebuffers[level]);
+            m_Textures[level] = 0;
+            m_Framebuffers[level] = 0;
+        }
+        m_Levels = 0;
+    }
+
+    unsigned int m_Framebuffers[MaxLevels] = {};
+    unsigned int m_Textures[MaxLevels] = {};
+    int m_LevelWidth[MaxLevels] = {};
+    int m_LevelHeight[MaxLevels] = {};
+    int m_Levels = 0;
+    int m_Width = 0;
+    int m_Height = 0;
+};
+
+};
+
+#endif //PROJECT_BASE_BLOOMCHAIN_H
@@ -0,0 +1,251 @@
+#ifndef PROJECT_BASE_CLUSTEREDLIGHTING_H
+#define PROJECT_BASE_CLUSTEREDLIGHTING_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <rg/Error.h>
+#include <rg/GLState.h>
+#include <rg/Profiler.h>
+#include <rg/GpuMemory.h>
+#include <rg/ThreadPool.h>
+
+namespace rg {
+
+struct ClusterLight {
+    glm::vec3 position;
+    float radius;
+    glm::vec3 ambient;
+    glm::vec3 diffuse;
+    glm::vec3 specular;
+    float constant;
+    float linear;
+    float quadratic;
+};
+
+// Clustered forward lighting. The view frustum is split into a froxel grid (screen tiles times
+// exponentially distributed depth slices); every frame the lights are binned into the froxels
+// they touch, in parallel over the depth slices, and the result is uploaded into three texture
+// buffers the fragment shaders read with texelFetch (GL 3.3 has no shader storage buffers):
+//   lights:   4 RGBA32F texels per light (position+radius, ambient+constant, diffuse+linear, specular+quadratic)
+//   clusters: one RG32UI texel per froxel (offset into the index list, light count)
+//   indices:  R32UI light indices
+class ClusteredLighting {
+public:
+    static const unsigned int TilesX = 16;
+    static const unsigned int TilesY = 9;
+    static const unsigned int Slices = 24;
+    static const unsigned int ClusterCount = TilesX * TilesY * Slices;
+    static const unsigned int MaxLightsPerCluster = 128;
+
+    ClusteredLighting() {
+        glGenBuffers(3, m_Buffers);
+        glGenTextures(3, m_Textures);
+        GLenum formats[3] = {GL_RGBA32F, GL_RG32UI, GL_R32UI};
+        for (int i = 0; i < 3; ++i) {
+            glBindBuffer(GL_TEXTURE_BUFFER, m_Buffers[i]);
+            glBufferData(GL_TEXTURE_BUFFER, 16, NULL, GL_STREAM_DRAW);
+            gpuMemory().track(GpuMemory::Kind::Buffer, m_Buffers[i], "light clusters", 16);
+            glBindTexture(GL_TEXTURE_BUFFER, m_Textures[i]);
+            glTexBuffer(GL_TEXTURE_BUFFER, formats[i], m_Buffers[i]);
+        }
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+        GLint maxTexels = 0;
+        glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+        m_MaxIndices = (unsigned int) maxTexels;
+        m_SliceIndices.resize(Slices);
+    }
+
+    ~ClusteredLighting() {
+        for (unsigned int buffer : m_Buffers) {
+            gpuMemory().release(GpuMemory::Kind::Buffer, buffer);
+        }
+        glDeleteTextures(3, m_Textures);
+        glDeleteBuffers(3, m_Buffers);
+    }
+
+    ClusteredLighting(const ClusteredLighting&) = delete;
+    ClusteredLighting& operator=(const ClusteredLighting&) = delete;
+
+    // bins the lights for the given camera and uploads the three buffers
+    void update(const std::vector<ClusterLight>& lights, const glm::mat4& view, const glm::mat4& projection,
+                float zNear, float zFar, ThreadPool& pool) {
+        PROFILE_CPU_SCOPE("light binning");
+        m_Near = zNear;
+        m_Far = zFar;
+
+        m_ViewLights.resize(lights.size());
+        for (size_t i = 0; i < lights.size(); ++i) {
+            glm::vec4 viewPosition = view * glm::vec4(lights[i].position, 1.0f);
+            m_ViewLights[i] = glm::vec4(glm::vec3(viewPosition), lights[i].radius);
+        }
+
+        // x_view = ndc_x * depth / P[0][0] for a symmetric perspective projection
+        float invScaleX = 1.0f / projection[0][0];
+        float invScaleY = 1.0f / projection[1][1];
+        pool.parallelFor(Slices, [&](unsigned int slice) {
+            binSlice(slice, invScaleX, invScaleY);
+        });
+
+        // concatenate the per-slice lists; slices were binned independently so no locking was needed
+        m_Clusters.resize(ClusterCount * 2);
+        m_Indices.clear();
+        for (unsigned int slice = 0; slice < Slices; ++slice) {
+            const SliceBins& bins = m_SliceIndices[slice];
+            for (unsigned int tile = 0; tile < TilesX * TilesY; ++tile) {
+                unsigned int cluster = slice * TilesX * TilesY + tile;
+                unsigned int begin = bins.offsets[tile];
+                unsigned int count = bins.offsets[tile + 1] - begin;
+                if (m_Indices.size() + count > m_MaxIndices) {
+                    count = 0;
+                }
+                m_Clusters[cluster * 2] = m_Indices.size();
+                m_Clusters[cluster * 2 + 1] = count;
+                m_Indices.insert(m_Indices.end(), bins.indices.begin() + begin, bins.indices.begin() + begin + count);
+            }
+        }
+
+        m_LightData.resize(lights.size() * 16);
+        for (size_t i = 0; i < lights.size(); ++i) {
+            const ClusterLight& light = lights[i];
+            float* texel = &m_LightData[i * 16];
+            writeTexel(texel, light.position, light.radius);
+            writeTexel(texel + 4, light.ambient, light.constant);
+            writeTexel(texel + 8, light.diffuse, light.linear);
+            writeTexel(texel + 12, light.specular, light.quadratic);
+        }
+
+        upload(0, m_LightData.data(), m_LightData.size() * sizeof(float));
+        upload(1, m_Clusters.data(), m_Clusters.size() * sizeof(unsigned int));
+        upload(2, m_Indices.data(), m_Indices.size() * sizeof(unsigned int));
+        m_LightCount = lights.size();
+    }
+
+    // lights, clusters and indices on three consecutive units starting at firstUnit;
+    // buffer textures are not tracked by the state cache, so the units must not be shared with 2D textures
+    void bind(unsigned int firstUnit) {
+        for (unsigned int i = 0; i < 3; ++i) {
+            glState().activeTexture(firstUnit + i);
+            glBindTexture(GL_TEXTURE_BUFFER, m_Textures[i]);
+        }
+    }
+
+    // the uniforms the clustered shaders need to find their froxel
+    template <typename ShaderType>
+    void setUniforms(ShaderType& shader, float screenWidth, float screenHeight) const {
+        shader.setVec2("clusterTileSize", screenWidth / TilesX, screenHeight / TilesY);
+        shader.setFloat("clusterNear", m_Near);
+        shader.setFloat("clusterFar", m_Far);
+    }
+
+    unsigned int lightCount() const {
+        return m_LightCount;
+    }
+
+    unsigned int indexCount() const {
+        return m_Indices.size();
+    }
+
+private:
+    struct SliceBins {
+        std::vector<unsigned int> offsets;
+        std::vector<unsigned int> indices;
+    };
+
+    static void writeTexel(float* texel, const glm::vec3& xyz, float w) {
+        texel[0] = xyz.x;
+        texel[1] = xyz.y;
+        texel[2] = xyz.z;
+        texel[3] = w;
+    }
+
+    float sliceDepth(unsigned int slice) const {
+        return m_Near * std::pow(m_Far / m_Near, (float) slice / Slices);
+    }
+
+    void binSlice(unsigned int slice, float invScaleX, float invScaleY) {
+        PROFILE_CPU_SCOPE("bin slice");
+        SliceBins& bins = m_SliceIndices[slice];
+        bins.offsets.assign(TilesX * TilesY + 1, 0);
+        bins.indices.clear();
+
+        // view space looks down -z; the slice spans depths [nearDepth, farDepth]
+        float nearDepth = sliceDepth(slice);
+        float farDepth = sliceDepth(slice + 1);
+        m_SliceLights[slice].clear();
+        std::vector<unsigned int>& candidates = m_SliceLights[slice];
+        for (unsigned int i = 0; i < m_ViewLights.size(); ++i) {
+            float depth = -m_ViewLights[i].z;
+            float radius = m_ViewLights[i].w;
+            if (depth + radius >= nearDepth && depth - radius <= farDepth) {
+                candidates.push_back(i);
+            }
+        }
+
+        for (unsigned int y = 0; y < TilesY; ++y) {
+            float ndcMinY = -1.0f + 2.0f * y / TilesY;
+            float ndcMaxY = -1.0f + 2.0f * (y + 1) / TilesY;
+            for (unsigned int x = 0; x < TilesX; ++x) {
+                float ndcMinX = -1.0f + 2.0f * x / TilesX;
+                float ndcMaxX = -1.0f + 2.0f * (x + 1) / TilesX;
+
+                // bounding box of the froxel, the tile widens with depth so both ends are considered
+                glm::vec3 boxMin(std::min(ndcMinX * nearDepth, ndcMinX * farDepth) * invScaleX,
+                                 std::min(ndcMinY * nearDepth, ndcMinY * farDepth) * invScaleY,
+                                 -farDepth);
+                glm::vec3 boxMax(std::max(ndcMaxX * nearDepth, ndcMaxX * farDepth) * invScaleX,
+                                 std::max(ndcMaxY * nearDepth, ndcMaxY * farDepth) * invScaleY,
+                                 -nearDepth);
+
+                unsigned int tile = y * TilesX + x;
+                unsigned int count = 0;
+                for (unsigned int light : candidates) {
+                    if (count == MaxLightsPerCluster) {
+                        break;
+                    }
+                    glm::vec3 center(m_ViewLights[light]);
+                    glm::vec3 closest = glm::clamp(center, boxMin, boxMax);
+                    glm::vec3 offset = center - closest;
+                    float radius = m_ViewLights[light].w;
+                    if (glm::dot(offset, offset) <= radius * radius) {
+                        bins.indices.push_back(light);
+                        ++count;
+                    }
+                }
+                bins.offsets[tile + 1] = bins.indices.size();
+            }
+        }
+    }
+
+    void upload(int buffer, const void* data, size_t bytes) {
+        glBindBuffer(GL_TEXTURE_BUFFER, m_Buffers[buffer]);
+        // orphan the previous frame's storage instead of waiting for the GPU to finish with it
+        glBufferData(GL_TEXTURE_BUFFER, std::max(bytes, (size_t) 16), NULL, GL_STREAM_DRAW);
+        gpuMemory().resize(GpuMemory::Kind::Buffer, m_Buffers[buffer], std::max(bytes, (size_t) 16));
+        if (bytes > 0) {
+            glBufferSubData(GL_TEXTURE_BUFFER, 0, bytes, data);
+        }
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+
+    unsigned int m_Buffers[3];
+    unsigned int m_Textures[3];
+    unsigned int m_MaxIndices = 0;
+    unsigned int m_LightCount = 0;
+    float m_Near = 0.1f;
+    float m_Far = 1000.0f;
+
+    std::vector<glm::vec4> m_ViewLights;
+    std::vector<SliceBins> m_SliceIndices;
+    std::vector<unsigned int> m_SliceLights[Slices];
+    std::vector<unsigned int> m_Clusters;
+    std::vector<unsigned int> m_Indices;
+    std::vector<float> m_LightData;
+};
+
+};
+
+#endif //PROJECT_BASE_CLUSTEREDLIGHTING_H
@@ -0,0 +1,228 @@
+#ifndef PROJECT_BASE_COMMANDLIST_H
+#define PROJECT_BASE_COMMANDLIST_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <rg/GLState.h>
+#include <rg/InstanceBuffer.h>
+
+namespace rg {
+
+// Textures of a material and the sampler uniform each one is bound to, unit i gets texture i.
+struct Material {
+    std::vector<std::string> samplers;
+    std::vector<unsigned int> textures;
+};
+
+// glGetUniformLocation results per (program, name). Names are keyed by address, so they have to
+// be string literals or strings that outlive the cache, like the sampler names of a Material.
+class UniformLocationCache {
+public:
+    int location(unsigned int program, const char *name) {
+        auto found = m_Locations.find(Key{program, name});
+        if (found != m_Locations.end()) {
+            return found->second;
+        }
+        int location = glGetUniformLocation(program, name);
+        m_Locations.emplace(Key{program, name}, location);
+        return location;
+    }
+
+    void clear() {
+        m_Locations.clear();
+    }
+
+private:
+    struct Key {
+        unsigned int program;
+        const char *name;
+
+        bool operator==(const Key &other) const {
+            return program == other.program && name == other.name;
+        }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key &key) const {
+            return std::hash<const char *>()(key.name) ^ (std::hash<unsigned int>()(key.program) << 1);
+        }
+    };
+
+    std::unordered_map<Key, int, KeyHash> m_Locations;
+};
+
+// A recorded sequence of draw commands. Recording only appends to the list and never touches GL,
+// so any thread can record into its own list; execute() replays it on the GL thread. Uniform values
+// and instance matrices are copied into the list, materials, names and instance buffers are referenced
+// and have to stay alive until the list was executed.
+class CommandList {
+public:
+    void bindProgram(unsigned int program) {
+        Command command(Op::BindProgram);
+        command.program = program;
+        m_Commands.push_back(command);
+    }
+
+    // binds [offset, offset + size) of a uniform buffer to a block binding point
+    void bindUniformBlock(unsigned int binding, unsigned int buffer, size_t offset, size_t size) {
+        Command command(Op::BindUniformBlock);
+        command.value = binding;
+        command.object = buffer;
+        command.offset = offset;
+        command.size = size;
+        m_Commands.push_back(command);
+    }
+
+    void setUniform(unsigned int program, const char *name, const glm::mat4 &value) {
+        Command command(Op::SetUniformMat4);
+        command.program = program;
+        command.pointer = name;
+        command.offset = m_Matrices.size();
+        m_Matrices.push_back(value);
+        m_Commands.push_back(command);
+    }
+
+    void setUniform(unsigned int program, const char *name, const glm::mat3 &value) {
+        Command command(Op::SetUniformMat3);
+        command.program = program;
+        command.pointer = name;
+        command.offset = m_Matrices.size();
+        m_Matrices.push_back(glm::mat4(value));
+        m_Commands.push_back(command);
+    }
+
+    void setUniform(unsigned int program, const char *name, int value) {
+        Command command(Op::SetUniformInt);
+        command.program = program;
+        command.pointer = name;
+        command.value = (unsigned int) value;
+        m_Commands.push_back(command);
+    }
+
+    void bindMaterial(unsigned int program, const Material &material) {
+        Command command(Op::BindMaterial);
+        command.program = program;
+        command.pointer = &material;
+        m_Commands.push_back(command);
+    }
+
+    void bindVertexArray(unsigned int vao) {
+        Command command(Op::BindVertexArray);
+        command.object = vao;
+        m_Commands.push_back(command);
+    }
+
+    // GL_TRIANGLES with unsigned int indices from the bound VAO's element buffer
+    void drawIndexed(unsigned int indexCount) {
+        Command command(Op::DrawIndexed);
+        command.value = indexCount;
+        m_Commands.push_back(command);
+    }
+
+    // the matrices are uploaded to instances (attached to the bound VAO) right before the draw
+    void drawIndexedInstanced(unsigned int indexCount, InstanceBuffer &instances, const glm::mat4 *models,
+                              size_t count) {
+        if (count == 0) {
+            return;
+        }
+        Command command(Op::DrawIndexedInstanced);
+        command.value = indexCount;
+        command.pointer = &instances;
+        command.offset = m_Matrices.size();
+        command.size = count;
+        m_Matrices.insert(m_Matrices.end(), models, models + count);
+        m_Commands.push_back(command);
+    }
+
+    void execute(UniformLocationCache &locations) const {
+        for (const Command &command : m_Commands) {
+            switch (command.op) {
+                case Op::BindProgram:
+                    glState().useProgram(command.program);
+                    break;
+                case Op::BindUniformBlock:
+                    glBindBufferRange(GL_UNIFORM_BUFFER, command.value, command.object, command.offset, command.size);
+                    break;
+                case Op::SetUniformMat4:
+                    glUniformMatrix4fv(locations.location(command.program, (const char *) command.pointer), 1, GL_FALSE,
+                                       glm::value_ptr(m_Matrices[command.offset]));
+                    break;
+                case Op::SetUniformMat3:
+                    glUniformMatrix3fv(locations.location(command.program, (const char *) command.pointer), 1, GL_FALSE,
+                                       glm::value_ptr(glm::mat3(m_Matrices[command.offset])));
+                    break;
+                case Op::SetUniformInt:
+                    glUniform1i(locations.location(command.program, (const char *) command.pointer), (int) command.value);
+                    break;
+                case Op::BindMaterial: {
+                    const Material &material = *(const Material *) command.pointer;
+                    for (unsigned int unit = 0; unit < material.textures.size(); unit++) {
+                        glUniform1i(locations.location(command.program, material.samplers[unit].c_str()), unit);
+                        glState().bindTexture(GL_TEXTURE_2D, unit, material.textures[unit]);
+                    }
+                    break;
+                }
+                case Op::BindVertexArray:
+                    glState().bindVertexArray(command.object);
+                    break;
+                case Op::DrawIndexed:
+                    glDrawElements(GL_TRIANGLES, command.value, GL_UNSIGNED_INT, 0);
+                    break;
+                case Op::DrawIndexedInstanced:
+                    ((InstanceBuffer *) command.pointer)->upload(&m_Matrices[command.offset], command.size);
+                    glDrawElementsInstanced(GL_TRIANGLES, command.value, GL_UNSIGNED_INT, 0, command.size);
+                    break;
+            }
+        }
+    }
+
+    // keeps the capacity, a list reused every frame stops allocating after the first one
+    void clear() {
+        m_Commands.clear();
+        m_Matrices.clear();
+    }
+
+    size_t size() const {
+        return m_Commands.size();
+    }
+
+private:
+    enum class Op : std::uint8_t {
+        BindProgram,
+        BindUniformBlock,
+        SetUniformMat4,
+        SetUniformMat3,
+        SetUniformInt,
+        BindMaterial,
+        BindVertexArray,
+        DrawIndexed,
+        DrawIndexedInstanced
+    };
+
+    struct Command {
+        explicit Command(Op op) : op(op) {
+        }
+
+        Op op;
+        unsigned int program = 0;
+        unsigned int object = 0;
+        unsigned int value = 0;
+        const void *pointer = nullptr;
+        size_t offset = 0;
+        size_t size = 0;
+    };
+
+    std::vector<Command> m_Commands;
+    std::vector<glm::mat4> m_Matrices;
+};
+
+};
+
+#endif //PROJECT_BASE_COMMANDLIST_H
@@ -0,0 +1,242 @@
+#ifndef PROJECT_BASE_DEFERREDRENDERER_H
+#define PROJECT_BASE_DEFERREDRENDERER_H
+
+#include <glad/glad.h>
+#include <cmath>
+#include <vector>
+#include <rg/Error.h>
+#include <rg/GLState.h>
+#include <rg/GpuMemory.h>
+
+namespace rg {
+
+// GL resources of the deferred path:
+//   - G-buffer: world position (RGB16F), world normal (RGB16F), albedo + specular mask (RGBA8)
+//   - lighting target: RGBA16F color, shares the G-buffer depth so forward passes can be depth tested
+//   - unit sphere for point light volumes and a fullscreen quad for the directional light / present
+// The lighting itself is done by the caller with its own shaders, see main.cpp.
+class DeferredRenderer {
+public:
+    ~DeferredRenderer() {
+        destroyTargets();
+        gpuMemory().release(GpuMemory::Kind::Buffer, m_SphereVBO);
+        gpuMemory().release(GpuMemory::Kind::Buffer, m_SphereEBO);
+        gpuMemory().release(GpuMemory::Kind::Buffer, m_QuadVBO);
+        glDeleteVertexArrays(1, &m_SphereVAO);
+        glDeleteBuffers(1, &m_SphereVBO);
+        glDeleteBuffers(1, &m_SphereEBO);
+        glDeleteVertexArrays(1, &m_QuadVAO);
+        glDeleteBuffers(1, &m_QuadVBO);
+    }
+
+    // (re)creates the render targets when the framebuffer size changed
+    void resize(int width, int height) {
+        if (width == m_Width && height == m_Height) {
+            return;
+        }
+        destroyTargets();
+        m_Width = width;
+        m_Height = height;
+
+        glGenFramebuffers(1, &m_GBuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, m_GBuffer);
+        m_Position = createColorTexture(GL_RGB16F, GL_RGB, GL_FLOAT, "G-buffer position");
+        m_Normal = createColorTexture(GL_RGB16F, GL_RGB, GL_FLOAT, "G-buffer normal");
+        m_AlbedoSpecular = createColorTexture(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, "G-buffer albedo/specular");
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_Position, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, m_Normal, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, m_AlbedoSpecular, 0);
+        unsigned int attachments[3] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2};
+        glDrawBuffers(3, attachments);
+
+        glGenRenderbuffers(1, &m_Depth);
+        glBindRenderbuffer(GL_RENDERBUFFER, m_Depth);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+        gpuMemory().track(GpuMemory::Kind::Renderbuffer, m_Depth, "render targets",
+                          GpuMemory::textureBytes(GL_DEPTH24_STENCIL8, width, height), "G-buffer depth");
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_Depth);
+        ASSERT(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE, "G-buffer is not complete!");
+
+        glGenFramebuffers(1, &m_LightBuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, m_LightBuffer);
+        m_Light = createColorTexture(GL_RGBA16F, GL_RGBA, GL_FLOAT, "lighting target");
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_Light, 0);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_Depth);
+        ASSERT(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE, "Lighting buffer is not complete!");
+
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        // texture creation went around the state cache
+        glState().invalidate();
+    }
+
+    void bindGeometryTarget() {
+        glBindFramebuffer(GL_FRAMEBUFFER, m_GBuffer);
+        glViewport(0, 0, m_Width, m_Height);
+    }
+
+    void bindLightingTarget() {
+        glBindFramebuffer(GL_FRAMEBUFFER, m_LightBuffer);
+        glViewport(0, 0, m_Width, m_Height);
+    }
+
+    // position, normal and albedo/specular on three consecutive units starting at firstUnit
+    void bindGBufferTextures(unsigned int firstUnit) {
+        glState().bindTexture(GL_TEXTURE_2D, firstUnit, m_Position);
+        glState().bindTexture(GL_TEXTURE_2D, firstUnit + 1, m_Normal);
+        glState().bindTexture(GL_TEXTURE_2D, firstUnit + 2, m_AlbedoSpecular);
+    }
+
+    void bindLightTexture(unsigned int unit) {
+        glState().bindTexture(GL_TEXTURE_2D, unit, m_Light);
+    }
+
+    void drawFullscreenQuad() {
+        if (m_QuadVAO == 0) {
+            float vertices[] = {
+                    -1.0f, -1.0f, 0.0f,
+                     1.0f, -1.0f, 0.0f,
+                     1.0f,  1.0f, 0.0f,
+                    -1.0f, -1.0f, 0.0f,
+                     1.0f,  1.0f, 0.0f,
+                    -1.0f,  1.0f, 0.0f
+            };
+            glGenVertexArrays(1, &m_QuadVAO);
+            glGenBuffers(1, &m_QuadVBO);
+            glState().bindVertexArray(m_QuadVAO);
+            glBindBuffer(GL_ARRAY_BUFFER, m_QuadVBO);
+            glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+            gpuMemory().track(GpuMemory::Kind::Buffer, m_QuadVBO, "scene geometry", sizeof(vertices), "fullscreen quad");
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+        }
+        glState().bindVertexArray(m_QuadVAO);
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+    }
+
+    // unit radius UV sphere, slightly larger than the true sphere so the volume never clips the lit area
+    void drawSphere() {
+        if (m_SphereVAO == 0) {
+            createSphere(16, 12);
+        }
+        glState().bindVertexArray(m_SphereVAO);
+        glDrawElements(GL_TRIANGLES, m_SphereIndexCount, GL_UNSIGNED_INT, 0);
+    }
+
+    int width() const {
+        return m_Width;
+    }
+
+    int height() const {
+        return m_Height;
+    }
+
+    // distance at which the attenuated light drops below 5/256 of its brightest channel
+    static float lightVolumeRadius(float constant, float linear, float quadratic, float maxBrightness) {
+        float cutoff = maxBrightness * 256.0f / 5.0f;
+        if (quadratic <= 0.0f) {
+            return linear > 0.0f ? (cutoff - constant) / linear : 1000.0f;
+        }
+        float discriminant = linear * linear - 4.0f * quadratic * (constant - cutoff);
+        if (discriminant <= 0.0f) {
+            return 0.0f;
+        }
+        return (-linear + std::sqrt(discriminant)) / (2.0f * quadratic);
+    }
+
+private:
+    unsigned int createColorTexture(GLenum internalFormat, GLenum format, GLenum type, const char *label) {
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, m_Width, m_Height, 0, format, type, NULL);
+        gpuMemory().track(GpuMemory::Kind::Texture, texture, "render targets",
+                          GpuMemory::textureBytes(internalFormat, m_Width, m_Height), label);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        return texture;
+    }
+
+    void destroyTargets() {
+        if (m_GBuffer == 0) {
+            return;
+        }
+        unsigned int textures[4] = {m_Position, m_Normal, m_AlbedoSpecular, m_Light};
+        for (unsigned int texture : textures) {
+            gpuMemory().release(GpuMemory::Kind::Texture, texture);
+        }
+        gpuMemory().release(GpuMemory::Kind::Renderbuffer, m_Depth);
+        glDeleteTextures(4, textures);
+        glDeleteRenderbuffers(1, &m_Depth);
+        glDeleteFramebuffers(1, &m_GBuffer);
+        glDeleteFramebuffers(1, &m_LightBuffer);
+        m_GBuffer = m_LightBuffer = 0;
+    }
+
+    void createSphere(unsigned int segments, unsigned int rings) {
+        // scale so the flat faces of the tessellated sphere still enclose the unit sphere
+        const float PI = 3.14159265359f;
+        float scale = 1.0f / std::cos(PI / rings);
+        std::vector<float> vertices;
+        std::vector<unsigned int> indices;
+        for (unsigned int y = 0; y <= rings; ++y) {
+            float theta = PI * y / rings;
+            for (unsigned int x = 0; x <= segments; ++x) {
+                float phi = 2.0f * PI * x / segments;
+                vertices.push_back(scale * std::sin(theta) * std::cos(phi));
+                vertices.push_back(scale * std::cos(theta));
+                vertices.push_back(scale * std::sin(theta) * std::sin(phi));
+            }
+        }
+        for (unsigned int y = 0; y < rings; ++y) {
+            for (unsigned int x = 0; x < segments; ++x) {
+                unsigned int current = y * (segments + 1) + x;
+                unsigned int below = current + segments + 1;
+                indices.push_back(current);
+                indices.push_back(current + 1);
+                indices.push_back(below);
+                indices.push_back(current + 1);
+                indices.push_back(below + 1);
+                indices.push_back(below);
+            }
+        }
+        m_SphereIndexCount = indices.size();
+
+        glGenVertexArrays(1, &m_SphereVAO);
+        glGenBuffers(1, &m_SphereVBO);
+        glGenBuffers(1, &m_SphereEBO);
+        glState().bindVertexArray(m_SphereVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, m_SphereVBO);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), &vertices[0], GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_SphereEBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+        gpuMemory().track(GpuMemory::Kind::Buffer, m_SphereVBO, "scene geometry", vertices.size() * sizeof(float),
+                          "light volume sphere");
+        gpuMemory().track(GpuMemory::Kind::Buffer, m_SphereEBO, "scene geometry", indices.size() * sizeof(unsigned int),
+                          "light volume sphere indices");
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    }
+
+    int m_Width = 0;
+    int m_Height = 0;
+    unsigned int m_GBuffer = 0;
+    unsigned int m_Position = 0;
+    unsigned int m_Normal = 0;
+    unsigned int m_AlbedoSpecular = 0;
+    unsigned int m_Depth = 0;
+    unsigned int m_LightBuffer = 0;
+    unsigned int m_Light = 0;
+
+    unsigned int m_SphereVAO = 0;
+    unsigned int m_SphereVBO = 0;
+    unsigned int m_SphereEBO = 0;
+    unsigned int m_SphereIndexCount = 0;
+    unsigned int m_QuadVAO = 0;
+    unsigned int m_QuadVBO = 0;
+};
+
+};
+
+#endif //PROJECT_BASE_DEFERREDRENDERER_H
@@ -0,0 +1,75 @@
+#ifndef PROJECT_BASE_DYNAMICRESOLUTION_H
+#define PROJECT_BASE_DYNAMICRESOLUTION_H
+
+#include <algorithm>
+#include <cmath>
+
+namespace rg {
+
+// Picks the render scale (fraction of the output's width and height) that keeps the GPU frame time
+// under a target. Frames cost roughly scale^2, so after averaging a window of frames the scale moves
+// by sqrt(budget / time), aiming a little under the target so it doesn't oscillate around it.
+// Scales are quantized to Step and held for a while after every change, each change reallocates the
+// render targets and the GPU times lag a few frames behind (see GpuFrameTimer).
+class DynamicResolution {
+public:
+    static constexpr float Step = 0.05f;
+    static constexpr int SettleFrames = 8; // samples after a change that may still be from the old scale
+    static constexpr int WindowFrames = 30;
+    static constexpr double Headroom = 0.9;
+
+    DynamicResolution(float minScale = 0.5f, float maxScale = 1.0f) : m_MinScale(minScale), m_MaxScale(maxScale) {
+    }
+
+    // starts measuring again, after the scale was changed from outside
+    void reset() {
+        m_Samples = 0;
+        m_Total = 0.0;
+    }
+
+    // feeds one frame's GPU time, returns the scale to render at. It only changes after a full window
+    // over or well under the target.
+    float update(float scale, double gpuMs, double targetMs) {
+        if (++m_Samples <= SettleFrames) {
+            return scale;
+        }
+        m_Total += gpuMs;
+        if (m_Samples < SettleFrames + WindowFrames) {
+            return scale;
+        }
+        double average = m_Total / WindowFrames;
+        reset();
+        if (average <= 0.0 || targetMs <= 0.0 || (average <= targetMs && average >= 0.75 * targetMs)) {
+            return scale;
+        }
+
+        float wanted = scale * (float) std::sqrt(Headroom * targetMs / average);
+        // rounded down, an overshoot costs a late frame while an undershoot only a little sharpness
+        wanted = std::floor(wanted / Step + 0.001f) * Step;
+        wanted = std::min(std::max(wanted, m_MinScale), m_MaxScale);
+        return wanted;
+    }
+
+    float minScale() const {
+        return m_MinScale;
+    }
+
+    float maxScale() const {
+        return m_MaxScale;
+    }
+
+    // a scaled dimension, at least one pixel
+    static int scaledSize(int size, float scale) {
+        return std::max(1, (int) std::lround(size * scale));
+    }
+
+private:
+    float m_MinScale;
+    float m_MaxScale;
+    int m_Samples = 0;
+    double m_Total = 0.0;
+};
+
+};
+
+#endif //PROJECT_BASE_DYNAMICRESOLUTION_H
@@ -0,0 +1,115 @@
+#ifndef PROJECT_BASE_FRAMEPACER_H
+#define PROJECT_BASE_FRAMEPACER_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+namespace rg {
+
+// how buffer swaps wait for the display
+enum class SwapMode {
+    VSync,    // swap interval 1
+    Adaptive, // swap interval -1: vsync, but a late frame is shown right away (EXT_swap_control_tear)
+    Uncapped  // swap interval 0
+};
+
+// Accumulates real frame time and hands it out in fixed simulation steps, so motion doesn't depend on
+// the frame rate. Rendering interpolates between the last two steps with alpha().
+class FixedTimestep {
+public:
+    explicit FixedTimestep(double step, int maxSteps = 8) : m_Step(step), m_MaxSteps(maxSteps) {
+    }
+
+    // adds the elapsed real time, returns how many steps to simulate now. A frame slower than maxSteps
+    // steps drops the rest instead of falling further behind every frame.
+    int advance(double elapsed) {
+        m_Accumulator += std::max(elapsed, 0.0);
+        int steps = (int) (m_Accumulator / m_Step);
+        if (steps > m_MaxSteps) {
+            steps = m_MaxSteps;
+            m_Accumulator = std::fmod(m_Accumulator, m_Step) + steps * m_Step;
+        }
+        m_Accumulator -= steps * m_Step;
+        m_Time += steps * m_Step;
+        return steps;
+    }
+
+    double step() const {
+        return m_Step;
+    }
+
+    // simulated time after the last step
+    double time() const {
+        return m_Time;
+    }
+
+    // how far the render time is past the last step, in [0, 1)
+    float alpha() const {
+        return (float) (m_Accumulator / m_Step);
+    }
+
+    // the time being rendered, between the last two steps
+    double renderTime() const {
+        return m_Time - (1.0 - alpha()) * m_Step;
+    }
+
+private:
+    double m_Step;
+    int m_MaxSteps;
+    double m_Accumulator = 0.0;
+    double m_Time = 0.0;
+};
+
+// Caps the frame rate by waiting for a deadline that advances by exactly one period per frame, so
+// the average rate doesn't drift with the wake-up latency. sleep_for only gets close to the deadline
+// (the scheduler can oversleep by a millisecond or more), the rest is spent yielding.
+class FrameLimiter {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // 0 turns the limiter off
+    void setTargetFps(int fps) {
+        if (fps == m_TargetFps)
+            return;
+        m_TargetFps = fps;
+        m_Deadline = Clock::time_point();
+    }
+
+    int targetFps() const {
+        return m_TargetFps;
+    }
+
+    // blocks until the current frame's period is over
+    void wait() {
+        if (m_TargetFps <= 0)
+            return;
+        Clock::duration period = std::chrono::duration_cast<Clock::duration>(
+                std::chrono::duration<double>(1.0 / m_TargetFps));
+        Clock::time_point now = Clock::now();
+        m_Deadline += period;
+        // first frame, or more than a frame late (a hitch, a resize): restart the schedule from now
+        // instead of rendering a burst of frames to catch up
+        if (m_Deadline < now - period || m_Deadline > now + period) {
+            m_Deadline = now;
+            return;
+        }
+        if (m_Deadline - now > SpinWindow)
+            std::this_thread::sleep_for(m_Deadline - now - SpinWindow);
+        while (Clock::now() < m_Deadline)
+            std::this_thread::yield();
+    }
+
+private:
+    static constexpr std::chrono::microseconds SpinWindow{1500};
+
+    int m_TargetFps = 0;
+    Clock::time_point m_Deadline;
+};
+
+constexpr std::chrono::microseconds FrameLimiter::SpinWindow;
+
+};
+
+#endif //PROJECT_BASE_FRAMEPACER_H
@@ -0,0 +1,126 @@
+#ifndef PROJECT_BASE_FRAMEPIPELINE_H
+#define PROJECT_BASE_FRAMEPIPELINE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+namespace rg {
+
+// Three slots handed between one producer and one consumer without a lock: the producer fills the
+// back slot and swaps it with the middle one, the consumer swaps its front slot with the middle one
+// when a newer slot was published. Neither side ever touches the slot the other one is using.
+template<typename T>
+class TripleBuffer {
+public:
+    // producer: the slot to fill, stays the producer's until publish()
+    T &writeBuffer() {
+        return m_Slots[m_Back];
+    }
+
+    void publish() {
+        m_Back = m_Middle.exchange(m_Back | Fresh, std::memory_order_acq_rel) & Index;
+    }
+
+    // consumer: takes the newest published slot, false if nothing was published since the last call
+    bool acquire() {
+        if (!(m_Middle.load(std::memory_order_relaxed) & Fresh)) {
+            return false;
+        }
+        m_Front = m_Middle.exchange(m_Front, std::memory_order_acq_rel) & Index;
+        return true;
+    }
+
+    // consumer: the slot taken by the last acquire(), valid until the next one
+    const T &readBuffer() const {
+        return m_Slots[m_Front];
+    }
+
+private:
+    static const unsigned int Index = 3;
+    static const unsigned int Fresh = 4;
+
+    T m_Slots[3];
+    unsigned int m_Back = 0;
+    std::atomic<unsigned int> m_Middle{1};
+    unsigned int m_Front = 2;
+};
+
+// Two stage frame pipeline between the render thread and a simulation thread. The render thread
+// takes packet N, posts the request for N + 1 and renders N while the simulation builds N + 1:
+//
+//     render:      request(0); loop { packet = waitPacket(); request(next); render(packet); }
+//     simulation:  while (waitRequest(request)) { build(packet(), request); publish(); }
+//
+// Requests and packets are exchanged through atomics only; an idle side spins briefly, then sleeps
+// in short slices instead of blocking on a lock the other side would have to take every frame.
+template<typename Request, typename Packet>
+class FramePipeline {
+public:
+    // render thread: the request for the next packet. Only call it once the packet of the previous
+    // request was taken, the simulation has copied that request by then
+    void request(const Request &request) {
+        m_Request = request;
+        m_Requested.fetch_add(1, std::memory_order_release);
+    }
+
+    // render thread: waits for the packet of the oldest outstanding request. Returns NULL when the
+    // pipeline was stopped
+    const Packet *waitPacket() {
+        unsigned int spins = 0;
+        while (!m_Packets.acquire()) {
+            if (m_Stopped.load(std::memory_order_acquire)) {
+                return nullptr;
+            }
+            backoff(spins);
+        }
+        return &m_Packets.readBuffer();
+    }
+
+    // simulation thread: copies out the next request, false once the pipeline was stopped
+    bool waitRequest(Request &request) {
+        unsigned int spins = 0;
+        while (m_Requested.load(std::memory_order_acquire) == m_Served) {
+            if (m_Stopped.load(std::memory_order_acquire)) {
+                return false;
+            }
+            backoff(spins);
+        }
+        request = m_Request;
+        ++m_Served;
+        return true;
+    }
+
+    // simulation thread: the packet to fill for the request just taken
+    Packet &packet() {
+        return m_Packets.writeBuffer();
+    }
+
+    void publish() {
+        m_Packets.publish();
+    }
+
+    void stop() {
+        m_Stopped.store(true, std::memory_order_release);
+    }
+
+private:
+    static void backoff(unsigned int &spins) {
+        if (++spins < 64) {
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+
+    TripleBuffer<Packet> m_Packets;
+    Request m_Request;
+    std::atomic<std::uint64_t> m_Requested{0};
+    std::uint64_t m_Served = 0;
+    std::atomic<bool> m_Stopped{false};
+};
+
+};
+
+#endif //PROJECT_BASE_FRAMEPIPELINE_H
@@ -0,0 +1,196 @@
+#ifndef PROJECT_BASE_GLSTATE_H
+#define PROJECT_BASE_GLSTATE_H
+
+#include <glad/glad.h>
+#include <rg/Error.h>
+
+namespace rg {
+
+// Thin shadow of the GL state the render loop touches. Every setter compares against the
+// last value it issued and drops the call if nothing would change. Code that changes state
+// behind its back (ImGui, resource loading) has to call invalidate() afterwards.
+class GLState {
+public:
+    static const unsigned int MaxTextureUnits = 32;
+
+    void useProgram(unsigned int program) {
+        if (m_Program == program) {
+            ++m_Filtered;
+            return;
+        }
+        glUseProgram(program);
+        m_Program = program;
+        ++m_Issued;
+    }
+
+    void bindVertexArray(unsigned int vao) {
+        if (m_VertexArray == vao) {
+            ++m_Filtered;
+            return;
+        }
+        glBindVertexArray(vao);
+        m_VertexArray = vao;
+        ++m_Issued;
+    }
+
+    void activeTexture(unsigned int unit) {
+        ASSERT(unit < MaxTextureUnits, "Texture unit out of range");
+        if (m_ActiveUnit == unit) {
+            ++m_Filtered;
+            return;
+        }
+        glActiveTexture(GL_TEXTURE0 + unit);
+        m_ActiveUnit = unit;
+        ++m_Issued;
+    }
+
+    // binds the texture to the given unit, switching the active unit only when the binding changes
+    void bindTexture(GLenum target, unsigned int unit, unsigned int texture) {
+        ASSERT(unit < MaxTextureUnits, "Texture unit out of range");
+        ASSERT(target == GL_TEXTURE_2D || target == GL_TEXTURE_CUBE_MAP, "Only 2D and cube map textures are tracked");
+        unsigned int& bound = target == GL_TEXTURE_CUBE_MAP ? m_CubeTextures[unit] : m_Textures[unit];
+        if (bound == texture) {
+            ++m_Filtered;
+            return;
+        }
+        activeTexture(unit);
+        glBindTexture(target, texture);
+        bound = texture;
+        ++m_Issued;
+    }
+
+    void enable(GLenum capability) {
+        setCapability(capability, true);
+    }
+
+    void disable(GLenum capability) {
+        setCapability(capability, false);
+    }
+
+    void blendFunc(GLenum source, GLenum destination) {
+        if (m_BlendSource == source && m_BlendDestination == destination) {
+            ++m_Filtered;
+            return;
+        }
+        glBlendFunc(source, destination);
+        m_BlendSource = source;
+        m_BlendDestination = destination;
+        ++m_Issued;
+    }
+
+    void depthFunc(GLenum function) {
+        if (m_DepthFunc == function) {
+            ++m_Filtered;
+            return;
+        }
+        glDepthFunc(function);
+        m_DepthFunc = function;
+        ++m_Issued;
+    }
+
+    // forget everything, the next call of each kind always reaches the driver
+    void invalidate() {
+        m_Program = Unknown;
+        m_VertexArray = Unknown;
+        m_ActiveUnit = Unknown;
+        for (unsigned int i = 0; i < MaxTextureUnits; ++i) {
+            m_Textures[i] = Unknown;
+            m_CubeTextures[i] = Unknown;
+        }
+        for (int& capability : m_Capabilities) {
+            capability = -1;
+        }
+        m_BlendSource = m_BlendDestination = Unknown;
+        m_DepthFunc = Unknown;
+    }
+
+    // closes the frame's counters; the values stay readable until the next endFrame()
+    void endFrame() {
+        m_LastFrameFiltered = m_Filtered;
+        m_LastFrameIssued = m_Issued;
+        m_Filtered = m_Issued = 0;
+    }
+
+    unsigned int filteredCallsLastFrame() const {
+        return m_LastFrameFiltered;
+    }
+
+    unsigned int issuedCallsLastFrame() const {
+        return m_LastFrameIssued;
+    }
+
+private:
+    static const unsigned int Unknown = 0xFFFFFFFFu;
+
+    enum Capability {
+        DepthTest,
+        CullFace,
+        Blend,
+        Multisample,
+        StencilTest,
+        CapabilityCount
+    };
+
+    static int capabilityIndex(GLenum capability) {
+        switch (capability) {
+            case GL_DEPTH_TEST: return DepthTest;
+            case GL_CULL_FACE: return CullFace;
+            case GL_BLEND: return Blend;
+            case GL_MULTISAMPLE: return Multisample;
+            case GL_STENCIL_TEST: return StencilTest;
+        }
+        ASSERT(false, "Untracked capability passed to GLState");
+        return -1;
+    }
+
+    void setCapability(GLenum capability, bool enabled) {
+        int& current = m_Capabilities[capabilityIndex(capability)];
+        if (current == (int) enabled) {
+            ++m_Filtered;
+            return;
+        }
+        if (enabled) {
+            glEnable(capability);
+        } else {
+            glDisable(capability);
+        }
+        current = enabled;
+        ++m_Issued;
+    }
+
+    unsigned int m_Program = Unknown;
+    unsigned int m_VertexArray = Unknown;
+    unsigned int m_ActiveUnit = Unknown;
+    unsigned int m_Textures[MaxTextureUnits] = {
+            Unknown, Unknown, Unknown, Unknown, Unknown, Unknown, Unknown, Unknown,
+            Unknown, Unknown, Unknown, Unknown, Unknown, Unknown, Unknown, Unknown,
+            Unknown, Unknown, Unknown, Unknown, Unknown, Unknown, Unknown, Unknown,
+            Unknown, Unknown, Unknown, Unknown, Unknown, Unknown, Unknown, Unknown
+    };
+    unsigned int m_CubeTextures[MaxTextureUnits] = {
+            Unknown, Unknown, Unknown, Unknown, Unknown, Unknown, Unknown, Unknown,
+            Unknown, Unknown, Unknown, Unknown, Unknown, Unknown, Unknown, Unknown,
+            Unknown, Unknown, Unknown, Unknown, Unknown, Unknown, Unknown, Unknown,
+            Unknown, Unknown, Unknown, Unknown, Unknown, Unknown, Unknown, Unknown
+    };
+    int m_Capabilities[CapabilityCount] = {-1, -1, -1, -1, -1};
+    GLenum m_BlendSource = Unknown;
+    GLenum m_BlendDestination = Unknown;
+    GLenum m_DepthFunc = Unknown;
+
+    unsigned int m_Filtered = 0;
+    unsigned int m_Issued = 0;
+    unsigned int m_LastFrameFiltered = 0;
+    unsigned int m_LastFrameIssued = 0;
+};
+
+GLState& glState();
+
+GLState& glState() {
+    static GLState state;
+    return state;
+}
+
+};
+
+#endif //PROJECT_BASE_GLSTATE_H
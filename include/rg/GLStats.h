@@ -0,0 +1,316 @@
+#ifndef PROJECT_BASE_GLSTATS_H
+#define PROJECT_BASE_GLSTATS_H
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <ostream>
+#include <rg/Error.h>
+
+namespace rg {
+
+struct GLFrameStats {
+    std::uint64_t drawCalls = 0;
+    std::uint64_t triangles = 0;
+    std::uint64_t uniformUploads = 0;
+    std::uint64_t uniformLookups = 0;
+    std::uint64_t textureBinds = 0;
+    std::uint64_t programSwitches = 0;
+    std::uint64_t bufferBytes = 0;
+    std::uint64_t errors = 0;
+};
+
+// Counts what the frame asks of the driver. install() swaps the glad function pointers of the
+// counted entry points for wrappers that bump a counter and forward to the driver, so every
+// call is seen no matter which layer issued it (GLState, Shader, Mesh, ImGui backend).
+// GL calls come from the main thread only, the counters are plain integers.
+class GLStats {
+public:
+    // call once, right after gladLoadGLLoader
+    void install();
+
+    // closes the frame's counters and reads the error flags the frame left behind;
+    // the values stay readable until the next endFrame()
+    void endFrame() {
+        while (glGetError() != GL_NO_ERROR) {
+            ;
+        }
+        m_LastFrame = m_Current;
+        add(m_Total, m_Current);
+        ++m_Frames;
+        m_Current = GLFrameStats();
+    }
+
+    const GLFrameStats &lastFrame() const {
+        return m_LastFrame;
+    }
+
+    // mean over every frame closed so far, rounded to whole calls
+    GLFrameStats average() const {
+        GLFrameStats average;
+        if (m_Frames == 0) {
+            return average;
+        }
+        auto mean = [this](std::uint64_t total) { return (total + m_Frames / 2) / m_Frames; };
+        average.drawCalls = mean(m_Total.drawCalls);
+        average.triangles = mean(m_Total.triangles);
+        average.uniformUploads = mean(m_Total.uniformUploads);
+        average.uniformLookups = mean(m_Total.uniformLookups);
+        average.textureBinds = mean(m_Total.textureBinds);
+        average.programSwitches = mean(m_Total.programSwitches);
+        average.bufferBytes = mean(m_Total.bufferBytes);
+        average.errors = mean(m_Total.errors);
+        return average;
+    }
+
+    // one JSON object in the layout of writeTimingJson
+    static void writeJson(std::ostream &out, const char *name, const GLFrameStats &stats, bool last) {
+        out << "  \"" << name << "\": {\n"
+            << "    \"draw_calls\": " << stats.drawCalls << ",\n"
+            << "    \"triangles\": " << stats.triangles << ",\n"
+            << "    \"uniform_uploads\": " << stats.uniformUploads << ",\n"
+            << "    \"uniform_lookups\": " << stats.uniformLookups << ",\n"
+            << "    \"texture_binds\": " << stats.textureBinds << ",\n"
+            << "    \"program_switches\": " << stats.programSwitches << ",\n"
+            << "    \"buffer_bytes\": " << stats.bufferBytes << ",\n"
+            << "    \"gl_errors\": " << stats.errors << "\n"
+            << "  }" << (last ? "\n" : ",\n");
+    }
+
+private:
+    static void add(GLFrameStats &total, const GLFrameStats &frame) {
+        total.drawCalls += frame.drawCalls;
+        total.triangles += frame.triangles;
+        total.uniformUploads += frame.uniformUploads;
+        total.uniformLookups += frame.uniformLookups;
+        total.textureBinds += frame.textureBinds;
+        total.programSwitches += frame.programSwitches;
+        total.bufferBytes += frame.bufferBytes;
+        total.errors += frame.errors;
+    }
+
+    static std::uint64_t primitives(GLenum mode, GLsizei count) {
+        switch (mode) {
+            case GL_TRIANGLES: return count / 3;
+            case GL_TRIANGLE_STRIP:
+            case GL_TRIANGLE_FAN: return count > 2 ? count - 2 : 0;
+        }
+        return 0;
+    }
+
+    // the driver entry points the wrappers forward to
+    struct Driver {
+        PFNGLDRAWARRAYSPROC drawArrays;
+        PFNGLDRAWELEMENTSPROC drawElements;
+        PFNGLDRAWARRAYSINSTANCEDPROC drawArraysInstanced;
+        PFNGLDRAWELEMENTSINSTANCEDPROC drawElementsInstanced;
+        PFNGLUSEPROGRAMPROC useProgram;
+        PFNGLBINDTEXTUREPROC bindTexture;
+        PFNGLBUFFERDATAPROC bufferData;
+        PFNGLBUFFERSUBDATAPROC bufferSubData;
+        PFNGLGETUNIFORMLOCATIONPROC getUniformLocation;
+        PFNGLGETERRORPROC getError;
+        PFNGLUNIFORM1IPROC uniform1i;
+        PFNGLUNIFORM1FPROC uniform1f;
+        PFNGLUNIFORM2FPROC uniform2f;
+        PFNGLUNIFORM2FVPROC uniform2fv;
+        PFNGLUNIFORM3FPROC uniform3f;
+        PFNGLUNIFORM3FVPROC uniform3fv;
+        PFNGLUNIFORM4FPROC uniform4f;
+        PFNGLUNIFORM4FVPROC uniform4fv;
+        PFNGLUNIFORMMATRIX2FVPROC uniformMatrix2fv;
+        PFNGLUNIFORMMATRIX3FVPROC uniformMatrix3fv;
+        PFNGLUNIFORMMATRIX4FVPROC uniformMatrix4fv;
+    };
+
+    static Driver s_Driver;
+    static GLFrameStats *s_Current;
+
+    static void APIENTRY drawArrays(GLenum mode, GLint first, GLsizei count) {
+        ++s_Current->drawCalls;
+        s_Current->triangles += primitives(mode, count);
+        s_Driver.drawArrays(mode, first, count);
+    }
+
+    static void APIENTRY drawElements(GLenum mode, GLsizei count, GLenum type, const void *indices) {
+        ++s_Current->drawCalls;
+        s_Current->triangles += primitives(mode, count);
+        s_Driver.drawElements(mode, count, type, indices);
+    }
+
+    static void APIENTRY drawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instances) {
+        ++s_Current->drawCalls;
+        s_Current->triangles += primitives(mode, count) * instances;
+        s_Driver.drawArraysInstanced(mode, first, count, instances);
+    }
+
+    static void APIENTRY drawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void *indices,
+                                               GLsizei instances) {
+        ++s_Current->drawCalls;
+        s_Current->triangles += primitives(mode, count) * instances;
+        s_Driver.drawElementsInstanced(mode, count, type, indices, instances);
+    }
+
+    static void APIENTRY useProgram(GLuint program) {
+        ++s_Current->programSwitches;
+        s_Driver.useProgram(program);
+    }
+
+    static void APIENTRY bindTexture(GLenum target, GLuint texture) {
+        ++s_Current->textureBinds;
+        s_Driver.bindTexture(target, texture);
+    }
+
+    static void APIENTRY bufferData(GLenum target, GLsizeiptr size, const void *data, GLenum usage) {
+        // a null pointer only allocates (or orphans), nothing crosses the bus
+        if (data) {
+            s_Current->bufferBytes += size;
+        }
+        s_Driver.bufferData(target, size, data, usage);
+    }
+
+    static void APIENTRY bufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void *data) {
+        s_Current->bufferBytes += size;
+        s_Driver.bufferSubData(target, offset, size, data);
+    }
+
+    static GLint APIENTRY getUniformLocation(GLuint program, const GLchar *name) {
+        ++s_Current->uniformLookups;
+        return s_Driver.getUniformLocation(program, name);
+    }
+
+    static GLenum APIENTRY getError() {
+        GLenum error = s_Driver.getError();
+        if (error != GL_NO_ERROR) {
+            ++s_Current->errors;
+        }
+        return error;
+    }
+
+    static void APIENTRY uniform1i(GLint location, GLint v0) {
+        ++s_Current->uniformUploads;
+        s_Driver.uniform1i(location, v0);
+    }
+
+    static void APIENTRY uniform1f(GLint location, GLfloat v0) {
+        ++s_Current->uniformUploads;
+        s_Driver.uniform1f(location, v0);
+    }
+
+    static void APIENTRY uniform2f(GLint location, GLfloat v0, GLfloat v1) {
+        ++s_Current->uniformUploads;
+        s_Driver.uniform2f(location, v0, v1);
+    }
+
+    static void APIENTRY uniform2fv(GLint location, GLsizei count, const GLfloat *value) {
+        ++s_Current->uniformUploads;
+        s_Driver.uniform2fv(location, count, value);
+    }
+
+    static void APIENTRY uniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2) {
+        ++s_Current->uniformUploads;
+        s_Driver.uniform3f(location, v0, v1, v2);
+    }
+
+    static void APIENTRY uniform3fv(GLint location, GLsizei count, const GLfloat *value) {
+        ++s_Current->uniformUploads;
+        s_Driver.uniform3fv(location, count, value);
+    }
+
+    static void APIENTRY uniform4f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3) {
+        ++s_Current->uniformUploads;
+        s_Driver.uniform4f(location, v0, v1, v2, v3);
+    }
+
+    static void APIENTRY uniform4fv(GLint location, GLsizei count, const GLfloat *value) {
+        ++s_Current->uniformUploads;
+        s_Driver.uniform4fv(location, count, value);
+    }
+
+    static void APIENTRY uniformMatrix2fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value) {
+        ++s_Current->uniformUploads;
+        s_Driver.uniformMatrix2fv(location, count, transpose, value);
+    }
+
+    static void APIENTRY uniformMatrix3fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value) {
+        ++s_Current->uniformUploads;
+        s_Driver.uniformMatrix3fv(location, count, transpose, value);
+    }
+
+    static void APIENTRY uniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value) {
+        ++s_Current->uniformUploads;
+        s_Driver.uniformMatrix4fv(location, count, transpose, value);
+    }
+
+    GLFrameStats m_Current;
+    GLFrameStats m_LastFrame;
+    GLFrameStats m_Total;
+    std::uint64_t m_Frames = 0;
+    bool m_Installed = false;
+};
+
+GLStats::Driver GLStats::s_Driver;
+GLFrameStats *GLStats::s_Current = nullptr;
+
+void GLStats::install() {
+    ASSERT(glad_glDrawArrays, "GLStats::install() has to run after the GL functions are loaded");
+    if (m_Installed) {
+        return;
+    }
+    m_Installed = true;
+    s_Current = &m_Current;
+
+    s_Driver.drawArrays = glad_glDrawArrays;
+    s_Driver.drawElements = glad_glDrawElements;
+    s_Driver.drawArraysInstanced = glad_glDrawArraysInstanced;
+    s_Driver.drawElementsInstanced = glad_glDrawElementsInstanced;
+    s_Driver.useProgram = glad_glUseProgram;
+    s_Driver.bindTexture = glad_glBindTexture;
+    s_Driver.bufferData = glad_glBufferData;
+    s_Driver.bufferSubData = glad_glBufferSubData;
+    s_Driver.getUniformLocation = glad_glGetUniformLocation;
+    s_Driver.getError = glad_glGetError;
+    s_Driver.uniform1i = glad_glUniform1i;
+    s_Driver.uniform1f = glad_glUniform1f;
+    s_Driver.uniform2f = glad_glUniform2f;
+    s_Driver.uniform2fv = glad_glUniform2fv;
+    s_Driver.uniform3f = glad_glUniform3f;
+    s_Driver.uniform3fv = glad_glUniform3fv;
+    s_Driver.uniform4f = glad_glUniform4f;
+    s_Driver.uniform4fv = glad_glUniform4fv;
+    s_Driver.uniformMatrix2fv = glad_glUniformMatrix2fv;
+    s_Driver.uniformMatrix3fv = glad_glUniformMatrix3fv;
+    s_Driver.uniformMatrix4fv = glad_glUniformMatrix4fv;
+
+    glad_glDrawArrays = drawArrays;
+    glad_glDrawElements = drawElements;
+    glad_glDrawArraysInstanced = drawArraysInstanced;
+    glad_glDrawElementsInstanced = drawElementsInstanced;
+    glad_glUseProgram = useProgram;
+    glad_glBindTexture = bindTexture;
+    glad_glBufferData = bufferData;
+    glad_glBufferSubData = bufferSubData;
+    glad_glGetUniformLocation = getUniformLocation;
+    glad_glGetError = getError;
+    glad_glUniform1i = uniform1i;
+    glad_glUniform1f = uniform1f;
+    glad_glUniform2f = uniform2f;
+    glad_glUniform2fv = uniform2fv;
+    glad_glUniform3f = uniform3f;
+    glad_glUniform3fv = uniform3fv;
+    glad_glUniform4f = uniform4f;
+    glad_glUniform4fv = uniform4fv;
+    glad_glUniformMatrix2fv = uniformMatrix2fv;
+    glad_glUniformMatrix3fv = uniformMatrix3fv;
+    glad_glUniformMatrix4fv = uniformMatrix4fv;
+}
+
+GLStats& glStats();
+
+GLStats& glStats() {
+    static GLStats stats;
+    return stats;
+}
+
+};
+
+#endif //PROJECT_BASE_GLSTATS_H
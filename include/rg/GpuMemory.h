@@ -0,0 +1,223 @@
+#ifndef PROJECT_BASE_GPUMEMORY_H
+#define PROJECT_BASE_GPUMEMORY_H
+
+#include <glad/glad.h>
+#include <algorithm>
+#include <cstdint>
+#include <iomanip>
+#include <map>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace rg {
+
+// Bookkeeping of the GPU memory the engine allocates. GL can't be asked what an object costs, so
+// every creation path reports the size it requested: buffers their byte size, textures every face,
+// mip level and sample. Three channel formats are counted padded to four, the way desktop drivers
+// store them; other padding and compression aren't visible, treat the numbers as a lower bound.
+// Allocations are attributed to the innermost GpuMemoryOwner scope (e.g. the model being loaded).
+class GpuMemory {
+public:
+    enum class Kind {
+        Buffer,
+        Texture,
+        Renderbuffer,
+        Surface // window system buffers, estimated
+    };
+
+    struct Allocation {
+        Kind kind;
+        unsigned int id;
+        std::string category;
+        std::string owner;
+        std::string label;
+        std::uint64_t bytes;
+    };
+
+    // records (or resizes) the allocation of a GL object
+    void track(Kind kind, unsigned int id, const char *category, std::uint64_t bytes, std::string label = "") {
+        Allocation &allocation = m_Allocations[std::make_pair(kind, id)];
+        allocation.kind = kind;
+        allocation.id = id;
+        allocation.category = category;
+        allocation.owner = m_Owners.empty() ? "engine" : m_Owners.back();
+        allocation.label = std::move(label);
+        allocation.bytes = bytes;
+    }
+
+    // updates the size only, keeps category and owner from the first track()
+    void resize(Kind kind, unsigned int id, std::uint64_t bytes) {
+        auto allocation = m_Allocations.find(std::make_pair(kind, id));
+        if (allocation != m_Allocations.end()) {
+            allocation->second.bytes = bytes;
+        }
+    }
+
+    void release(Kind kind, unsigned int id) {
+        m_Allocations.erase(std::make_pair(kind, id));
+    }
+
+    void pushOwner(std::string owner) {
+        m_Owners.push_back(std::move(owner));
+    }
+
+    void popOwner() {
+        m_Owners.pop_back();
+    }
+
+    std::uint64_t total() const {
+        std::uint64_t bytes = 0;
+        for (const auto &allocation : m_Allocations) {
+            bytes += allocation.second.bytes;
+        }
+        return bytes;
+    }
+
+    // (name, bytes) largest first
+    std::vector<std::pair<std::string, std::uint64_t>> byCategory() const {
+        return grouped([](const Allocation &allocation) { return allocation.category; });
+    }
+
+    std::vector<std::pair<std::string, std::uint64_t>> byOwner() const {
+        return grouped([](const Allocation &allocation) { return allocation.owner; });
+    }
+
+    // the largest allocations first
+    std::vector<const Allocation *> largest(size_t count) const {
+        std::vector<const Allocation *> allocations;
+        for (const auto &allocation : m_Allocations) {
+            allocations.push_back(&allocation.second);
+        }
+        std::sort(allocations.begin(), allocations.end(), [](const Allocation *a, const Allocation *b) {
+            return a->bytes > b->bytes;
+        });
+        if (allocations.size() > count) {
+            allocations.resize(count);
+        }
+        return allocations;
+    }
+
+    size_t allocationCount() const {
+        return m_Allocations.size();
+    }
+
+    void report(std::ostream &out) const {
+        out << std::fixed << std::setprecision(2)
+            << "GPU memory: " << megabytes(total()) << " MB in " << m_Allocations.size() << " allocations\n"
+            << "by category:\n";
+        for (const auto &category : byCategory()) {
+            out << "  " << std::left << std::setw(24) << category.first << std::right << std::setw(10)
+                << megabytes(category.second) << " MB\n";
+        }
+        out << "by owner:\n";
+        for (const auto &owner : byOwner()) {
+            out << "  " << std::left << std::setw(24) << owner.first << std::right << std::setw(10)
+                << megabytes(owner.second) << " MB\n";
+        }
+        out << std::flush;
+    }
+
+    static double megabytes(std::uint64_t bytes) {
+        return bytes / (1024.0 * 1024.0);
+    }
+
+    // number of levels in a full mip chain down to 1x1
+    static int mipLevels(int width, int height) {
+        int levels = 1;
+        while (width > 1 || height > 1) {
+            width = std::max(1, width / 2);
+            height = std::max(1, height / 2);
+            ++levels;
+        }
+        return levels;
+    }
+
+    static unsigned int bytesPerTexel(GLenum internalFormat) {
+        switch (internalFormat) {
+            case GL_RED:
+            case GL_R8: return 1;
+            case GL_RG:
+            case GL_RG8: return 2;
+            case GL_RGB:
+            case GL_RGB8:
+            case GL_SRGB:
+            case GL_SRGB8:
+            case GL_RGBA:
+            case GL_RGBA8:
+            case GL_SRGB_ALPHA:
+            case GL_SRGB8_ALPHA8:
+            case GL_R32F:
+            case GL_R32UI:
+            case GL_R11F_G11F_B10F:
+            case GL_DEPTH24_STENCIL8:
+            case GL_DEPTH_COMPONENT24:
+            case GL_DEPTH_COMPONENT32F: return 4;
+            case GL_RGB16F:
+            case GL_RGBA16F:
+            case GL_RG32F:
+            case GL_RG32UI: return 8;
+            case GL_RGB32F:
+            case GL_RGBA32F: return 16;
+        }
+        return 4;
+    }
+
+    // all faces, mip levels (levels == 0: full chain) and samples of a texture or renderbuffer
+    static std::uint64_t textureBytes(GLenum internalFormat, int width, int height, int levels = 1,
+                                      int samples = 1, int faces = 1) {
+        if (levels == 0) {
+            levels = mipLevels(width, height);
+        }
+        std::uint64_t texels = 0;
+        for (int level = 0; level < levels; ++level) {
+            texels += (std::uint64_t) std::max(1, width >> level) * std::max(1, height >> level);
+        }
+        return texels * bytesPerTexel(internalFormat) * std::max(samples, 1) * faces;
+    }
+
+private:
+    template<typename Key>
+    std::vector<std::pair<std::string, std::uint64_t>> grouped(Key key) const {
+        std::map<std::string, std::uint64_t> groups;
+        for (const auto &allocation : m_Allocations) {
+            groups[key(allocation.second)] += allocation.second.bytes;
+        }
+        std::vector<std::pair<std::string, std::uint64_t>> result(groups.begin(), groups.end());
+        std::sort(result.begin(), result.end(), [](const std::pair<std::string, std::uint64_t> &a,
+                                                   const std::pair<std::string, std::uint64_t> &b) {
+            return a.second > b.second;
+        });
+        return result;
+    }
+
+    std::map<std::pair<Kind, unsigned int>, Allocation> m_Allocations;
+    std::vector<std::string> m_Owners;
+};
+
+GpuMemory& gpuMemory();
+
+GpuMemory& gpuMemory() {
+    static GpuMemory memory;
+    return memory;
+}
+
+// attributes the allocations made inside the enclosing block to an owner
+class GpuMemoryOwner {
+public:
+    explicit GpuMemoryOwner(std::string owner) {
+        gpuMemory().pushOwner(std::move(owner));
+    }
+
+    ~GpuMemoryOwner() {
+        gpuMemory().popOwner();
+    }
+
+    GpuMemoryOwner(const GpuMemoryOwner&) = delete;
+    GpuMemoryOwner& operator=(const GpuMemoryOwner&) = delete;
+};
+
+};
+
+#endif //PROJECT_BASE_GPUMEMORY_H
@@ -0,0 +1,125 @@
+#ifndef PROJECT_BASE_HEADLESSCONTEXT_H
+#define PROJECT_BASE_HEADLESSCONTEXT_H
+
+#include <iostream>
+
+#ifdef RG_HEADLESS_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <cstring>
+#endif
+
+namespace rg {
+
+// OpenGL 3.3 core context without a window or any surface, for batch and benchmark runs on
+// machines without a display. Uses EGL with Mesa's surfaceless platform when it is available,
+// which together with LIBGL_ALWAYS_SOFTWARE=1 runs on llvmpipe without a GPU. Everything is
+// rendered into framebuffer objects, the context has no default framebuffer.
+class HeadlessContext {
+public:
+    HeadlessContext() = default;
+    HeadlessContext(const HeadlessContext&) = delete;
+    HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+    ~HeadlessContext() {
+        destroy();
+    }
+
+    // creates the context and makes it current, returns false with a message on failure
+    bool create() {
+#ifdef RG_HEADLESS_EGL
+        m_Display = EGL_NO_DISPLAY;
+        const char *clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+        if (clientExtensions && std::strstr(clientExtensions, "EGL_MESA_platform_surfaceless")) {
+            auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+            if (getPlatformDisplay) {
+                m_Display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+            }
+        }
+        if (m_Display == EGL_NO_DISPLAY) {
+            m_Display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        }
+        EGLint major, minor;
+        if (m_Display == EGL_NO_DISPLAY || !eglInitialize(m_Display, &major, &minor)) {
+            std::cerr << "Failed to initialize EGL display\n";
+            return false;
+        }
+        const char *displayExtensions = eglQueryString(m_Display, EGL_EXTENSIONS);
+        if (!displayExtensions || !std::strstr(displayExtensions, "EGL_KHR_surfaceless_context")) {
+            std::cerr << "EGL display does not support surfaceless contexts\n";
+            return false;
+        }
+        if (!eglBindAPI(EGL_OPENGL_API)) {
+            std::cerr << "EGL does not support desktop OpenGL\n";
+            return false;
+        }
+
+        // the default surface type is EGL_WINDOW_BIT, which surfaceless displays never offer
+        const EGLint configAttributes[] = {
+                EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+                EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+                EGL_NONE
+        };
+        EGLConfig config;
+        EGLint configCount = 0;
+        if (!eglChooseConfig(m_Display, configAttributes, &config, 1, &configCount) || configCount == 0) {
+            std::cerr << "No EGL config with desktop OpenGL support\n";
+            return false;
+        }
+
+        const EGLint contextAttributes[] = {
+                EGL_CONTEXT_MAJOR_VERSION, 3,
+                EGL_CONTEXT_MINOR_VERSION, 3,
+                EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                EGL_NONE
+        };
+        m_Context = eglCreateContext(m_Display, config, EGL_NO_CONTEXT, contextAttributes);
+        if (m_Context == EGL_NO_CONTEXT) {
+            std::cerr << "Failed to create an OpenGL 3.3 core EGL context\n";
+            return false;
+        }
+        if (!eglMakeCurrent(m_Display, EGL_NO_SURFACE, EGL_NO_SURFACE, m_Context)) {
+            std::cerr << "Failed to make the EGL context current\n";
+            return false;
+        }
+        return true;
+#else
+        std::cerr << "Headless mode is not available, the build did not find EGL\n";
+        return false;
+#endif
+    }
+
+    // loader for gladLoadGLLoader; EGL 1.5 / Mesa also resolve core functions through it
+    static void *getProcAddress(const char *name) {
+#ifdef RG_HEADLESS_EGL
+        return (void *) eglGetProcAddress(name);
+#else
+        return nullptr;
+#endif
+    }
+
+private:
+    void destroy() {
+#ifdef RG_HEADLESS_EGL
+        if (m_Display == EGL_NO_DISPLAY) {
+            return;
+        }
+        eglMakeCurrent(m_Display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (m_Context != EGL_NO_CONTEXT) {
+            eglDestroyContext(m_Display, m_Context);
+        }
+        eglTerminate(m_Display);
+        m_Display = EGL_NO_DISPLAY;
+        m_Context = EGL_NO_CONTEXT;
+#endif
+    }
+
+#ifdef RG_HEADLESS_EGL
+    EGLDisplay m_Display = EGL_NO_DISPLAY;
+    EGLContext m_Context = EGL_NO_CONTEXT;
+#endif
+};
+
+};
+
+#endif //PROJECT_BASE_HEADLESSCONTEXT_H
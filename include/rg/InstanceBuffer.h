@@ -0,0 +1,70 @@
+#ifndef PROJECT_BASE_INSTANCEBUFFER_H
+#define PROJECT_BASE_INSTANCEBUFFER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <vector>
+#include <rg/GpuMemory.h>
+
+namespace rg {
+
+// the matrix that takes normals to world space, transpose(inverse(mat3(model)))
+inline glm::mat3 normalMatrix(const glm::mat4 &model) {
+    return glm::transpose(glm::inverse(glm::mat3(model)));
+}
+
+// Per-instance model matrices of one VAO, feeding attribute locations 5-8 (see model_instanced.vs),
+// and their normal matrices on locations 9-11, so the vertex shader doesn't invert a matrix per vertex.
+// The buffer is created on first use and grows when needed, smaller uploads reuse it.
+class InstanceBuffer {
+public:
+    // expects the VAO the matrices belong to to be bound
+    void upload(const glm::mat4 *models, size_t count) {
+        if (m_Buffer == 0) {
+            glGenBuffers(1, &m_Buffer);
+            glBindBuffer(GL_ARRAY_BUFFER, m_Buffer);
+            // a mat4 attribute takes four consecutive vec4 locations, a mat3 three vec3 ones
+            for (unsigned int column = 0; column < 4; column++) {
+                glEnableVertexAttribArray(5 + column);
+                glVertexAttribPointer(5 + column, 4, GL_FLOAT, GL_FALSE, sizeof(Instance),
+                                      (void *) (offsetof(Instance, model) + column * sizeof(glm::vec4)));
+                glVertexAttribDivisor(5 + column, 1);
+            }
+            for (unsigned int column = 0; column < 3; column++) {
+                glEnableVertexAttribArray(9 + column);
+                glVertexAttribPointer(9 + column, 3, GL_FLOAT, GL_FALSE, sizeof(Instance),
+                                      (void *) (offsetof(Instance, normal) + column * sizeof(glm::vec3)));
+                glVertexAttribDivisor(9 + column, 1);
+            }
+        }
+        m_Instances.resize(count);
+        for (size_t i = 0; i < count; i++) {
+            m_Instances[i].model = models[i];
+            m_Instances[i].normal = normalMatrix(models[i]);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, m_Buffer);
+        if (count > m_Capacity) {
+            m_Capacity = count;
+            glBufferData(GL_ARRAY_BUFFER, m_Capacity * sizeof(Instance), m_Instances.data(), GL_STREAM_DRAW);
+            gpuMemory().track(GpuMemory::Kind::Buffer, m_Buffer, "instances", m_Capacity * sizeof(Instance));
+        } else {
+            glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(Instance), m_Instances.data());
+        }
+    }
+
+private:
+    struct Instance {
+        glm::mat4 model;
+        glm::mat3 normal;
+    };
+
+    unsigned int m_Buffer = 0;
+    size_t m_Capacity = 0;
+    // the interleaved upload, kept so streaming the matrices every frame doesn't allocate
+    std::vector<Instance> m_Instances;
+};
+
+};
+
+#endif //PROJECT_BASE_INSTANCEBUFFER_H
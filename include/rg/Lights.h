@@ -0,0 +1,136 @@
+#ifndef PROJECT_BASE_LIGHTS_H
+#define PROJECT_BASE_LIGHTS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <rg/GpuMemory.h>
+
+// The light structs of resources/shaders/lights.glsl. Members are ordered and padded so the structs
+// have their std140 layout (vec3 aligned to 16 bytes, a float fills the rest of a vec3's slot) and
+// can be copied into a uniform buffer as they are; checkLightsLayout compares with the linker.
+struct PointLight {
+    glm::vec3 position;
+    float constant;
+    glm::vec3 ambient;
+    float linear;
+    glm::vec3 diffuse;
+    float quadratic;
+    glm::vec3 specular;
+    float padding = 0.0f;
+};
+
+struct DirLight {
+    glm::vec3 direction;
+    float padding0 = 0.0f;
+    glm::vec3 ambient;
+    float padding1 = 0.0f;
+    glm::vec3 diffuse;
+    float padding2 = 0.0f;
+    glm::vec3 specular;
+    float padding3 = 0.0f;
+};
+
+static_assert(sizeof(glm::vec3) == 12, "the light structs expect a tightly packed glm::vec3");
+static_assert(sizeof(PointLight) == 64 && sizeof(DirLight) == 64, "light structs must keep their std140 size");
+
+namespace rg {
+
+// the Lights uniform block of resources/shaders/scene_lights.glsl
+struct LightsBlock {
+    static const unsigned int PointLightCount = 2;
+
+    DirLight dirLight;
+    PointLight pointLights[PointLightCount];
+};
+
+// uniform buffer binding point of the Lights block
+const unsigned int LightsBinding = 0;
+
+// If the program has a Lights block, binds it to LightsBinding and checks every member's offset and
+// the block size against LightsBlock. Returns false (and prints the first difference) when the GLSL
+// and C++ declarations disagree; programs without the block pass.
+inline bool checkLightsLayout(unsigned int program, const std::string &name) {
+    unsigned int block = glGetUniformBlockIndex(program, "Lights");
+    if (block == GL_INVALID_INDEX) {
+        return true;
+    }
+    glUniformBlockBinding(program, block, LightsBinding);
+
+    struct Member {
+        std::string name;
+        size_t offset;
+    };
+    std::vector<Member> members = {
+            {"dirLight.direction", offsetof(LightsBlock, dirLight) + offsetof(DirLight, direction)},
+            {"dirLight.ambient",   offsetof(LightsBlock, dirLight) + offsetof(DirLight, ambient)},
+            {"dirLight.diffuse",   offsetof(LightsBlock, dirLight) + offsetof(DirLight, diffuse)},
+            {"dirLight.specular",  offsetof(LightsBlock, dirLight) + offsetof(DirLight, specular)},
+    };
+    for (unsigned int i = 0; i < LightsBlock::PointLightCount; i++) {
+        std::string light = "pointLights[" + std::to_string(i) + "].";
+        size_t base = offsetof(LightsBlock, pointLights) + i * sizeof(PointLight);
+        members.push_back({light + "position", base + offsetof(PointLight, position)});
+        members.push_back({light + "constant", base + offsetof(PointLight, constant)});
+        members.push_back({light + "ambient", base + offsetof(PointLight, ambient)});
+        members.push_back({light + "linear", base + offsetof(PointLight, linear)});
+        members.push_back({light + "diffuse", base + offsetof(PointLight, diffuse)});
+        members.push_back({light + "quadratic", base + offsetof(PointLight, quadratic)});
+        members.push_back({light + "specular", base + offsetof(PointLight, specular)});
+    }
+
+    GLint size = 0;
+    glGetActiveUniformBlockiv(program, block, GL_UNIFORM_BLOCK_DATA_SIZE, &size);
+    if ((size_t) size != sizeof(LightsBlock)) {
+        std::cout << "ERROR::LIGHTS_LAYOUT " << name << ": block is " << size << " bytes, rg::LightsBlock "
+                  << sizeof(LightsBlock) << std::endl;
+        return false;
+    }
+    for (const Member &member : members) {
+        const char *memberName = member.name.c_str();
+        GLuint index = GL_INVALID_INDEX;
+        glGetUniformIndices(program, 1, &memberName, &index);
+        GLint offset = -1;
+        if (index != GL_INVALID_INDEX) {
+            glGetActiveUniformsiv(program, 1, &index, GL_UNIFORM_OFFSET, &offset);
+        }
+        if (offset < 0 || (size_t) offset != member.offset) {
+            std::cout << "ERROR::LIGHTS_LAYOUT " << name << ": " << member.name << " is at " << offset
+                      << ", rg::LightsBlock has it at " << member.offset << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// The uniform buffer behind the Lights block, written once per frame instead of setting the light
+// uniforms of every program that uses them.
+class LightsBuffer {
+public:
+    void update(const DirLight &dirLight, const PointLight &first, const PointLight &second) {
+        m_Block.dirLight = dirLight;
+        m_Block.pointLights[0] = first;
+        m_Block.pointLights[1] = second;
+        if (m_Buffer == 0) {
+            glGenBuffers(1, &m_Buffer);
+            glBindBuffer(GL_UNIFORM_BUFFER, m_Buffer);
+            glBufferData(GL_UNIFORM_BUFFER, sizeof(LightsBlock), &m_Block, GL_DYNAMIC_DRAW);
+            gpuMemory().track(GpuMemory::Kind::Buffer, m_Buffer, "light buffers", sizeof(LightsBlock), "Lights block");
+        } else {
+            glBindBuffer(GL_UNIFORM_BUFFER, m_Buffer);
+            glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(LightsBlock), &m_Block);
+        }
+        glBindBufferBase(GL_UNIFORM_BUFFER, LightsBinding, m_Buffer);
+    }
+
+private:
+    LightsBlock m_Block;
+    unsigned int m_Buffer = 0;
+};
+
+};
+
+#endif //PROJECT_BASE_LIGHTS_H
@@ -0,0 +1,61 @@
+#ifndef PROJECT_BASE_OFFSCREENTARGET_H
+#define PROJECT_BASE_OFFSCREENTARGET_H
+
+#include <glad/glad.h>
+#include <rg/Error.h>
+#include <rg/GpuMemory.h>
+
+namespace rg {
+
+// Framebuffer object with color (RGBA8 unless given) and depth/stencil renderbuffers (samples 0:
+// single sampled). Stands in for the window's default framebuffer when there is none, and is the
+// multisampled HDR part of rg::SceneTarget.
+class OffscreenTarget {
+public:
+    OffscreenTarget(int width, int height, int samples, GLenum colorFormat = GL_RGBA8) {
+        glGenFramebuffers(1, &m_Framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, m_Framebuffer);
+
+        glGenRenderbuffers(1, &m_Color);
+        glBindRenderbuffer(GL_RENDERBUFFER, m_Color);
+        glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, colorFormat, width, height);
+        gpuMemory().track(GpuMemory::Kind::Renderbuffer, m_Color, "render targets",
+                          GpuMemory::textureBytes(colorFormat, width, height, 1, samples), "offscreen color");
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_Color);
+
+        glGenRenderbuffers(1, &m_Depth);
+        glBindRenderbuffer(GL_RENDERBUFFER, m_Depth);
+        glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_DEPTH24_STENCIL8, width, height);
+        gpuMemory().track(GpuMemory::Kind::Renderbuffer, m_Depth, "render targets",
+                          GpuMemory::textureBytes(GL_DEPTH24_STENCIL8, width, height, 1, samples), "offscreen depth");
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_Depth);
+        ASSERT(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE, "Offscreen target is not complete!");
+
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    ~OffscreenTarget() {
+        gpuMemory().release(GpuMemory::Kind::Renderbuffer, m_Color);
+        gpuMemory().release(GpuMemory::Kind::Renderbuffer, m_Depth);
+        glDeleteRenderbuffers(1, &m_Color);
+        glDeleteRenderbuffers(1, &m_Depth);
+        glDeleteFramebuffers(1, &m_Framebuffer);
+    }
+
+    OffscreenTarget(const OffscreenTarget&) = delete;
+    OffscreenTarget& operator=(const OffscreenTarget&) = delete;
+
+    unsigned int framebuffer() const {
+        return m_Framebuffer;
+    }
+
+private:
+    unsigned int m_Framebuffer = 0;
+    unsigned int m_Color = 0;
+    unsigned int m_Depth = 0;
+};
+
+};
+
+#endif //PROJECT_BASE_OFFSCREENTARGET_H
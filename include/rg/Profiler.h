@@ -0,0 +1,403 @@
+#ifndef PROJECT_BASE_PROFILER_H
+#define PROJECT_BASE_PROFILER_H
+
+#include <glad/glad.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <rg/Error.h>
+
+namespace rg {
+
+struct ProfileEvent {
+    const char *name;
+    std::int64_t start; // nanoseconds on the profiler's clock
+    std::int64_t end;
+    unsigned int depth;
+    unsigned int thread; // registration order of the CPU thread, GpuThread for GPU events
+};
+
+struct ProfileFrame {
+    std::vector<ProfileEvent> cpu;
+    std::vector<ProfileEvent> gpu;
+    std::int64_t cpuStart = 0;
+    std::int64_t cpuEnd = 0;
+};
+
+// Hierarchical frame profiler.
+//
+// CPU scopes record into a fixed size single-producer/single-consumer ring per thread, so any
+// thread (the main loop, ThreadPool workers) can record without taking a lock; the main thread
+// drains all rings in endFrame(). GPU scopes are pairs of GL_TIMESTAMP queries, which unlike
+// GL_TIME_ELAPSED may nest. Their results are read back FramesInFlight - 1 frames later, and a frame
+// whose queries are still not available is dropped rather than waited for.
+// Event names must be string literals, only the pointer is stored.
+class Profiler {
+public:
+    static const unsigned int GpuThread = 0xFFFF;
+    static const unsigned int FramesInFlight = 3;
+    static const unsigned int HistoryLength = 120;
+
+    // the query objects are not deleted, the singleton outlives the GL context and they go away with it
+    Profiler()
+    : m_Origin(std::chrono::steady_clock::now()) {
+    }
+
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    void setEnabled(bool enabled) {
+        m_Enabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    bool enabled() const {
+        return m_Enabled.load(std::memory_order_relaxed);
+    }
+
+    // call from the GL thread before anything of the frame is recorded
+    void beginFrame() {
+        // the first thread to begin a frame registers first and is shown as the main thread
+        threadBuffer();
+        m_Recording = enabled();
+        m_FrameStart = now();
+        if (!m_Recording) {
+            return;
+        }
+        GpuFrame &gpuFrame = m_GpuFrames[m_FrameIndex % FramesInFlight];
+        gpuFrame.used = 0;
+        gpuFrame.events.clear();
+        if (m_FrameIndex % 60 == 0) {
+            calibrateGpuClock();
+        }
+    }
+
+    // call from the GL thread after the last scope of the frame closed
+    void endFrame() {
+        if (!m_Recording) {
+            discardCpuEvents();
+            for (GpuFrame &gpuFrame : m_GpuFrames) {
+                gpuFrame.events.clear();
+            }
+            ++m_FrameIndex;
+            return;
+        }
+        ProfileFrame frame;
+        frame.cpuStart = m_FrameStart;
+        frame.cpuEnd = now();
+        drainCpuEvents(frame.cpu);
+        m_LastCpu = frame;
+
+        // the oldest frame in flight has had FramesInFlight - 1 frames to finish on the GPU
+        if (m_FrameIndex + 1 >= FramesInFlight) {
+            GpuFrame &oldest = m_GpuFrames[(m_FrameIndex + 1) % FramesInFlight];
+            if (resolveGpuFrame(oldest, m_LastGpu)) {
+                if (!m_History.empty()) {
+                    // GPU results lag behind, attach them to the frame they belong to
+                    size_t lag = FramesInFlight - 1;
+                    if (m_History.size() >= lag) {
+                        m_History[m_History.size() - lag].gpu = m_LastGpu;
+                    }
+                }
+            }
+        }
+        m_History.push_back(frame);
+        while (m_History.size() > HistoryLength) {
+            m_History.pop_front();
+        }
+        ++m_FrameIndex;
+    }
+
+    // CPU scope begin/end, used through CpuProfileScope
+    unsigned int beginCpuScope() {
+        ThreadBuffer &buffer = threadBuffer();
+        return buffer.depth++;
+    }
+
+    void endCpuScope(const char *name, std::int64_t start, unsigned int depth) {
+        ThreadBuffer &buffer = threadBuffer();
+        --buffer.depth;
+        std::uint32_t write = buffer.write.load(std::memory_order_relaxed);
+        std::uint32_t read = buffer.read.load(std::memory_order_acquire);
+        if (write - read >= ThreadBuffer::Capacity) {
+            ++buffer.dropped;
+            return;
+        }
+        ProfileEvent &event = buffer.events[write % ThreadBuffer::Capacity];
+        event.name = name;
+        event.start = start;
+        event.end = now();
+        event.depth = depth;
+        event.thread = buffer.index;
+        buffer.write.store(write + 1, std::memory_order_release);
+    }
+
+    // GPU scope begin/end, GL thread only, used through GpuProfileScope
+    int beginGpuScope(const char *name) {
+        if (!m_Recording) {
+            return -1;
+        }
+        GpuFrame &frame = m_GpuFrames[m_FrameIndex % FramesInFlight];
+        GpuEvent event;
+        event.name = name;
+        event.depth = m_GpuDepth++;
+        event.beginQuery = allocateQuery(frame);
+        event.endQuery = allocateQuery(frame);
+        glQueryCounter(frame.queries[event.beginQuery], GL_TIMESTAMP);
+        frame.events.push_back(event);
+        return frame.events.size() - 1;
+    }
+
+    void endGpuScope(int eventIndex) {
+        if (eventIndex < 0) {
+            return;
+        }
+        GpuFrame &frame = m_GpuFrames[m_FrameIndex % FramesInFlight];
+        --m_GpuDepth;
+        glQueryCounter(frame.queries[frame.events[eventIndex].endQuery], GL_TIMESTAMP);
+    }
+
+    std::int64_t now() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_Origin).count();
+    }
+
+    // most recent complete frame of CPU events
+    const ProfileFrame &lastCpuFrame() const {
+        return m_LastCpu;
+    }
+
+    // most recent frame of GPU events that could be read back, already on the CPU clock
+    const std::vector<ProfileEvent> &lastGpuFrame() const {
+        return m_LastGpu;
+    }
+
+    unsigned int threadCount() const {
+        std::lock_guard<std::mutex> lock(m_ThreadsMutex);
+        return m_Threads.size();
+    }
+
+    unsigned int droppedEvents() const {
+        std::lock_guard<std::mutex> lock(m_ThreadsMutex);
+        unsigned int dropped = 0;
+        for (const std::unique_ptr<ThreadBuffer> &buffer : m_Threads) {
+            dropped += buffer->dropped;
+        }
+        return dropped;
+    }
+
+    // writes the recorded history in the Chrome trace event format (chrome://tracing, Perfetto)
+    bool exportChromeTrace(const std::string &path) const {
+        std::ofstream out(path);
+        if (!out) {
+            return false;
+        }
+        out << std::fixed << std::setprecision(3);
+        out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+        out << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << GpuThread
+            << ", \"args\": {\"name\": \"GPU\"}}";
+        unsigned int threads = threadCount();
+        for (unsigned int thread = 0; thread < threads; ++thread) {
+            out << ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << thread
+                << ", \"args\": {\"name\": \"" << threadName(thread) << "\"}}";
+        }
+        for (const ProfileFrame &frame : m_History) {
+            for (const std::vector<ProfileEvent> *events : {&frame.cpu, &frame.gpu}) {
+                for (const ProfileEvent &event : *events) {
+                    out << ",\n{\"name\": \"" << event.name << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << event.thread
+                        << ", \"ts\": " << event.start / 1000.0 << ", \"dur\": " << (event.end - event.start) / 1000.0 << "}";
+                }
+            }
+        }
+        out << "\n]}\n";
+        return (bool) out;
+    }
+
+    static std::string threadName(unsigned int thread) {
+        if (thread == GpuThread) {
+            return "GPU";
+        }
+        return thread == 0 ? "main" : "worker " + std::to_string(thread);
+    }
+
+private:
+    struct ThreadBuffer {
+        static const std::uint32_t Capacity = 4096;
+        ProfileEvent events[Capacity];
+        std::atomic<std::uint32_t> write{0};
+        std::atomic<std::uint32_t> read{0};
+        unsigned int index = 0;
+        unsigned int depth = 0;
+        std::atomic<unsigned int> dropped{0};
+    };
+
+    struct GpuEvent {
+        const char *name;
+        unsigned int depth;
+        unsigned int beginQuery;
+        unsigned int endQuery;
+    };
+
+    struct GpuFrame {
+        std::vector<unsigned int> queries;
+        unsigned int used = 0;
+        std::vector<GpuEvent> events;
+    };
+
+    ThreadBuffer &threadBuffer() {
+        // buffers are owned by the profiler so they outlive the threads that wrote them
+        thread_local ThreadBuffer *buffer = nullptr;
+        if (!buffer) {
+            std::lock_guard<std::mutex> lock(m_ThreadsMutex);
+            m_Threads.emplace_back(new ThreadBuffer());
+            buffer = m_Threads.back().get();
+            buffer->index = m_Threads.size() - 1;
+        }
+        return *buffer;
+    }
+
+    void drainCpuEvents(std::vector<ProfileEvent> &events) {
+        std::lock_guard<std::mutex> lock(m_ThreadsMutex);
+        for (const std::unique_ptr<ThreadBuffer> &buffer : m_Threads) {
+            std::uint32_t write = buffer->write.load(std::memory_order_acquire);
+            std::uint32_t read = buffer->read.load(std::memory_order_relaxed);
+            for (; read != write; ++read) {
+                events.push_back(buffer->events[read % ThreadBuffer::Capacity]);
+            }
+            buffer->read.store(write, std::memory_order_release);
+        }
+    }
+
+    void discardCpuEvents() {
+        std::lock_guard<std::mutex> lock(m_ThreadsMutex);
+        for (const std::unique_ptr<ThreadBuffer> &buffer : m_Threads) {
+            buffer->read.store(buffer->write.load(std::memory_order_acquire), std::memory_order_release);
+        }
+    }
+
+    unsigned int allocateQuery(GpuFrame &frame) {
+        if (frame.used == frame.queries.size()) {
+            unsigned int query;
+            glGenQueries(1, &query);
+            frame.queries.push_back(query);
+        }
+        return frame.used++;
+    }
+
+    bool resolveGpuFrame(GpuFrame &frame, std::vector<ProfileEvent> &events) {
+        if (frame.events.empty()) {
+            return false;
+        }
+        GLint available = 0;
+        glGetQueryObjectiv(frame.queries[frame.events.back().endQuery], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            frame.events.clear();
+            return false;
+        }
+        events.clear();
+        for (const GpuEvent &gpuEvent : frame.events) {
+            GLuint64 begin = 0, end = 0;
+            glGetQueryObjectui64v(frame.queries[gpuEvent.beginQuery], GL_QUERY_RESULT, &begin);
+            glGetQueryObjectui64v(frame.queries[gpuEvent.endQuery], GL_QUERY_RESULT, &end);
+            ProfileEvent event;
+            event.name = gpuEvent.name;
+            event.start = (std::int64_t) begin + m_GpuClockOffset;
+            event.end = (std::int64_t) end + m_GpuClockOffset;
+            event.depth = gpuEvent.depth;
+            event.thread = GpuThread;
+            events.push_back(event);
+        }
+        frame.events.clear();
+        return true;
+    }
+
+    // maps GPU timestamps onto the CPU clock; the GPU clock can drift, so this is redone now and then
+    void calibrateGpuClock() {
+        GLint64 gpuNow = 0;
+        glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+        m_GpuClockOffset = now() - gpuNow;
+    }
+
+    std::chrono::steady_clock::time_point m_Origin;
+    std::atomic<bool> m_Enabled{false};
+    bool m_Recording = false;
+    unsigned int m_FrameIndex = 0;
+    std::int64_t m_FrameStart = 0;
+
+    mutable std::mutex m_ThreadsMutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> m_Threads;
+
+    GpuFrame m_GpuFrames[FramesInFlight];
+    unsigned int m_GpuDepth = 0;
+    std::int64_t m_GpuClockOffset = 0;
+
+    ProfileFrame m_LastCpu;
+    std::vector<ProfileEvent> m_LastGpu;
+    std::deque<ProfileFrame> m_History;
+};
+
+Profiler& profiler();
+
+Profiler& profiler() {
+    static Profiler instance;
+    return instance;
+}
+
+class CpuProfileScope {
+public:
+    explicit CpuProfileScope(const char *name)
+    : m_Name(name), m_Active(profiler().enabled()) {
+        if (m_Active) {
+            m_Depth = profiler().beginCpuScope();
+            m_Start = profiler().now();
+        }
+    }
+
+    ~CpuProfileScope() {
+        if (m_Active) {
+            profiler().endCpuScope(m_Name, m_Start, m_Depth);
+        }
+    }
+
+    CpuProfileScope(const CpuProfileScope&) = delete;
+    CpuProfileScope& operator=(const CpuProfileScope&) = delete;
+
+private:
+    const char *m_Name;
+    bool m_Active;
+    unsigned int m_Depth = 0;
+    std::int64_t m_Start = 0;
+};
+
+class GpuProfileScope {
+public:
+    explicit GpuProfileScope(const char *name)
+    : m_Event(profiler().beginGpuScope(name)) {
+    }
+
+    ~GpuProfileScope() {
+        profiler().endGpuScope(m_Event);
+    }
+
+    GpuProfileScope(const GpuProfileScope&) = delete;
+    GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+
+private:
+    int m_Event;
+};
+
+};
+
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+// CPU only, usable on any thread
+#define PROFILE_CPU_SCOPE(name) rg::CpuProfileScope PROFILE_CONCAT(cpuProfileScope, __LINE__)(name)
+// CPU and GPU, GL thread only
+#define PROFILE_SCOPE(name) PROFILE_CPU_SCOPE(name); rg::GpuProfileScope PROFILE_CONCAT(gpuProfileScope, __LINE__)(name)
+
+#endif //PROJECT_BASE_PROFILER_H
@@ -0,0 +1,199 @@
+#ifndef PROJECT_BASE_PROGRAMBINARYCACHE_H
+#define PROJECT_BASE_PROGRAMBINARYCACHE_H
+
+#include <glad/glad.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// ARB_get_program_binary, core since 4.1: the glad loader is generated for 3.3 without it
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#define GL_PROGRAM_BINARY_FORMATS 0x87FF
+#endif
+
+namespace rg {
+
+// Linked programs saved with glGetProgramBinary and restored with glProgramBinary on the next launch.
+// A binary is only valid for the driver build that produced it, so the key hashes the shader sources
+// together with GL_VENDOR, GL_RENDERER and GL_VERSION; a driver update just misses. The driver may
+// still reject a binary (the format is opaque), the caller then compiles from source and stores again.
+class ProgramBinaryCache {
+public:
+    // call once GLAD is loaded. Stays disabled if the entry points are missing or the driver offers no
+    // binary format
+    void init(GLADloadproc loadProc, std::string directory) {
+        m_GetProgramBinary = (GetProgramBinaryProc) loadProc("glGetProgramBinary");
+        m_ProgramBinary = (ProgramBinaryProc) loadProc("glProgramBinary");
+        m_ProgramParameteri = (ProgramParameteriProc) loadProc("glProgramParameteri");
+        GLint formats = 0;
+        if (m_GetProgramBinary && m_ProgramBinary && m_ProgramParameteri) {
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        }
+        m_Enabled = formats > 0 && !directory.empty();
+        if (!m_Enabled) {
+            return;
+        }
+        m_Formats.resize(formats);
+        glGetIntegerv(GL_PROGRAM_BINARY_FORMATS, m_Formats.data());
+        m_Directory = std::move(directory);
+        mkdir(m_Directory.c_str(), 0755);
+        m_Driver = string(GL_VENDOR) + '\n' + string(GL_RENDERER) + '\n' + string(GL_VERSION);
+    }
+
+    bool enabled() const {
+        return m_Enabled;
+    }
+
+    // FNV-1a over the sources and the driver identification, sources are separated so that moving
+    // text from one stage to the next changes the key
+    std::string key(const std::vector<const std::string *> &sources) const {
+        std::uint64_t hash = 14695981039346656037ull;
+        auto add = [&hash](const std::string &text) {
+            for (unsigned char c : text) {
+                hash = (hash ^ c) * 1099511628211ull;
+            }
+            hash = (hash ^ 0xff) * 1099511628211ull;
+        };
+        for (const std::string *source : sources) {
+            add(*source);
+        }
+        add(m_Driver);
+        char name[17];
+        std::snprintf(name, sizeof(name), "%016llx", (unsigned long long) hash);
+        return name;
+    }
+
+    // loads the cached binary into program, true if the driver accepted it and the program is linked
+    bool load(unsigned int program, const std::string &key) {
+        if (!m_Enabled) {
+            return false;
+        }
+        std::ifstream in(path(key), std::ios::binary | std::ios::ate);
+        if (!in) {
+            ++m_Misses;
+            return false;
+        }
+        std::streamoff size = in.tellg();
+        GLenum format = 0;
+        if (size <= (std::streamoff) sizeof(format)) {
+            ++m_Rejected;
+            return false;
+        }
+        std::vector<char> binary((size_t) size - sizeof(format));
+        in.seekg(0);
+        in.read((char *) &format, sizeof(format));
+        in.read(binary.data(), binary.size());
+        if (!in || std::find(m_Formats.begin(), m_Formats.end(), (GLint) format) == m_Formats.end()) {
+            std::remove(path(key).c_str());
+            ++m_Rejected;
+            return false;
+        }
+        m_ProgramBinary(program, format, binary.data(), (GLsizei) binary.size());
+        GLint linked = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (!linked) {
+            // stale or foreign binary, drop it so the next launch doesn't try it again
+            std::remove(path(key).c_str());
+            ++m_Rejected;
+            return false;
+        }
+        ++m_Hits;
+        return true;
+    }
+
+    // call before glLinkProgram, some drivers only keep the binary around when asked to
+    void prepare(unsigned int program) {
+        if (m_Enabled) {
+            m_ProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
+    }
+
+    // saves the program if it linked
+    void store(unsigned int program, const std::string &key) {
+        if (!m_Enabled) {
+            return;
+        }
+        GLint linked = 0;
+        GLint length = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (linked) {
+            glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        }
+        if (length <= 0) {
+            return;
+        }
+        std::vector<char> binary(length);
+        GLenum format = 0;
+        m_GetProgramBinary(program, length, &length, &format, binary.data());
+        // written to a temporary file first, a crash mid-write must not leave a truncated entry behind
+        std::string temporary = path(key) + ".tmp";
+        {
+            std::ofstream out(temporary, std::ios::binary);
+            out.write((const char *) &format, sizeof(format));
+            out.write(binary.data(), length);
+            if (!out) {
+                std::cout << "ERROR::PROGRAM_BINARY_CACHE::WRITE_FAILED " << temporary << std::endl;
+                return;
+            }
+        }
+        std::rename(temporary.c_str(), path(key).c_str());
+    }
+
+    unsigned int hits() const {
+        return m_Hits;
+    }
+
+    unsigned int misses() const {
+        return m_Misses;
+    }
+
+    unsigned int rejected() const {
+        return m_Rejected;
+    }
+
+private:
+    typedef void (APIENTRYP GetProgramBinaryProc)(GLuint program, GLsizei bufSize, GLsizei *length,
+                                                  GLenum *binaryFormat, void *binary);
+    typedef void (APIENTRYP ProgramBinaryProc)(GLuint program, GLenum binaryFormat, const void *binary,
+                                               GLsizei length);
+    typedef void (APIENTRYP ProgramParameteriProc)(GLuint program, GLenum pname, GLint value);
+
+    static std::string string(GLenum name) {
+        const GLubyte *value = glGetString(name);
+        return value ? (const char *) value : "";
+    }
+
+    std::string path(const std::string &key) const {
+        return m_Directory + "/" + key + ".bin";
+    }
+
+    GetProgramBinaryProc m_GetProgramBinary = nullptr;
+    ProgramBinaryProc m_ProgramBinary = nullptr;
+    ProgramParameteriProc m_ProgramParameteri = nullptr;
+    bool m_Enabled = false;
+    std::vector<GLint> m_Formats;
+    std::string m_Directory;
+    std::string m_Driver;
+    unsigned int m_Hits = 0;
+    unsigned int m_Misses = 0;
+    unsigned int m_Rejected = 0;
+};
+
+ProgramBinaryCache& programBinaryCache();
+
+ProgramBinaryCache& programBinaryCache() {
+    static ProgramBinaryCache cache;
+    return cache;
+}
+
+};
+
+#endif //PROJECT_BASE_PROGRAMBINARYCACHE_H
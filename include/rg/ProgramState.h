@@ -0,0 +1,137 @@
+#ifndef PROJECT_BASE_PROGRAMSTATE_H
+#define PROJECT_BASE_PROGRAMSTATE_H
+
+#include <glm/glm.hpp>
+#include <learnopengl/camera.h>
+#include <rg/FramePacer.h>
+#include <rg/Lights.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+// how the scene's point lights are shaded; forward only knows the two scene lamps
+enum class LightingMode {
+    Forward,
+    Deferred,
+    Clustered
+};
+
+// how the house floor offsets its texture coordinates, see resources/shaders/parallax.glsl
+enum class ParallaxMode {
+    Offset,
+    Occlusion
+};
+
+// how the scene is anti-aliased, see rg/SceneTarget.h and resources/shaders/post.fs
+enum class AntiAliasingMode {
+    None,
+    MSAA, // 4x multisampled scene target, resolved
+    FXAA,
+    SMAA
+};
+
+struct ProgramState {
+    glm::vec3 clearColor = glm::vec3(0);
+    bool ImGuiEnabled = false;
+    Camera camera;
+    bool CameraMouseMovementUpdateEnabled = true;
+
+    glm::vec3 islandPosition = glm::vec3(0.0f, -100.0f, 0.0f);
+    float islandScale = 0.7f;
+
+    glm::vec3 airplanePosition = glm::vec3(200.0f, 250.0f, 30.0f);
+    float airplaneScale = 3.5f;
+
+    glm::vec3 boatPosition = glm::vec3(80.0f, -97.0f, 120.0f);
+    float boatScale = 1.0f;
+
+    glm::vec3 lampPosition = glm::vec3(-10.0f, -80.0f, -10.0f);
+    float lampScale = 10.0f;
+
+    glm::vec3 tablePosition = glm::vec3(-5.0f, -77.0f, 11.0f);
+    float tableScale = 4.0f;
+
+    glm::vec3 chairPosition = glm::vec3(-5.0f, -77.0f, 8.0f);
+    float chairScale = 4.0f;
+
+    glm::vec3 houseLampPosition = glm::vec3(-13.0f, -71.0f, 9.0f);
+    float houseLampScale = 4.0f;
+
+    glm::vec3 applePosition = glm::vec3(-5.0f, -74.0f, 11.0f);
+    float appleScale = 0.05f;
+
+
+    PointLight pointLight;
+    PointLight pointLightHouse;
+    DirLight dirLight;
+
+    // lights beyond the two scene lamps are only rendered by the deferred and clustered paths
+    LightingMode lightingMode = LightingMode::Forward;
+    int coastLightCount = 0;
+    std::vector<PointLight> coastLights;
+
+    ParallaxMode parallaxMode = ParallaxMode::Occlusion;
+
+    // frame pacing, set from the command line
+    rg::SwapMode swapMode = rg::SwapMode::VSync;
+    int fpsLimit = 0;
+
+    // model draws recorded into command lists by the thread pool, replayed on the GL thread
+    bool recordCommandLists = false;
+
+    // the scene is rendered at renderScale times the framebuffer size and upscaled with a sharpening
+    // pass; dynamic resolution adjusts the scale to keep the GPU frame time under targetFrameTime
+    float renderScale = 1.0f;
+    bool dynamicResolution = false;
+    float targetFrameTime = 16.7f;
+    float sharpness = 0.5f;
+
+    AntiAliasingMode antiAliasing = AntiAliasingMode::MSAA;
+
+    // the scene is lit in HDR, the post pass scales it by exposure before tone mapping; bloom adds
+    // what is brighter than bloomThreshold, blurred on a mip chain, see rg/BloomChain.h
+    float exposure = 1.0f;
+    bool bloom = true;
+    float bloomThreshold = 1.0f;
+    float bloomIntensity = 0.5f;
+
+    ProgramState()
+            : camera(glm::vec3(0.0f, 0.0f, 0.0f)) {}
+
+    void SaveToFile(std::string filename);
+
+    void LoadFromFile(std::string filename);
+};
+
+void ProgramState::SaveToFile(std::string filename) {
+    std::ofstream out(filename);
+    out << clearColor.r << '\n'
+        << clearColor.g << '\n'
+        << clearColor.b << '\n'
+        << ImGuiEnabled << '\n'
+        << camera.Position.x << '\n'
+        << camera.Position.y << '\n'
+        << camera.Position.z << '\n'
+        << camera.Front.x << '\n'
+        << camera.Front.y << '\n'
+        << camera.Front.z << '\n';
+}
+
+void ProgramState::LoadFromFile(std::string filename) {
+    std::ifstream in(filename);
+    if (in) {
+        in >> clearColor.r
+           >> clearColor.g
+           >> clearColor.b
+           >> ImGuiEnabled
+           >> camera.Position.x
+           >> camera.Position.y
+           >> camera.Position.z
+           >> camera.Front.x
+           >> camera.Front.y
+           >> camera.Front.z;
+    }
+}
+
+#endif //PROJECT_BASE_PROGRAMSTATE_H
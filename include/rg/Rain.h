@@ -0,0 +1,63 @@
+#ifndef PROJECT_BASE_RAIN_H
+#define PROJECT_BASE_RAIN_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <cstdlib>
+#include <vector>
+
+namespace rg {
+
+// CPU side of the rain: the drops fall every simulation step, wrap around to the top, and get one
+// model matrix each for the instanced draw. No GL involved.
+struct Rain {
+    std::vector<glm::vec3> positions;
+    std::vector<float> rotations;
+    std::vector<glm::mat4> models;
+
+    // scatters the drops with rand(), seed it first for a reproducible field
+    void spawn(unsigned int count) {
+        positions.clear();
+        rotations.clear();
+        for (unsigned int i = 0; i < count; i++) {
+            float x = static_cast<float>(rand() % 201 - 100); // x in [-100, 100]
+            float y = static_cast<float>(rand() % 401 - 200); // y in [-200, 200]
+            float z = static_cast<float>(rand() % 201 - 100); // z in [-100, 100]
+            positions.push_back(glm::vec3(x, y, z));
+            rotations.push_back(static_cast<float>(i % 180)); // rotation in [0, 179]
+        }
+        models.resize(positions.size());
+    }
+
+    // moves every drop down by distance
+    void fall(float distance) {
+        for (unsigned int i = 0; i < positions.size(); i++) {
+            positions[i].y -= distance;
+            // a drop that fell out of the field starts again at the top
+            if (positions[i].y < -50.0f) {
+                positions[i].y = 50.0f;
+            }
+        }
+    }
+
+    // lag: how far above their simulated position the drops are drawn, the part of the last step
+    // the render time hasn't reached yet
+    void buildModels(float scale, float lag = 0.0f) {
+        buildModels(models, scale, lag);
+    }
+
+    // same into a caller owned array, e.g. a frame packet handed to the render thread
+    void buildModels(std::vector<glm::mat4> &out, float scale, float lag) const {
+        out.resize(positions.size());
+        for (unsigned int i = 0; i < positions.size(); i++) {
+            glm::mat4 model = glm::scale(glm::mat4(1.0f), glm::vec3(scale));
+            model = glm::translate(model, positions[i] + glm::vec3(0.0f, lag, 0.0f));
+            model = glm::rotate(model, glm::radians(rotations[i]), glm::vec3(0.0f, 1.0f, 0.0f));
+            out[i] = model;
+        }
+    }
+};
+
+};
+
+#endif //PROJECT_BASE_RAIN_H
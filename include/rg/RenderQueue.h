@@ -0,0 +1,186 @@
+#ifndef PROJECT_BASE_RENDERQUEUE_H
+#define PROJECT_BASE_RENDERQUEUE_H
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include <rg/Error.h>
+#include <rg/GLState.h>
+#include <rg/Profiler.h>
+
+namespace rg {
+
+// Passes are executed in this order; the value is stored in the top bits of the sort key.
+// Geometry holds the G-buffer draws of the deferred path and sorts like Opaque.
+enum class RenderPass : std::uint64_t {
+    Geometry = 0,
+    Opaque = 1,
+    Sky = 2,
+    Transparent = 3
+};
+
+// Collects the draws of a frame as (key, callback) pairs, radix-sorts them by key and then
+// executes them in order, switching the program only when it changes between two draws.
+//
+// Key layout, most significant bits first:
+//   geometry/opaque/sky: pass(4) | program(8) | material(16) | depth(24), depth front-to-back
+//   transparent:         pass(4) | depth(24)  | program(8) | material(16), depth back-to-front
+// Program and material ids are remapped to small dense indices so any GL name fits.
+class RenderQueue {
+public:
+    explicit RenderQueue(float farPlane = 1000.0f)
+    : m_FarPlane(farPlane) {
+    }
+
+    // name labels the draw in the profiler and must be a string literal
+    void submit(RenderPass pass, unsigned int program, unsigned int material, float depth,
+                std::function<void()> draw, const char *name = "draw") {
+        Item item;
+        item.key = makeKey(pass, programIndex(program), materialIndex(material), depth);
+        item.program = program;
+        item.draw = std::move(draw);
+        item.name = name;
+        m_Items.push_back(std::move(item));
+        m_Sorted = false;
+    }
+
+    // sorts now instead of in the first execute(), e.g. on a worker while the GL thread does
+    // something else. Nothing may be submitted in between
+    void sort() {
+        if (!m_Sorted) {
+            sortItems();
+            m_Sorted = true;
+        }
+    }
+
+    void execute() {
+        execute(RenderPass::Geometry, RenderPass::Transparent);
+    }
+
+    // runs only the draws of passes first..last, so other work can be slotted in between passes
+    void execute(RenderPass first, RenderPass last) {
+        sort();
+        unsigned int currentProgram = 0;
+        for (std::uint32_t index : m_Order) {
+            Item& item = m_Items[index];
+            RenderPass pass = (RenderPass) (item.key >> 60);
+            if (pass < first || pass > last) {
+                continue;
+            }
+            PROFILE_SCOPE(item.name);
+            if (item.program != currentProgram) {
+                glState().useProgram(item.program);
+                currentProgram = item.program;
+                ++m_ProgramSwitches;
+            }
+            item.draw();
+        }
+    }
+
+    void clear() {
+        m_Items.clear();
+        m_Order.clear();
+        m_Sorted = false;
+        m_ProgramSwitches = 0;
+    }
+
+    size_t size() const {
+        return m_Items.size();
+    }
+
+    unsigned int programSwitches() const {
+        return m_ProgramSwitches;
+    }
+
+private:
+    struct Item {
+        std::uint64_t key;
+        unsigned int program;
+        std::function<void()> draw;
+        const char *name;
+    };
+
+    std::uint64_t makeKey(RenderPass pass, std::uint64_t program, std::uint64_t material, float depth) const {
+        const std::uint64_t depthMax = (1u << 24) - 1;
+        float normalized = depth / m_FarPlane;
+        normalized = normalized < 0.0f ? 0.0f : (normalized > 1.0f ? 1.0f : normalized);
+        std::uint64_t quantizedDepth = (std::uint64_t) (normalized * depthMax);
+
+        std::uint64_t key = (std::uint64_t) pass << 60;
+        if (pass == RenderPass::Transparent) {
+            key |= (depthMax - quantizedDepth) << 24;
+            key |= (program & 0xFF) << 16;
+            key |= material & 0xFFFF;
+        } else {
+            key |= (program & 0xFF) << 40;
+            key |= (material & 0xFFFF) << 24;
+            key |= quantizedDepth;
+        }
+        return key;
+    }
+
+    // LSD radix sort on 8-bit digits; digits that are equal across all keys are skipped,
+    // which for a frame's worth of draws leaves only a handful of real passes.
+    void sortItems() {
+        const size_t count = m_Items.size();
+        m_Order.resize(count);
+        m_Scratch.resize(count);
+        for (std::uint32_t i = 0; i < count; ++i) {
+            m_Order[i] = i;
+        }
+
+        for (unsigned int shift = 0; shift < 64; shift += 8) {
+            size_t histogram[256] = {0};
+            for (std::uint32_t index : m_Order) {
+                ++histogram[(m_Items[index].key >> shift) & 0xFF];
+            }
+            if (count == 0 || histogram[(m_Items[m_Order[0]].key >> shift) & 0xFF] == count) {
+                continue;
+            }
+
+            size_t offset = 0;
+            for (size_t& bucket : histogram) {
+                size_t bucketSize = bucket;
+                bucket = offset;
+                offset += bucketSize;
+            }
+            for (std::uint32_t index : m_Order) {
+                m_Scratch[histogram[(m_Items[index].key >> shift) & 0xFF]++] = index;
+            }
+            m_Order.swap(m_Scratch);
+        }
+    }
+
+    std::uint64_t programIndex(unsigned int program) {
+        return denseIndex(m_Programs, program);
+    }
+
+    std::uint64_t materialIndex(unsigned int material) {
+        return denseIndex(m_Materials, material);
+    }
+
+    // ids are remembered across frames so a given program/material keeps its sort position
+    static std::uint64_t denseIndex(std::vector<unsigned int>& ids, unsigned int id) {
+        for (size_t i = 0; i < ids.size(); ++i) {
+            if (ids[i] == id) {
+                return i;
+            }
+        }
+        ids.push_back(id);
+        return ids.size() - 1;
+    }
+
+    float m_FarPlane;
+    std::vector<Item> m_Items;
+    std::vector<std::uint32_t> m_Order;
+    std::vector<std::uint32_t> m_Scratch;
+    std::vector<unsigned int> m_Programs;
+    std::vector<unsigned int> m_Materials;
+    bool m_Sorted = false;
+    unsigned int m_ProgramSwitches = 0;
+};
+
+};
+
+#endif //PROJECT_BASE_RENDERQUEUE_H
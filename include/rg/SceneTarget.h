@@ -0,0 +1,128 @@
+#ifndef PROJECT_BASE_SCENETARGET_H
+#define PROJECT_BASE_SCENETARGET_H
+
+#include <glad/glad.h>
+#include <memory>
+#include <rg/Error.h>
+#include <rg/GLState.h>
+#include <rg/GpuMemory.h>
+#include <rg/OffscreenTarget.h>
+
+namespace rg {
+
+// Where the scene is drawn before the post pass tone maps it into the framebuffer, at the render
+// scale's size. The color is RGBA16F so lights can go past 1.0 without clipping. Multisampled, it is
+// an OffscreenTarget resolved into a texture of the same format; single sampled, the scene is drawn
+// into that texture directly, with its own depth/stencil renderbuffer. The post pass and the bloom
+// chain sample the texture with bilinear filtering.
+class SceneTarget {
+public:
+    static const GLenum ColorFormat = GL_RGBA16F;
+
+    ~SceneTarget() {
+        destroy();
+    }
+
+    // (re)creates the targets when the size or sample count changed
+    void resize(int width, int height, int samples) {
+        if (width == m_Width && height == m_Height && samples == m_Samples) {
+            return;
+        }
+        destroy();
+        m_Width = width;
+        m_Height = height;
+        m_Samples = samples;
+        if (samples > 1) {
+            m_Multisampled.reset(new OffscreenTarget(width, height, samples, ColorFormat));
+        }
+
+        glGenFramebuffers(1, &m_ResolveFramebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, m_ResolveFramebuffer);
+        glGenTextures(1, &m_Color);
+        glBindTexture(GL_TEXTURE_2D, m_Color);
+        glTexImage2D(GL_TEXTURE_2D, 0, ColorFormat, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        gpuMemory().track(GpuMemory::Kind::Texture, m_Color, "render targets",
+                          GpuMemory::textureBytes(ColorFormat, width, height), "scene color");
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_Color, 0);
+        if (samples <= 1) {
+            glGenRenderbuffers(1, &m_Depth);
+            glBindRenderbuffer(GL_RENDERBUFFER, m_Depth);
+            glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+            gpuMemory().track(GpuMemory::Kind::Renderbuffer, m_Depth, "render targets",
+                              GpuMemory::textureBytes(GL_DEPTH24_STENCIL8, width, height), "scene depth");
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_Depth);
+            glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        }
+        ASSERT(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE, "Scene target is not complete!");
+
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        // texture creation went around the state cache
+        glState().invalidate();
+    }
+
+    // the framebuffer the scene is drawn into
+    unsigned int framebuffer() const {
+        return m_Multisampled ? m_Multisampled->framebuffer() : m_ResolveFramebuffer;
+    }
+
+    // resolves the samples into the color texture, nothing to do single sampled
+    void resolve() {
+        if (!m_Multisampled) {
+            return;
+        }
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, m_Multisampled->framebuffer());
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_ResolveFramebuffer);
+        glBlitFramebuffer(0, 0, m_Width, m_Height, 0, 0, m_Width, m_Height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    }
+
+    void bindColorTexture(unsigned int unit) {
+        glState().bindTexture(GL_TEXTURE_2D, unit, m_Color);
+    }
+
+    int width() const {
+        return m_Width;
+    }
+
+    int height() const {
+        return m_Height;
+    }
+
+    int samples() const {
+        return m_Samples;
+    }
+
+private:
+    void destroy() {
+        if (m_ResolveFramebuffer == 0) {
+            return;
+        }
+        // the old samples are freed before the new ones are allocated
+        m_Multisampled.reset();
+        gpuMemory().release(GpuMemory::Kind::Texture, m_Color);
+        glDeleteTextures(1, &m_Color);
+        if (m_Depth != 0) {
+            gpuMemory().release(GpuMemory::Kind::Renderbuffer, m_Depth);
+            glDeleteRenderbuffers(1, &m_Depth);
+        }
+        glDeleteFramebuffers(1, &m_ResolveFramebuffer);
+        m_Color = 0;
+        m_Depth = 0;
+        m_ResolveFramebuffer = 0;
+    }
+
+    std::unique_ptr<OffscreenTarget> m_Multisampled;
+    unsigned int m_ResolveFramebuffer = 0;
+    unsigned int m_Color = 0;
+    unsigned int m_Depth = 0;
+    int m_Width = 0;
+    int m_Height = 0;
+    int m_Samples = 0;
+};
+
+};
+
+#endif //PROJECT_BASE_SCENETARGET_H
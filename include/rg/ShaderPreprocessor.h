@@ -0,0 +1,117 @@
+#ifndef PROJECT_BASE_SHADERPREPROCESSOR_H
+#define PROJECT_BASE_SHADERPREPROCESSOR_H
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace rg {
+
+// Expands #include "file" in GLSL sources, which the GLSL preprocessor doesn't have. Paths are relative
+// to the including file and every file is included at most once per stage, like #pragma once. The
+// expansion is framed with #line directives whose source string number is the file's index in files(),
+// so a compile error "1:12(5)" means line 12 of files()[1].
+class ShaderPreprocessor {
+public:
+    // defines: inserted after the #version line of the top-level file
+    explicit ShaderPreprocessor(std::string defines = "") : m_Defines(std::move(defines)) {
+    }
+
+    // the expanded source of path, false if it or one of its includes can't be read (see error())
+    bool process(const std::string &path, std::string &code) {
+        m_Files.clear();
+        m_Error.clear();
+        code.clear();
+        return expand(normalize(path), code, true);
+    }
+
+    // every file the last process() read, the top-level file first
+    const std::vector<std::string> &files() const {
+        return m_Files;
+    }
+
+    const std::string &error() const {
+        return m_Error;
+    }
+
+    // "a/./b/../c.glsl" -> "a/c.glsl", so every file has one name to be watched and compared by
+    static std::string normalize(const std::string &path) {
+        std::vector<std::string> parts;
+        std::stringstream stream(path);
+        std::string part;
+        while (std::getline(stream, part, '/')) {
+            if (part == "." || (part.empty() && !parts.empty())) {
+                continue;
+            }
+            if (part == ".." && !parts.empty() && parts.back() != ".." && !parts.back().empty()) {
+                parts.pop_back();
+            } else {
+                parts.push_back(part);
+            }
+        }
+        std::string normalized;
+        for (size_t i = 0; i < parts.size(); i++) {
+            normalized += (i ? "/" : "") + parts[i];
+        }
+        return normalized;
+    }
+
+private:
+    bool expand(const std::string &path, std::string &code, bool topLevel) {
+        if (std::find(m_Files.begin(), m_Files.end(), path) != m_Files.end()) {
+            return true;
+        }
+        std::ifstream file(path);
+        if (!file) {
+            m_Error = "can't read " + path;
+            return false;
+        }
+        size_t index = m_Files.size();
+        m_Files.push_back(path);
+        if (!topLevel) {
+            code += "#line 1 " + std::to_string(index) + "\n";
+        }
+        std::string directory = path.find('/') == std::string::npos ? "" : path.substr(0, path.find_last_of('/') + 1);
+        std::string line;
+        for (int number = 1; std::getline(file, line); number++) {
+            std::string include;
+            if (includedPath(line, include)) {
+                if (!expand(normalize(directory + include), code, false)) {
+                    return false;
+                }
+                code += "#line " + std::to_string(number + 1) + " " + std::to_string(index) + "\n";
+                continue;
+            }
+            code += line + "\n";
+            if (topLevel && !m_Defines.empty() && line.compare(0, 8, "#version") == 0) {
+                code += m_Defines + "#line " + std::to_string(number + 1) + " " + std::to_string(index) + "\n";
+            }
+        }
+        return true;
+    }
+
+    // #include "name" on a line of its own
+    static bool includedPath(const std::string &line, std::string &include) {
+        size_t start = line.find_first_not_of(" \t");
+        if (start == std::string::npos || line.compare(start, 8, "#include") != 0) {
+            return false;
+        }
+        size_t open = line.find('"', start + 8);
+        size_t close = open == std::string::npos ? std::string::npos : line.find('"', open + 1);
+        if (close == std::string::npos) {
+            return false;
+        }
+        include = line.substr(open + 1, close - open - 1);
+        return true;
+    }
+
+    std::string m_Defines;
+    std::vector<std::string> m_Files;
+    std::string m_Error;
+};
+
+};
+
+#endif //PROJECT_BASE_SHADERPREPROCESSOR_H
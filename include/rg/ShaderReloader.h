@@ -0,0 +1,192 @@
+#ifndef PROJECT_BASE_SHADERRELOADER_H
+#define PROJECT_BASE_SHADERRELOADER_H
+
+#include <glad/glad.h>
+#include <learnopengl/shader.h>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace rg {
+
+// Reports files that were written. inotify watches the directories rather than the files, editors
+// often save by writing a new file and renaming it over the old one, which would end a file watch.
+// Only available on Linux, elsewhere nothing is ever reported.
+class FileWatcher {
+public:
+    FileWatcher() = default;
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    ~FileWatcher() {
+#ifdef __linux__
+        if (m_Fd >= 0) {
+            close(m_Fd);
+        }
+#endif
+    }
+
+    void watch(const std::string &path) {
+#ifdef __linux__
+        if (m_Fd < 0) {
+            m_Fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+            if (m_Fd < 0) {
+                std::cout << "ERROR::FILE_WATCHER::INOTIFY_INIT_FAILED" << std::endl;
+                return;
+            }
+        }
+        size_t slash = path.find_last_of('/');
+        std::string directory = slash == std::string::npos ? "." : path.substr(0, slash);
+        for (const auto &watched : m_Directories) {
+            if (watched.second == directory) {
+                return;
+            }
+        }
+        int descriptor = inotify_add_watch(m_Fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+        if (descriptor >= 0) {
+            m_Directories[descriptor] = directory;
+        }
+#else
+        (void) path;
+#endif
+    }
+
+    // paths (directory + "/" + name) written since the last call, never blocks
+    std::set<std::string> changes() {
+        std::set<std::string> changed;
+#ifdef __linux__
+        if (m_Fd < 0) {
+            return changed;
+        }
+        alignas(inotify_event) char buffer[4096];
+        ssize_t length;
+        while ((length = read(m_Fd, buffer, sizeof(buffer))) > 0) {
+            for (ssize_t offset = 0; offset < length;) {
+                const inotify_event *event = (const inotify_event *) (buffer + offset);
+                auto directory = m_Directories.find(event->wd);
+                if (event->len > 0 && directory != m_Directories.end()) {
+                    std::string path = directory->second == "." ? "" : directory->second + "/";
+                    changed.insert(path + event->name);
+                }
+                offset += sizeof(inotify_event) + event->len;
+            }
+        }
+#endif
+        return changed;
+    }
+
+private:
+#ifdef __linux__
+    int m_Fd = -1;
+    std::map<int, std::string> m_Directories;
+#endif
+};
+
+// Rebuilds registered shaders whose source files change. Builds run in the background when the driver
+// has KHR_parallel_shader_compile (otherwise the link status query of the next update() waits for the
+// compile) and are swapped in between frames; a shader that fails to build keeps its old program.
+class ShaderReloader {
+public:
+    // call once GLAD is loaded
+    void init(GLADloadproc loadProc) {
+        GLint extensionCount = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+        const char *threadsFunction = nullptr;
+        for (GLint i = 0; i < extensionCount; i++) {
+            const char *extension = (const char *) glGetStringi(GL_EXTENSIONS, i);
+            if (std::strcmp(extension, "GL_KHR_parallel_shader_compile") == 0) {
+                threadsFunction = "glMaxShaderCompilerThreadsKHR";
+            } else if (!threadsFunction && std::strcmp(extension, "GL_ARB_parallel_shader_compile") == 0) {
+                threadsFunction = "glMaxShaderCompilerThreadsARB";
+            }
+        }
+        MaxShaderCompilerThreadsProc maxThreads =
+                threadsFunction ? (MaxShaderCompilerThreadsProc) loadProc(threadsFunction) : nullptr;
+        if (maxThreads) {
+            // let the driver pick the number of compiler threads
+            maxThreads(0xFFFFFFFFu);
+        }
+        m_ParallelCompile = maxThreads != nullptr;
+    }
+
+    void add(Shader &shader) {
+        Entry entry;
+        entry.shader = &shader;
+        m_Entries.push_back(entry);
+        for (const std::string &path : shader.dependencies()) {
+            m_Watcher.watch(path);
+        }
+    }
+
+    // starts rebuilds for changed files and swaps in finished ones. Returns true if a program was
+    // replaced; uniforms set on the old program are gone and have to be set again
+    bool update() {
+        std::set<std::string> changed = m_Watcher.changes();
+        bool swapped = false;
+        for (Entry &entry : m_Entries) {
+            // only the programs that use a changed file, directly or through an #include
+            for (const std::string &path : entry.shader->dependencies()) {
+                entry.dirty = entry.dirty || changed.count(path) > 0;
+            }
+            // a save during a build is picked up once that build is done. A new build is first checked
+            // on the next update, which gives the driver a frame to work on it
+            if (entry.dirty && !entry.shader->reloading()) {
+                entry.dirty = false;
+                if (entry.shader->beginReload()) {
+                    // the new sources may include files from other directories
+                    for (const std::string &path : entry.shader->dependencies()) {
+                        m_Watcher.watch(path);
+                    }
+                    continue;
+                }
+            }
+            switch (entry.shader->pollReload(m_ParallelCompile)) {
+                case Shader::RELOAD_SWAPPED:
+                    std::cout << "reloaded " << name(*entry.shader) << std::endl;
+                    swapped = true;
+                    break;
+                case Shader::RELOAD_FAILED:
+                    std::cout << "reload of " << name(*entry.shader) << " failed, keeping the old program" << std::endl;
+                    break;
+                default:
+                    break;
+            }
+        }
+        return swapped;
+    }
+
+    bool parallelCompile() const {
+        return m_ParallelCompile;
+    }
+
+private:
+    typedef void (APIENTRYP MaxShaderCompilerThreadsProc)(GLuint count);
+
+    struct Entry {
+        Shader *shader = nullptr;
+        bool dirty = false;
+    };
+
+    static std::string name(const Shader &shader) {
+        std::string name;
+        for (const std::string &path : shader.sourcePaths()) {
+            name += (name.empty() ? "" : " + ") + path;
+        }
+        return name;
+    }
+
+    FileWatcher m_Watcher;
+    std::vector<Entry> m_Entries;
+    bool m_ParallelCompile = false;
+};
+
+};
+
+#endif //PROJECT_BASE_SHADERRELOADER_H
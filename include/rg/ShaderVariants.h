@@ -0,0 +1,86 @@
+#ifndef PROJECT_BASE_SHADERVARIANTS_H
+#define PROJECT_BASE_SHADERVARIANTS_H
+
+#include <learnopengl/shader.h>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace rg {
+
+// what a material provides, each bit becomes a #define in the shader variant built for it
+enum ShaderFeature : unsigned int {
+    FeatureDiffuseMap = 1 << 0,  // HAS_DIFFUSE_MAP
+    FeatureSpecularMap = 1 << 1, // HAS_SPECULAR_MAP
+    FeatureNormalMap = 1 << 2    // HAS_NORMAL_MAP
+};
+
+inline std::string featureDefines(unsigned int features) {
+    std::string defines;
+    if (features & FeatureDiffuseMap)
+        defines += "#define HAS_DIFFUSE_MAP\n";
+    if (features & FeatureSpecularMap)
+        defines += "#define HAS_SPECULAR_MAP\n";
+    if (features & FeatureNormalMap)
+        defines += "#define HAS_NORMAL_MAP\n";
+    return defines;
+}
+
+// One shader source pair compiled once per feature combination actually drawn with it. A variant is
+// built the first time get() asks for it, so only the combinations the loaded materials use exist.
+class ShaderVariants {
+public:
+    // defines: shared by every variant, e.g. "#define NUM_POINT_LIGHTS 2\n"
+    ShaderVariants(std::string vertexPath, std::string fragmentPath, std::string defines = "")
+            : m_VertexPath(std::move(vertexPath)), m_FragmentPath(std::move(fragmentPath)),
+              m_Defines(std::move(defines)) {
+    }
+
+    ShaderVariants(const ShaderVariants&) = delete;
+    ShaderVariants& operator=(const ShaderVariants&) = delete;
+
+    // builds the variant on first use, GL thread only
+    Shader &get(unsigned int features) {
+        auto found = m_Variants.find(features);
+        if (found != m_Variants.end()) {
+            return *found->second;
+        }
+        Shader *shader = new Shader(m_VertexPath.c_str(), m_FragmentPath.c_str(), nullptr,
+                                    m_Defines + featureDefines(features));
+        m_Variants.emplace(features, std::unique_ptr<Shader>(shader));
+        if (m_OnBuild) {
+            m_OnBuild(*shader);
+        }
+        return *shader;
+    }
+
+    // called with every variant right after it was built, e.g. to watch it for hot reload
+    void onBuild(std::function<void(Shader &)> callback) {
+        m_OnBuild = std::move(callback);
+    }
+
+    // every variant built so far, for uniforms all of them share
+    template<typename Function>
+    void forEach(Function function) {
+        for (auto &variant : m_Variants) {
+            function(*variant.second);
+        }
+    }
+
+    size_t size() const {
+        return m_Variants.size();
+    }
+
+private:
+    std::string m_VertexPath;
+    std::string m_FragmentPath;
+    std::string m_Defines;
+    std::map<unsigned int, std::unique_ptr<Shader>> m_Variants;
+    std::function<void(Shader &)> m_OnBuild;
+};
+
+};
+
+#endif //PROJECT_BASE_SHADERVARIANTS_H
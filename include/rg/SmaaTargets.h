@@ -0,0 +1,125 @@
+#ifndef PROJECT_BASE_SMAATARGETS_H
+#define PROJECT_BASE_SMAATARGETS_H
+
+#include <glad/glad.h>
+#include <rg/Error.h>
+#include <rg/GLState.h>
+#include <rg/GpuMemory.h>
+
+namespace rg {
+
+// Intermediate targets of the SMAA passes, at the scene target's size:
+//   - edges (RG8): left and top edge of every pixel, written by smaa_edges.fs
+//   - blend weights (RGBA8): coverage of the reconstructed edge lines, written by smaa_weights.fs
+//   - stencil shared by both: the edge pass marks the pixels with an edge, the weight pass (the
+//     expensive one) only runs on those
+// The post pass blends the scene with its neighbours by the weights, see smaa.glsl.
+class SmaaTargets {
+public:
+    ~SmaaTargets() {
+        destroyTargets();
+    }
+
+    // (re)creates the targets when the size changed
+    void resize(int width, int height) {
+        if (width == m_Width && height == m_Height) {
+            return;
+        }
+        destroyTargets();
+        m_Width = width;
+        m_Height = height;
+        glGenRenderbuffers(1, &m_Stencil);
+        glBindRenderbuffer(GL_RENDERBUFFER, m_Stencil);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+        gpuMemory().track(GpuMemory::Kind::Renderbuffer, m_Stencil, "render targets",
+                          GpuMemory::textureBytes(GL_DEPTH24_STENCIL8, width, height), "SMAA stencil");
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        createTarget(m_EdgesFramebuffer, m_Edges, GL_RG8, GL_RG, "SMAA edges");
+        createTarget(m_WeightsFramebuffer, m_Weights, GL_RGBA8, GL_RGBA, "SMAA blend weights");
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        // texture creation went around the state cache
+        glState().invalidate();
+    }
+
+    // clears the edges and the stencil, the edge pass sets the stencil where it doesn't discard
+    void bindEdgesTarget() {
+        glBindFramebuffer(GL_FRAMEBUFFER, m_EdgesFramebuffer);
+        glViewport(0, 0, m_Width, m_Height);
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClearStencil(0);
+        glClear(GL_COLOR_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+        glState().enable(GL_STENCIL_TEST);
+        glStencilFunc(GL_ALWAYS, 1, 0xFF);
+        glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+    }
+
+    // clears the weights, the weight pass only runs where the edge pass set the stencil
+    void bindWeightsTarget() {
+        glBindFramebuffer(GL_FRAMEBUFFER, m_WeightsFramebuffer);
+        glViewport(0, 0, m_Width, m_Height);
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        glStencilFunc(GL_EQUAL, 1, 0xFF);
+        glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+    }
+
+    // after the weight pass
+    void endPasses() {
+        glState().disable(GL_STENCIL_TEST);
+    }
+
+    void bindEdgesTexture(unsigned int unit) {
+        glState().bindTexture(GL_TEXTURE_2D, unit, m_Edges);
+    }
+
+    void bindWeightsTexture(unsigned int unit) {
+        glState().bindTexture(GL_TEXTURE_2D, unit, m_Weights);
+    }
+
+private:
+    void createTarget(unsigned int &framebuffer, unsigned int &texture, GLenum internalFormat, GLenum format,
+                      const char *label) {
+        glGenFramebuffers(1, &framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, m_Width, m_Height, 0, format, GL_UNSIGNED_BYTE, NULL);
+        // read with texelFetch only
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        gpuMemory().track(GpuMemory::Kind::Texture, texture, "render targets",
+                          GpuMemory::textureBytes(internalFormat, m_Width, m_Height), label);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_Stencil);
+        ASSERT(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE, "SMAA target is not complete!");
+    }
+
+    void destroyTargets() {
+        if (m_EdgesFramebuffer == 0) {
+            return;
+        }
+        for (unsigned int texture : {m_Edges, m_Weights}) {
+            gpuMemory().release(GpuMemory::Kind::Texture, texture);
+        }
+        gpuMemory().release(GpuMemory::Kind::Renderbuffer, m_Stencil);
+        glDeleteTextures(1, &m_Edges);
+        glDeleteTextures(1, &m_Weights);
+        glDeleteRenderbuffers(1, &m_Stencil);
+        glDeleteFramebuffers(1, &m_EdgesFramebuffer);
+        glDeleteFramebuffers(1, &m_WeightsFramebuffer);
+        m_Edges = m_Weights = m_Stencil = 0;
+        m_EdgesFramebuffer = m_WeightsFramebuffer = 0;
+    }
+
+    unsigned int m_EdgesFramebuffer = 0;
+    unsigned int m_WeightsFramebuffer = 0;
+    unsigned int m_Edges = 0;
+    unsigned int m_Weights = 0;
+    unsigned int m_Stencil = 0;
+    int m_Width = 0;
+    int m_Height = 0;
+};
+
+};
+
+#endif //PROJECT_BASE_SMAATARGETS_H
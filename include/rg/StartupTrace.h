@@ -0,0 +1,197 @@
+#ifndef PROJECT_BASE_STARTUPTRACE_H
+#define PROJECT_BASE_STARTUPTRACE_H
+
+#include <stb_image.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace rg {
+
+// Timeline of everything that happens before the first frame: context creation, shader compiles,
+// model imports and post-process steps, texture reads, decodes and uploads. Scopes are recorded on
+// the main thread until finish() closes the trace at the first presented frame.
+class StartupTrace {
+public:
+    struct Event {
+        std::string name;
+        const char *category;
+        std::int64_t start; // nanoseconds since the process started tracing
+        std::int64_t end;
+        std::vector<std::pair<const char *, std::uint64_t>> args;
+    };
+
+    StartupTrace() : m_Origin(std::chrono::steady_clock::now()) {
+    }
+
+    std::int64_t now() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_Origin).count();
+    }
+
+    bool recording() const {
+        return !m_Finished;
+    }
+
+    void record(Event event) {
+        if (!m_Finished) {
+            m_Events.push_back(std::move(event));
+        }
+    }
+
+    void finish() {
+        m_FirstFrame = now();
+        m_Finished = true;
+    }
+
+    // time from the start of main to the first presented frame
+    double timeToFirstFrameMs() const {
+        return m_FirstFrame / 1.0e6;
+    }
+
+    // Chrome trace format, opens in chrome://tracing and Perfetto
+    bool write(const std::string &path) const {
+        std::ofstream out(path);
+        if (!out) {
+            return false;
+        }
+        out << std::fixed << std::setprecision(3)
+            << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n"
+            << "{\"name\": \"first frame\", \"ph\": \"i\", \"s\": \"g\", \"pid\": 1, \"tid\": 0, \"ts\": "
+            << m_FirstFrame / 1000.0 << "}";
+        for (const Event &event : m_Events) {
+            out << ",\n{\"name\": \"" << escaped(event.name) << "\", \"cat\": \"" << event.category
+                << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": 0, \"ts\": " << event.start / 1000.0
+                << ", \"dur\": " << (event.end - event.start) / 1000.0 << ", \"args\": {";
+            for (size_t i = 0; i < event.args.size(); ++i) {
+                out << (i ? ", \"" : "\"") << event.args[i].first << "\": " << event.args[i].second;
+            }
+            out << "}}";
+        }
+        out << "\n]}" << std::endl;
+        return (bool) out;
+    }
+
+    // time per category and the slowest assets; categories nest (a model's textures count
+    // towards "texture" and "model"), so the rows don't add up to the total
+    void printSummary(std::ostream &out) const {
+        struct Total {
+            double ms = 0.0;
+            unsigned int count = 0;
+        };
+        std::map<std::string, Total> categories;
+        std::vector<const Event *> assets;
+        for (const Event &event : m_Events) {
+            Total &total = categories[event.category];
+            total.ms += (event.end - event.start) / 1.0e6;
+            ++total.count;
+            std::string category = event.category;
+            if (category == "model" || category == "texture" || category == "cubemap" || category == "shader") {
+                assets.push_back(&event);
+            }
+        }
+        std::sort(assets.begin(), assets.end(), [](const Event *a, const Event *b) {
+            return a->end - a->start > b->end - b->start;
+        });
+
+        out << std::fixed << std::setprecision(1)
+            << "time to first frame: " << timeToFirstFrameMs() << " ms\n";
+        for (const auto &category : categories) {
+            out << "  " << std::left << std::setw(12) << category.first << std::right << std::setw(9)
+                << category.second.ms << " ms in " << category.second.count << "\n";
+        }
+        out << "slowest assets:\n";
+        for (size_t i = 0; i < assets.size() && i < 5; ++i) {
+            out << "  " << std::setw(9) << (assets[i]->end - assets[i]->start) / 1.0e6 << " ms  "
+                << assets[i]->name << "\n";
+        }
+        out << std::flush;
+    }
+
+private:
+    static std::string escaped(const std::string &text) {
+        std::string result;
+        for (char c : text) {
+            if (c == '"' || c == '\\') {
+                result += '\\';
+            }
+            result += c;
+        }
+        return result;
+    }
+
+    std::chrono::steady_clock::time_point m_Origin;
+    std::vector<Event> m_Events;
+    std::int64_t m_FirstFrame = 0;
+    bool m_Finished = false;
+};
+
+StartupTrace& startupTrace();
+
+StartupTrace& startupTrace() {
+    static StartupTrace trace;
+    return trace;
+}
+
+// Records the enclosing block into the startup trace. Numbers attached with arg() show up in the
+// trace viewer's details pane.
+class StartupScope {
+public:
+    StartupScope(const char *category, std::string name) {
+        m_Event.category = category;
+        m_Event.name = std::move(name);
+        m_Event.start = startupTrace().now();
+    }
+
+    ~StartupScope() {
+        m_Event.end = startupTrace().now();
+        startupTrace().record(std::move(m_Event));
+    }
+
+    StartupScope(const StartupScope&) = delete;
+    StartupScope& operator=(const StartupScope&) = delete;
+
+    void arg(const char *key, std::uint64_t value) {
+        m_Event.args.emplace_back(key, value);
+    }
+
+private:
+    StartupTrace::Event m_Event;
+};
+
+// stbi_load split into a traced file read and a traced decode, so slow disks and slow
+// formats can be told apart. Free the result with stbi_image_free.
+inline unsigned char *loadImageTraced(const std::string &path, int *width, int *height, int *channels) {
+    std::vector<unsigned char> file;
+    {
+        StartupScope read("read", path);
+        std::ifstream in(path, std::ios::binary | std::ios::ate);
+        if (in) {
+            file.resize((size_t) in.tellg());
+            in.seekg(0);
+            in.read((char *) file.data(), file.size());
+        }
+        read.arg("bytes", file.size());
+    }
+    if (file.empty()) {
+        return nullptr;
+    }
+    StartupScope decode("decode", path);
+    unsigned char *data = stbi_load_from_memory(file.data(), (int) file.size(), width, height, channels, 0);
+    if (data) {
+        decode.arg("width", *width);
+        decode.arg("height", *height);
+        decode.arg("channels", *channels);
+    }
+    return data;
+}
+
+};
+
+#endif //PROJECT_BASE_STARTUPTRACE_H
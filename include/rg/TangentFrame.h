@@ -0,0 +1,100 @@
+#ifndef PROJECT_BASE_TANGENTFRAME_H
+#define PROJECT_BASE_TANGENTFRAME_H
+
+#include <glm/glm.hpp>
+#include <cmath>
+#include <cstdint>
+
+namespace rg {
+
+// A vertex's tangent frame as one unit quaternion ("QTangent") quantized to four snorm16 values, 8 bytes
+// instead of 36 for normal, tangent and bitangent. The quaternion rotates +x/+z to the tangent/normal;
+// q and -q are the same rotation, so the sign of w is free to store the bitangent's handedness.
+// resources/shaders/tangent_frame.glsl decodes it, the attribute is read as 4 x GL_SHORT normalized.
+//
+// Every input gives a defined frame: a missing normal becomes +z, a missing or degenerate tangent
+// (meshes without texture coordinates) any direction perpendicular to the normal, and a missing
+// bitangent right-handed.
+inline void packTangentFrame(glm::vec3 normal, glm::vec3 tangent, glm::vec3 bitangent, std::int16_t packed[4]) {
+    auto usable = [](const glm::vec3 &v) {
+        float length = glm::length(v);
+        return std::isfinite(length) && length > 1e-6f;
+    };
+
+    glm::vec3 n = usable(normal) ? glm::normalize(normal) : glm::vec3(0.0f, 0.0f, 1.0f);
+    glm::vec3 t = tangent - n * glm::dot(n, tangent);
+    if (!usable(t)) {
+        glm::vec3 axis = std::abs(n.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+        t = axis - n * glm::dot(n, axis);
+    }
+    t = glm::normalize(t);
+    glm::vec3 b = glm::cross(n, t);
+    float handedness = glm::dot(b, bitangent) < 0.0f ? -1.0f : 1.0f;
+
+    // rotation matrix with the columns t, b, n to a quaternion, branching on the largest diagonal
+    // element so the square root never comes close to zero
+    float x, y, z, w;
+    float trace = t.x + b.y + n.z;
+    if (trace > 0.0f) {
+        float s = std::sqrt(trace + 1.0f) * 2.0f;
+        w = 0.25f * s;
+        x = (b.z - n.y) / s;
+        y = (n.x - t.z) / s;
+        z = (t.y - b.x) / s;
+    } else if (t.x > b.y && t.x > n.z) {
+        float s = std::sqrt(1.0f + t.x - b.y - n.z) * 2.0f;
+        w = (b.z - n.y) / s;
+        x = 0.25f * s;
+        y = (b.x + t.y) / s;
+        z = (n.x + t.z) / s;
+    } else if (b.y > n.z) {
+        float s = std::sqrt(1.0f + b.y - t.x - n.z) * 2.0f;
+        w = (n.x - t.z) / s;
+        x = (b.x + t.y) / s;
+        y = 0.25f * s;
+        z = (n.y + b.z) / s;
+    } else {
+        float s = std::sqrt(1.0f + n.z - t.x - b.y) * 2.0f;
+        w = (t.y - b.x) / s;
+        x = (n.x + t.z) / s;
+        y = (n.y + b.z) / s;
+        z = 0.25f * s;
+    }
+    float length = std::sqrt(x * x + y * y + z * z + w * w);
+    x /= length;
+    y /= length;
+    z /= length;
+    w /= length;
+
+    // positive w, at least one quantization step away from zero so its sign survives snorm16
+    if (w < 0.0f) {
+        x = -x;
+        y = -y;
+        z = -z;
+        w = -w;
+    }
+    const float bias = 1.0f / 32767.0f;
+    if (w < bias) {
+        float scale = std::sqrt(1.0f - bias * bias) / std::sqrt(x * x + y * y + z * z);
+        x *= scale;
+        y *= scale;
+        z *= scale;
+        w = bias;
+    }
+    if (handedness < 0.0f) {
+        x = -x;
+        y = -y;
+        z = -z;
+        w = -w;
+    }
+
+    const float components[4] = {x, y, z, w};
+    for (int i = 0; i < 4; i++) {
+        float clamped = components[i] < -1.0f ? -1.0f : (components[i] > 1.0f ? 1.0f : components[i]);
+        packed[i] = (std::int16_t) std::lround(clamped * 32767.0f);
+    }
+}
+
+};
+
+#endif //PROJECT_BASE_TANGENTFRAME_H
@@ -0,0 +1,128 @@
+#ifndef PROJECT_BASE_THREADPOOL_H
+#define PROJECT_BASE_THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace rg {
+
+// Fixed set of worker threads for data parallel CPU work inside a frame. parallelFor blocks
+// until every index was processed; the calling thread takes part in the work as well.
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned int workerCount = defaultWorkerCount()) {
+        for (unsigned int i = 0; i < workerCount; ++i) {
+            m_Workers.emplace_back([this]() { workerLoop(); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Stopping = true;
+        }
+        m_WorkAvailable.notify_all();
+        for (std::thread& worker : m_Workers) {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // calls job(index) for every index in [0, count), indices are handed out one at a time
+    void parallelFor(unsigned int count, const std::function<void(unsigned int)>& job) {
+        if (count == 0) {
+            return;
+        }
+        {
+            // a worker that woke up late for the previous call may still be in runJobs, it must be out
+            // before m_Next is reset or it would take indices of this call with the old job
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_WorkDone.wait(lock, [this]() { return m_Active == 0; });
+            m_Job = &job;
+            m_Count = count;
+            m_Next = 0;
+            m_Remaining = count;
+            ++m_Generation;
+        }
+        m_WorkAvailable.notify_all();
+        runJobs(&job);
+
+        // workers still inside runJobs hold the job pointer, wait for them as well
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        m_WorkDone.wait(lock, [this]() { return m_Remaining == 0 && m_Active == 0; });
+        m_Job = nullptr;
+    }
+
+    unsigned int threadCount() const {
+        return m_Workers.size() + 1;
+    }
+
+    static unsigned int defaultWorkerCount() {
+        unsigned int hardware = std::thread::hardware_concurrency();
+        return hardware > 1 ? hardware - 1 : 0;
+    }
+
+private:
+    void workerLoop() {
+        unsigned int seenGeneration = 0;
+        while (true) {
+            const std::function<void(unsigned int)>* job;
+            {
+                std::unique_lock<std::mutex> lock(m_Mutex);
+                m_WorkAvailable.wait(lock, [&]() { return m_Stopping || m_Generation != seenGeneration; });
+                if (m_Stopping) {
+                    return;
+                }
+                seenGeneration = m_Generation;
+                job = m_Job;
+                // woke up after the call was already over
+                if (job == nullptr) {
+                    continue;
+                }
+                ++m_Active;
+            }
+            runJobs(job);
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            if (--m_Active == 0 && m_Remaining == 0) {
+                m_WorkDone.notify_all();
+            }
+        }
+    }
+
+    void runJobs(const std::function<void(unsigned int)>* job) {
+        unsigned int done = 0;
+        for (unsigned int index = m_Next++; index < m_Count; index = m_Next++) {
+            (*job)(index);
+            ++done;
+        }
+        if (done > 0) {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Remaining -= done;
+            if (m_Remaining == 0 && m_Active == 0) {
+                m_WorkDone.notify_all();
+            }
+        }
+    }
+
+    std::vector<std::thread> m_Workers;
+    std::mutex m_Mutex;
+    std::condition_variable m_WorkAvailable;
+    std::condition_variable m_WorkDone;
+    const std::function<void(unsigned int)>* m_Job = nullptr;
+    std::atomic<unsigned int> m_Count{0};
+    std::atomic<unsigned int> m_Next{0};
+    unsigned int m_Remaining = 0;
+    unsigned int m_Active = 0;
+    unsigned int m_Generation = 0;
+    bool m_Stopping = false;
+};
+
+};
+
+#endif //PROJECT_BASE_THREADPOOL_H
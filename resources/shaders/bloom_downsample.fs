@@ -0,0 +1,53 @@
+#version 330 core
+out vec4 FragColor;
+
+// One step down the bloom chain (rg/BloomChain.h): a 4x4 box of the level above from five bilinear
+// fetches, the centre one weighted like the four corners together. With BLOOM_PREFILTER it reads the
+// scene into level 0: each fetch is weighted by 1 / (1 + luma) so a single very bright pixel can't
+// flicker as the camera moves, then only what is above the threshold (with a soft knee) is kept.
+
+uniform sampler2D source;
+uniform vec2 targetSize;
+
+#ifdef BLOOM_PREFILTER
+uniform float threshold;
+
+vec3 Prefilter(vec3 color)
+{
+    float knee = 0.5 * threshold;
+    float brightness = max(color.r, max(color.g, color.b));
+    float soft = clamp(brightness - threshold + knee, 0.0, 2.0 * knee);
+    soft = soft * soft / (4.0 * knee + 1e-4);
+    return color * (max(soft, brightness - threshold) / max(brightness, 1e-4));
+}
+
+float KarisWeight(vec3 color)
+{
+    return 1.0 / (1.0 + dot(color, vec3(0.2126, 0.7152, 0.0722)));
+}
+#endif
+
+void main()
+{
+    vec2 uv = gl_FragCoord.xy / targetSize;
+    // half a texel here is a texel of the source, each fetch averages 2x2 source texels
+    vec2 offset = 0.5 / targetSize;
+    vec3 center = texture(source, uv).rgb;
+    vec3 corners[4] = vec3[](texture(source, uv - offset).rgb,
+                             texture(source, uv + offset).rgb,
+                             texture(source, uv + vec2(offset.x, -offset.y)).rgb,
+                             texture(source, uv + vec2(-offset.x, offset.y)).rgb);
+#ifdef BLOOM_PREFILTER
+    float centerWeight = 4.0 * KarisWeight(center);
+    vec3 sum = center * centerWeight;
+    float weights = centerWeight;
+    for (int i = 0; i < 4; i++) {
+        float weight = KarisWeight(corners[i]);
+        sum += corners[i] * weight;
+        weights += weight;
+    }
+    FragColor = vec4(Prefilter(sum / weights), 1.0);
+#else
+    FragColor = vec4((4.0 * center + corners[0] + corners[1] + corners[2] + corners[3]) / 8.0, 1.0);
+#endif
+}
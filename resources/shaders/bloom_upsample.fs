@@ -0,0 +1,23 @@
+#version 330 core
+out vec4 FragColor;
+
+// One step up the bloom chain (rg/BloomChain.h): a tent filter over the smaller level from eight
+// bilinear fetches, added onto the level this is drawn into by the blending.
+
+uniform sampler2D source;
+uniform vec2 targetSize;
+
+void main()
+{
+    vec2 uv = gl_FragCoord.xy / targetSize;
+    vec2 offset = 0.5 / vec2(textureSize(source, 0));
+    vec3 edges = texture(source, uv + vec2(-2.0 * offset.x, 0.0)).rgb
+                 + texture(source, uv + vec2(2.0 * offset.x, 0.0)).rgb
+                 + texture(source, uv + vec2(0.0, -2.0 * offset.y)).rgb
+                 + texture(source, uv + vec2(0.0, 2.0 * offset.y)).rgb;
+    vec3 diagonals = texture(source, uv + offset).rgb
+                     + texture(source, uv - offset).rgb
+                     + texture(source, uv + vec2(offset.x, -offset.y)).rgb
+                     + texture(source, uv + vec2(-offset.x, offset.y)).rgb;
+    FragColor = vec4((edges + 2.0 * diagonals) / 12.0, 1.0);
+}
@@ -0,0 +1,46 @@
+// The clustered light grid, see rg/ClusteredLighting.h for the layout. Needs the view matrix to find
+// a fragment's depth slice.
+#include "lights.glsl"
+
+uniform mat4 view;
+uniform samplerBuffer clusterLights;
+uniform usamplerBuffer clusterGrid;
+uniform usamplerBuffer clusterIndices;
+uniform vec2 clusterTileSize;
+uniform float clusterNear;
+uniform float clusterFar;
+
+const uint CLUSTER_TILES_X = 16u;
+const uint CLUSTER_TILES_Y = 9u;
+const uint CLUSTER_SLICES = 24u;
+
+// (first index in clusterIndices, light count) of the cluster the fragment is in
+uvec2 FindCluster(vec3 fragPos)
+{
+    float depth = -(view * vec4(fragPos, 1.0)).z;
+    uint slice = uint(clamp(floor(log(depth / clusterNear) / log(clusterFar / clusterNear) * float(CLUSTER_SLICES)), 0.0, float(CLUSTER_SLICES - 1u)));
+    uvec2 tile = min(uvec2(gl_FragCoord.xy / clusterTileSize), uvec2(CLUSTER_TILES_X - 1u, CLUSTER_TILES_Y - 1u));
+    uint cluster = (slice * CLUSTER_TILES_Y + tile.y) * CLUSTER_TILES_X + tile.x;
+    return texelFetch(clusterGrid, int(cluster)).rg;
+}
+
+// the i-th light of a cluster and the radius it was culled with
+PointLight ClusterLight(uvec2 cluster, uint i, out float radius)
+{
+    int index = int(texelFetch(clusterIndices, int(cluster.x + i)).r);
+    vec4 positionRadius = texelFetch(clusterLights, index * 4);
+    vec4 ambientConstant = texelFetch(clusterLights, index * 4 + 1);
+    vec4 diffuseLinear = texelFetch(clusterLights, index * 4 + 2);
+    vec4 specularQuadratic = texelFetch(clusterLights, index * 4 + 3);
+
+    PointLight light;
+    light.position = positionRadius.xyz;
+    light.ambient = ambientConstant.rgb;
+    light.constant = ambientConstant.w;
+    light.diffuse = diffuseLinear.rgb;
+    light.linear = diffuseLinear.w;
+    light.specular = specularQuadratic.rgb;
+    light.quadratic = specularQuadratic.w;
+    radius = positionRadius.w;
+    return light;
+}
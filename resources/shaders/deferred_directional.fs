@@ -0,0 +1,26 @@
+#version 330 core
+out vec4 FragColor;
+
+#include "scene_lights.glsl"
+
+uniform sampler2D gPosition;
+uniform sampler2D gNormal;
+uniform sampler2D gAlbedoSpec;
+
+uniform vec3 viewPosition;
+uniform vec2 screenSize;
+uniform float shininess;
+
+void main()
+{
+    vec2 uv = gl_FragCoord.xy / screenSize;
+    vec3 fragPos = texture(gPosition, uv).rgb;
+    vec3 normal = texture(gNormal, uv).rgb;
+    vec4 albedoSpec = texture(gAlbedoSpec, uv);
+    // nothing was written to the G-buffer here, the sky is drawn later in the forward pass
+    if (dot(normal, normal) == 0.0)
+        discard;
+
+    vec3 viewDir = normalize(viewPosition - fragPos);
+    FragColor = vec4(ShadeDirLight(dirLight, normal, viewDir, albedoSpec.rgb, albedoSpec.a, shininess), 1.0);
+}
@@ -0,0 +1,10 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+
+uniform mat4 mvp;
+uniform bool fullscreen;
+
+void main()
+{
+    gl_Position = fullscreen ? vec4(aPos.xy, 0.0, 1.0) : mvp * vec4(aPos, 1.0);
+}
@@ -0,0 +1,30 @@
+#version 330 core
+out vec4 FragColor;
+
+#include "lights.glsl"
+
+uniform sampler2D gPosition;
+uniform sampler2D gNormal;
+uniform sampler2D gAlbedoSpec;
+
+uniform PointLight pointLight;
+uniform float radius;
+uniform vec3 viewPosition;
+uniform vec2 screenSize;
+uniform float shininess;
+
+void main()
+{
+    vec2 uv = gl_FragCoord.xy / screenSize;
+    vec3 fragPos = texture(gPosition, uv).rgb;
+    vec3 normal = texture(gNormal, uv).rgb;
+    float distance = length(pointLight.position - fragPos);
+    // the volume covers pixels in front of and behind the light, only its inside is lit
+    if (dot(normal, normal) == 0.0 || distance > radius)
+        discard;
+    vec4 albedoSpec = texture(gAlbedoSpec, uv);
+
+    vec3 viewDir = normalize(viewPosition - fragPos);
+    FragColor = vec4(ShadePointLight(pointLight, pointLight.position - fragPos, normal, viewDir, albedoSpec.rgb,
+                                     albedoSpec.a, shininess), 1.0);
+}
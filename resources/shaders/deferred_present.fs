@@ -0,0 +1,10 @@
+#version 330 core
+out vec4 FragColor;
+
+uniform sampler2D lightBuffer;
+uniform vec2 screenSize;
+
+void main()
+{
+    FragColor = vec4(texture(lightBuffer, gl_FragCoord.xy / screenSize).rgb, 1.0);
+}
@@ -0,0 +1,106 @@
+// FXAA (after Lottes' FXAA 3.11, quality preset 12): finds the local edge from the luma of the 3x3
+// neighbourhood, walks along it in both directions to its ends and shifts the lookup across the edge
+// by how far the pixel is from the nearer end, plus a subpixel blend for single pixel features.
+// Filters the HDR scene by its PerceptualLuma, tonemap.glsl has to be included first.
+
+const float fxaaEdgeThreshold = 0.125;
+const float fxaaEdgeThresholdMin = 0.0312;
+const float fxaaSubpixel = 0.75;
+// preset 12's search: five steps along the edge, growing so the last one reaches 21 texels out
+const int fxaaSearchSteps = 5;
+const float fxaaSearchStride[fxaaSearchSteps] = float[](1.0, 1.5, 2.0, 4.0, 12.0);
+
+float FxaaLuma(vec3 color)
+{
+    return PerceptualLuma(color);
+}
+
+float FxaaLumaAt(sampler2D color, vec2 uv)
+{
+    return FxaaLuma(texture(color, uv).rgb);
+}
+
+vec3 Fxaa(sampler2D color, vec2 uv)
+{
+    vec2 texel = 1.0 / vec2(textureSize(color, 0));
+    vec3 center = texture(color, uv).rgb;
+    float lumaM = FxaaLuma(center);
+    float lumaN = FxaaLumaAt(color, uv + vec2(0.0, texel.y));
+    float lumaS = FxaaLumaAt(color, uv - vec2(0.0, texel.y));
+    float lumaE = FxaaLumaAt(color, uv + vec2(texel.x, 0.0));
+    float lumaW = FxaaLumaAt(color, uv - vec2(texel.x, 0.0));
+    float lumaMax = max(lumaM, max(max(lumaN, lumaS), max(lumaE, lumaW)));
+    float lumaMin = min(lumaM, min(min(lumaN, lumaS), min(lumaE, lumaW)));
+    float range = lumaMax - lumaMin;
+    if (range < max(fxaaEdgeThresholdMin, lumaMax * fxaaEdgeThreshold))
+        return center;
+
+    float lumaNE = FxaaLumaAt(color, uv + texel);
+    float lumaSW = FxaaLumaAt(color, uv - texel);
+    float lumaNW = FxaaLumaAt(color, uv + vec2(-texel.x, texel.y));
+    float lumaSE = FxaaLumaAt(color, uv + vec2(texel.x, -texel.y));
+
+    // a horizontal edge changes more from row to row than from column to column
+    float edgeHorizontal = abs(lumaNW + lumaSW - 2.0 * lumaW) + 2.0 * abs(lumaN + lumaS - 2.0 * lumaM)
+                           + abs(lumaNE + lumaSE - 2.0 * lumaE);
+    float edgeVertical = abs(lumaNW + lumaNE - 2.0 * lumaN) + 2.0 * abs(lumaW + lumaE - 2.0 * lumaM)
+                         + abs(lumaSW + lumaSE - 2.0 * lumaS);
+    bool horizontal = edgeHorizontal >= edgeVertical;
+
+    // the side of the pixel with the stronger gradient is the other side of the edge
+    float luma1 = horizontal ? lumaS : lumaW;
+    float luma2 = horizontal ? lumaN : lumaE;
+    float gradient1 = abs(luma1 - lumaM);
+    float gradient2 = abs(luma2 - lumaM);
+    float stepLength = horizontal ? texel.y : texel.x;
+    float lumaLocal;
+    if (gradient1 >= gradient2) {
+        stepLength = -stepLength;
+        lumaLocal = 0.5 * (luma1 + lumaM);
+    } else {
+        lumaLocal = 0.5 * (luma2 + lumaM);
+    }
+    float gradientScaled = 0.25 * max(gradient1, gradient2);
+
+    // walk along the edge, half a texel across so each bilinear fetch averages both sides
+    vec2 edgeUv = uv + (horizontal ? vec2(0.0, 0.5 * stepLength) : vec2(0.5 * stepLength, 0.0));
+    vec2 along = horizontal ? vec2(texel.x, 0.0) : vec2(0.0, texel.y);
+    vec2 uv1 = edgeUv - along * fxaaSearchStride[0];
+    vec2 uv2 = edgeUv + along * fxaaSearchStride[0];
+    float end1 = FxaaLumaAt(color, uv1) - lumaLocal;
+    float end2 = FxaaLumaAt(color, uv2) - lumaLocal;
+    bool reached1 = abs(end1) >= gradientScaled;
+    bool reached2 = abs(end2) >= gradientScaled;
+    for (int i = 1; i < fxaaSearchSteps && !(reached1 && reached2); i++) {
+        float stride = fxaaSearchStride[i];
+        if (!reached1) {
+            uv1 -= along * stride;
+            end1 = FxaaLumaAt(color, uv1) - lumaLocal;
+            reached1 = abs(end1) >= gradientScaled;
+        }
+        if (!reached2) {
+            uv2 += along * stride;
+            end2 = FxaaLumaAt(color, uv2) - lumaLocal;
+            reached2 = abs(end2) >= gradientScaled;
+        }
+    }
+
+    float distance1 = horizontal ? uv.x - uv1.x : uv.y - uv1.y;
+    float distance2 = horizontal ? uv2.x - uv.x : uv2.y - uv.y;
+    bool nearer1 = distance1 < distance2;
+    float distanceNearest = min(distance1, distance2);
+    // only shift when the luma at the nearer end goes the other way than the pixel's
+    bool centerSmaller = lumaM - lumaLocal < 0.0;
+    bool correctVariation = ((nearer1 ? end1 : end2) < 0.0) != centerSmaller;
+    float edgeOffset = correctVariation ? 0.5 - distanceNearest / (distance1 + distance2) : 0.0;
+
+    // single pixel features get the subpixel blend from the 3x3 average instead
+    float lumaAverage = (2.0 * (lumaN + lumaS + lumaE + lumaW) + lumaNE + lumaNW + lumaSE + lumaSW) / 12.0;
+    float subpixel = clamp(abs(lumaAverage - lumaM) / range, 0.0, 1.0);
+    subpixel = smoothstep(0.0, 1.0, subpixel);
+    float subpixelOffset = subpixel * subpixel * fxaaSubpixel;
+
+    float offset = max(edgeOffset, subpixelOffset);
+    vec2 finalUv = uv + (horizontal ? vec2(0.0, offset * stepLength) : vec2(offset * stepLength, 0.0));
+    return texture(color, finalUv).rgb;
+}
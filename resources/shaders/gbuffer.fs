@@ -0,0 +1,25 @@
+#version 330 core
+layout (location = 0) out vec3 gPosition;
+layout (location = 1) out vec3 gNormal;
+layout (location = 2) out vec4 gAlbedoSpec;
+
+struct Material {
+    sampler2D texture_diffuse1;
+    sampler2D texture_specular1;
+    sampler2D texture_normal1;
+};
+
+in vec3 FragPos;
+in vec2 TexCoords;
+in mat3 TBN;
+
+uniform Material material;
+
+void main()
+{
+    gPosition = FragPos;
+    vec3 normal = texture(material.texture_normal1, TexCoords).rgb;
+    gNormal = normalize(TBN * normalize(normal * 2.0 - 1.0));
+    gAlbedoSpec.rgb = texture(material.texture_diffuse1, TexCoords).rgb;
+    gAlbedoSpec.a = texture(material.texture_specular1, TexCoords).r;
+}
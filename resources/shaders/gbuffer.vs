@@ -0,0 +1,33 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec4 aTangentFrame;
+layout (location = 2) in vec2 aTexCoords;
+
+#include "tangent_frame.glsl"
+
+out vec3 FragPos;
+out vec2 TexCoords;
+out mat3 TBN;
+
+uniform mat4 model;
+// transpose(inverse(mat3(model))), computed once per draw on the CPU instead of once per vertex
+uniform mat3 normalMatrix;
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+    FragPos = vec3(model * vec4(aPos, 1.0));
+    TexCoords = aTexCoords;
+    vec3 tangent, normal;
+    float handedness;
+    DecodeTangentFrame(aTangentFrame, tangent, normal, handedness);
+    vec3 T = normalize(normalMatrix * tangent);
+    vec3 N = normalize(normalMatrix * normal);
+    T = normalize(T - dot(T, N) * N);
+    vec3 B = handedness * cross(N, T);
+
+    // tangent to world space, the G-buffer stores world space normals
+    TBN = mat3(T, B, N);
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
@@ -0,0 +1,61 @@
+// Light structs and Blinn-Phong terms shared by the lighting shaders, included with #include "lights.glsl".
+// The structs are laid out for std140 and mirrored by rg/Lights.h, which checks the layout against the
+// linked programs; change both together.
+
+struct PointLight {
+    vec3 position;
+    float constant;
+    vec3 ambient;
+    float linear;
+    vec3 diffuse;
+    float quadratic;
+    vec3 specular;
+};
+
+struct DirLight {
+    vec3 direction;
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+float DiffuseFactor(vec3 normal, vec3 lightDir)
+{
+    return max(dot(normal, lightDir), 0.0);
+}
+
+float SpecularFactor(vec3 normal, vec3 lightDir, vec3 viewDir, float shininess)
+{
+    vec3 halfwayDir = normalize(lightDir + viewDir);
+    return pow(max(dot(normal, halfwayDir), 0.0), shininess);
+}
+
+float Attenuation(PointLight light, float distance)
+{
+    return 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+}
+
+// ambient and diffuse tinted by albedo, specular scaled by specularMask. Define NO_SPECULAR before the
+// include to drop the specular term
+vec3 ShadeDirLight(DirLight light, vec3 normal, vec3 viewDir, vec3 albedo, float specularMask, float shininess)
+{
+    vec3 lightDir = normalize(-light.direction);
+    vec3 color = (light.ambient + light.diffuse * DiffuseFactor(normal, lightDir)) * albedo;
+#ifndef NO_SPECULAR
+    color += light.specular * SpecularFactor(normal, lightDir, viewDir, shininess) * specularMask;
+#endif
+    return color;
+}
+
+// toLight: from the fragment to the light, in the same space as normal and viewDir
+vec3 ShadePointLight(PointLight light, vec3 toLight, vec3 normal, vec3 viewDir, vec3 albedo, float specularMask,
+                     float shininess)
+{
+    float distance = length(toLight);
+    vec3 lightDir = toLight / distance;
+    vec3 color = (light.ambient + light.diffuse * DiffuseFactor(normal, lightDir)) * albedo;
+#ifndef NO_SPECULAR
+    color += light.specular * SpecularFactor(normal, lightDir, viewDir, shininess) * specularMask;
+#endif
+    return color * Attenuation(light, distance);
+}
@@ -1,30 +1,21 @@
 #version 330 core
 out vec4 FragColor;
 
-struct PointLight {
-    vec3 position;
-
-    vec3 specular;
-    vec3 diffuse;
-    vec3 ambient;
-
-    float constant;
-    float linear;
-    float quadratic;
-};
-
-struct DirLight {
-    vec3 direction;
-
-    vec3 specular;
-    vec3 diffuse;
-    vec3 ambient;
-};
+#ifndef HAS_SPECULAR_MAP
+#define NO_SPECULAR
+#endif
+#include "scene_lights.glsl"
 
 struct Material {
+#ifdef HAS_DIFFUSE_MAP
     sampler2D texture_diffuse1;
+#endif
+#ifdef HAS_SPECULAR_MAP
     sampler2D texture_specular1;
+#endif
+#ifdef HAS_NORMAL_MAP
     sampler2D texture_normal1;
+#endif
     float shininess;
 };
 in vec2 TexCoords;
@@ -35,59 +26,42 @@ in vec3 TangentLightPos;
 in vec3 TangentFragPos;
 in vec3 TangentViewPos;
 
-uniform PointLight pointLight;
-uniform PointLight pointLightHouse;
-uniform DirLight dirLight;
+// the variant defines (see rg::ShaderVariants) decide which maps are sampled and how many of the
+// scene's point lights are evaluated (at most 2); without them nothing is sampled and both lights are
+#ifndef NUM_POINT_LIGHTS
+#define NUM_POINT_LIGHTS 2
+#endif
+
 uniform Material material;
 
 uniform vec3 viewPosition;
 uniform vec3 lightPos;
 
-// calculates the color when using a point light.
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
-{
-vec3 lightDir = normalize(TangentLightPos - TangentFragPos);    // diffuse shading
-    float diff = max(dot(normal, lightDir), 0.0);
-    // specular shading
-    vec3 halfwayDir = normalize(lightDir + normal);
-    float spec = pow(max(dot(viewDir, halfwayDir), 0.0), material.shininess);
-
-    // attenuation
-    float distance = length(TangentLightPos - TangentFragPos);     float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
-
-    // combine results
-    vec3 ambient = light.ambient * vec3(texture(material.texture_diffuse1, TexCoords));
-    vec3 diffuse = light.diffuse * diff * vec3(texture(material.texture_diffuse1, TexCoords));
-    vec3 specular = light.specular * spec * vec3(texture(material.texture_specular1, TexCoords).xxx);
-    ambient *= attenuation;
-    diffuse *= attenuation;
-    specular *= attenuation;
-    return (ambient + diffuse + specular);
-}
-
-vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir)
-{
-   vec3 lightDir = normalize(-light.direction);
-   // diffuse shading
-   float diff = max(dot(normal, lightDir), 0.0);
-   // specular shading
-   vec3 halfwayDir = normalize(lightDir + viewDir);
-   float spec = pow(max(dot(normal, halfwayDir), 0.0), material.shininess);
-
-   // combine results
-   vec3 ambient = light.ambient * vec3(texture(material.texture_diffuse1, TexCoords));
-   vec3 diffuse = light.diffuse * diff * vec3(texture(material.texture_diffuse1, TexCoords));
-   vec3 specular = light.specular * spec * vec3(texture(material.texture_specular1, TexCoords).xxx);
-   return (ambient + diffuse + specular);
-}
-
 void main()
 {
+    // each map is sampled once, not once per light
+#ifdef HAS_DIFFUSE_MAP
+    vec3 albedo = texture(material.texture_diffuse1, TexCoords).rgb;
+#else
+    vec3 albedo = vec3(1.0);
+#endif
+#ifdef HAS_SPECULAR_MAP
+    float specularMask = texture(material.texture_specular1, TexCoords).r;
+#else
+    float specularMask = 0.0;
+#endif
+#ifdef HAS_NORMAL_MAP
     vec3 normal = texture(material.texture_normal1, TexCoords).rgb;
     normal = normalize(normal * 2.0 - 1.0);
+#else
+    // lighting happens in tangent space, where the unperturbed surface normal is +z
+    vec3 normal = vec3(0.0, 0.0, 1.0);
+#endif
     vec3 viewDir = normalize(TangentViewPos - TangentFragPos);
-    vec3 result = CalcDirLight(dirLight, normal, viewDir);
-    result += CalcPointLight(pointLight, normal, TangentFragPos, viewDir);
-    result += CalcPointLight(pointLightHouse, normal, TangentFragPos, viewDir);
+    vec3 result = ShadeDirLight(dirLight, normal, viewDir, albedo, specularMask, material.shininess);
+    // lightPos (the house lamp) was moved to tangent space by the vertex shader
+    for (int i = 0; i < NUM_POINT_LIGHTS; i++)
+        result += ShadePointLight(pointLights[i], TangentLightPos - TangentFragPos, normal, viewDir, albedo,
+                                  specularMask, material.shininess);
     FragColor = vec4(result, 1.0);
 }
\ No newline at end of file
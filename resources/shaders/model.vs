@@ -1,9 +1,9 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec3 aNormal;
+layout (location = 1) in vec4 aTangentFrame;
 layout (location = 2) in vec2 aTexCoords;
-layout (location = 3) in vec3 aTangent;
-layout (location = 4) in vec3 aBitangent;
+
+#include "tangent_frame.glsl"
 
 out vec2 TexCoords;
 out vec3 Normal;
@@ -14,6 +14,8 @@ out vec3 TangentFragPos;
 out vec3 TangentViewPos;
 
 uniform mat4 model;
+// transpose(inverse(mat3(model))), computed once per draw on the CPU instead of once per vertex
+uniform mat3 normalMatrix;
 uniform mat4 view;
 uniform mat4 projection;
 
@@ -23,11 +25,13 @@ void main()
 {
     FragPos = vec3(model * vec4(aPos, 1.0));
     TexCoords = aTexCoords;
-    mat3 normalMatrix = transpose(inverse(mat3(model)));
-    vec3 T = normalize(normalMatrix * aTangent);
-    vec3 N = normalize(normalMatrix * aNormal);
+    vec3 tangent, normal;
+    float handedness;
+    DecodeTangentFrame(aTangentFrame, tangent, normal, handedness);
+    vec3 T = normalize(normalMatrix * tangent);
+    vec3 N = normalize(normalMatrix * normal);
     T = normalize(T - dot(T, N) * N);
-    vec3 B = cross(N, T);
+    vec3 B = handedness * cross(N, T);
 
     mat3 TBN = transpose(mat3(T, B, N));
     TangentLightPos = TBN * lightPos;
@@ -0,0 +1,39 @@
+#version 330 core
+out vec4 FragColor;
+
+#include "scene_lights.glsl"
+#include "clusters.glsl"
+
+struct Material {
+    sampler2D texture_diffuse1;
+    sampler2D texture_specular1;
+    sampler2D texture_normal1;
+    float shininess;
+};
+
+in vec3 FragPos;
+in vec2 TexCoords;
+in mat3 TBN;
+
+uniform Material material;
+uniform vec3 viewPosition;
+
+void main()
+{
+    vec3 normal = texture(material.texture_normal1, TexCoords).rgb;
+    normal = normalize(TBN * normalize(normal * 2.0 - 1.0));
+    vec3 albedo = texture(material.texture_diffuse1, TexCoords).rgb;
+    float specularMask = texture(material.texture_specular1, TexCoords).r;
+    vec3 viewDir = normalize(viewPosition - FragPos);
+
+    vec3 result = ShadeDirLight(dirLight, normal, viewDir, albedo, specularMask, material.shininess);
+    uvec2 cluster = FindCluster(FragPos);
+    for (uint i = 0u; i < cluster.y; i++) {
+        float radius;
+        PointLight light = ClusterLight(cluster, i, radius);
+        vec3 toLight = light.position - FragPos;
+        if (length(toLight) <= radius)
+            result += ShadePointLight(light, toLight, normal, viewDir, albedo, specularMask, material.shininess);
+    }
+    FragColor = vec4(result, 1.0);
+}
@@ -0,0 +1,43 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec4 aTangentFrame;
+layout (location = 2) in vec2 aTexCoords;
+layout (location = 5) in mat4 aInstanceModel;
+// transpose(inverse(mat3(aInstanceModel))), written next to the model matrix by rg::InstanceBuffer
+layout (location = 9) in mat3 aInstanceNormalMatrix;
+
+#include "tangent_frame.glsl"
+
+out vec2 TexCoords;
+out vec3 Normal;
+out vec3 FragPos;
+out mat3 TBN;
+out vec3 TangentLightPos;
+out vec3 TangentFragPos;
+out vec3 TangentViewPos;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+uniform vec3 lightPos;
+uniform vec3 viewPos;
+void main()
+{
+    mat4 model = aInstanceModel;
+    FragPos = vec3(model * vec4(aPos, 1.0));
+    TexCoords = aTexCoords;
+    mat3 normalMatrix = aInstanceNormalMatrix;
+    vec3 tangent, normal;
+    float handedness;
+    DecodeTangentFrame(aTangentFrame, tangent, normal, handedness);
+    vec3 T = normalize(normalMatrix * tangent);
+    vec3 N = normalize(normalMatrix * normal);
+    T = normalize(T - dot(T, N) * N);
+    vec3 B = handedness * cross(N, T);
+
+    mat3 TBN = transpose(mat3(T, B, N));
+    TangentLightPos = TBN * lightPos;
+    TangentViewPos  = TBN * viewPos;
+    TangentFragPos  = TBN * FragPos;
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
\ No newline at end of file
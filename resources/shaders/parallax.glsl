@@ -0,0 +1,59 @@
+// Parallax mapping of the floor shaders. depthMap is read as depth below the surface, heightScale
+// (Q/E) scales it in both modes. parallaxMode 0 is the single-sample offset, 1 parallax occlusion
+// mapping: a ray march through the depth map whose layer count grows at grazing angles and shrinks
+// with distance, fading into plain normal mapping before parallaxFadeDistance.
+
+uniform sampler2D depthMap;
+uniform float heightScale;
+uniform int parallaxMode;
+
+const float parallaxMinLayers = 8.0;
+const float parallaxMaxLayers = 32.0;
+const float parallaxFadeDistance = 30.0;
+
+vec2 ParallaxOffset(vec2 texCoords, vec3 viewDir)
+{
+    float height = texture(depthMap, texCoords).r;
+    return texCoords - viewDir.xy * (height * heightScale);
+}
+
+// viewDir: tangent space, towards the eye; viewDistance: world units to the eye
+vec2 ParallaxOcclusion(vec2 texCoords, vec3 viewDir, float viewDistance)
+{
+    // the gradients are taken here, in uniform control flow: the early return below differs between
+    // neighbouring pixels near the fade distance and the loop has a varying trip count
+    vec2 dx = dFdx(texCoords);
+    vec2 dy = dFdy(texCoords);
+    float fade = 1.0 - smoothstep(0.5 * parallaxFadeDistance, parallaxFadeDistance, viewDistance);
+    if (fade <= 0.0 || heightScale <= 0.0)
+        return texCoords;
+
+    float layers = mix(parallaxMaxLayers, parallaxMinLayers, abs(viewDir.z));
+    layers = max(parallaxMinLayers, floor(layers * fade));
+    float layerDepth = 1.0 / layers;
+    // the whole march moves this far in texture space, faded out with the layer count
+    vec2 deltaTexCoords = viewDir.xy / max(viewDir.z, 0.05) * heightScale * fade / layers;
+
+    vec2 currentTexCoords = texCoords;
+    float currentLayerDepth = 0.0;
+    float currentDepth = textureGrad(depthMap, currentTexCoords, dx, dy).r;
+    for (int i = 0; i < int(parallaxMaxLayers) && currentLayerDepth < currentDepth; i++) {
+        currentTexCoords -= deltaTexCoords;
+        currentDepth = textureGrad(depthMap, currentTexCoords, dx, dy).r;
+        currentLayerDepth += layerDepth;
+    }
+
+    // interpolate between the layers before and after the intersection
+    vec2 previousTexCoords = currentTexCoords + deltaTexCoords;
+    float after = currentDepth - currentLayerDepth;
+    float before = textureGrad(depthMap, previousTexCoords, dx, dy).r - currentLayerDepth + layerDepth;
+    float weight = after / (after - before);
+    return mix(currentTexCoords, previousTexCoords, weight);
+}
+
+vec2 ParallaxCoords(vec2 texCoords, vec3 viewDir, float viewDistance)
+{
+    if (parallaxMode == 1)
+        return ParallaxOcclusion(texCoords, viewDir, viewDistance);
+    return ParallaxOffset(texCoords, viewDir);
+}
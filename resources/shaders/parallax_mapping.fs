@@ -1,33 +1,27 @@
 #version 330 core
 out vec4 FragColor;
 
+#include "lights.glsl"
+#include "parallax.glsl"
+
 in VS_OUT {
     vec3 FragPos;
     vec2 TexCoords;
     vec3 TangentLightPos;
     vec3 TangentViewPos;
     vec3 TangentFragPos;
+    mat3 TBN;
 } fs_in;
 
 uniform sampler2D diffuseMap;
 uniform sampler2D normalMap;
-uniform sampler2D depthMap;
-
-uniform float heightScale;
-
-vec2 ParallaxMapping(vec2 texCoords, vec3 viewDir)
-{
-    float height =  texture(depthMap, texCoords).r;
-    return texCoords - viewDir.xy * (height * heightScale);
-}
 
 void main()
 {
-    // offset texture coordinates with Parallax Mapping
+    // offset texture coordinates with parallax (occlusion) mapping
     vec3 viewDir = normalize(fs_in.TangentViewPos - fs_in.TangentFragPos);
-    vec2 texCoords = fs_in.TexCoords;
-
-    texCoords = ParallaxMapping(fs_in.TexCoords,  viewDir);
+    float viewDistance = length(fs_in.TangentViewPos - fs_in.TangentFragPos);
+    vec2 texCoords = ParallaxCoords(fs_in.TexCoords, viewDir, viewDistance);
     if(texCoords.x > 1.0 || texCoords.y > 1.0 || texCoords.x < 0.0 || texCoords.y < 0.0)
         discard;
 
@@ -37,17 +31,10 @@ void main()
 
     // get diffuse color
     vec3 color = texture(diffuseMap, texCoords).rgb;
-    // ambient
-    vec3 ambient = 0.1 * color;
-    // diffuse
+    // fixed light colors: ambient 0.1, diffuse 1.0, specular 0.2
     vec3 lightDir = normalize(fs_in.TangentLightPos - fs_in.TangentFragPos);
-    float diff = max(dot(lightDir, normal), 0.0);
-    vec3 diffuse = diff * color;
-    // specular
-    vec3 reflectDir = reflect(-lightDir, normal);
-    vec3 halfwayDir = normalize(lightDir + viewDir);
-    float spec = pow(max(dot(normal, halfwayDir), 0.0), 32.0);
-
-    vec3 specular = vec3(0.2) * spec;
+    vec3 ambient = 0.1 * color;
+    vec3 diffuse = DiffuseFactor(normal, lightDir) * color;
+    vec3 specular = vec3(0.2) * SpecularFactor(normal, lightDir, viewDir, 32.0);
     FragColor = vec4(ambient + diffuse + specular, 1.0);
 }
\ No newline at end of file
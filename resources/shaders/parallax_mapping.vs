@@ -1,9 +1,9 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec3 aNormal;
+layout (location = 1) in vec4 aTangentFrame;
 layout (location = 2) in vec2 aTexCoords;
-layout (location = 3) in vec3 aTangent;
-layout (location = 4) in vec3 aBitangent;
+
+#include "tangent_frame.glsl"
 
 out VS_OUT {
     vec3 FragPos;
@@ -11,6 +11,7 @@ out VS_OUT {
     vec3 TangentLightPos;
     vec3 TangentViewPos;
     vec3 TangentFragPos;
+    mat3 TBN;
 } vs_out;
 
 uniform mat4 projection;
@@ -25,10 +26,15 @@ void main()
     vs_out.FragPos = vec3(model * vec4(aPos, 1.0));
     vs_out.TexCoords = aTexCoords;
 
-    vec3 T = normalize(mat3(model) * aTangent);
-    vec3 B = normalize(mat3(model) * aBitangent);
-    vec3 N = normalize(mat3(model) * aNormal);
+    vec3 tangent, normal;
+    float handedness;
+    DecodeTangentFrame(aTangentFrame, tangent, normal, handedness);
+    vec3 T = normalize(mat3(model) * tangent);
+    vec3 B = normalize(mat3(model) * (handedness * cross(normal, tangent)));
+    vec3 N = normalize(mat3(model) * normal);
     mat3 TBN = transpose(mat3(T, B, N));
+    // tangent to world space, for shaders that light in world space
+    vs_out.TBN = mat3(T, B, N);
 
     vs_out.TangentLightPos = TBN * lightPos;
     vs_out.TangentViewPos  = TBN * viewPos;
@@ -0,0 +1,46 @@
+#version 330 core
+out vec4 FragColor;
+
+#include "clusters.glsl"
+#include "parallax.glsl"
+
+in VS_OUT {
+    vec3 FragPos;
+    vec2 TexCoords;
+    vec3 TangentLightPos;
+    vec3 TangentViewPos;
+    vec3 TangentFragPos;
+    mat3 TBN;
+} fs_in;
+
+uniform sampler2D diffuseMap;
+uniform sampler2D normalMap;
+
+uniform vec3 viewPos;
+
+void main()
+{
+    // offset texture coordinates with parallax (occlusion) mapping
+    vec3 tangentViewDir = normalize(fs_in.TangentViewPos - fs_in.TangentFragPos);
+    vec2 texCoords = ParallaxCoords(fs_in.TexCoords, tangentViewDir, length(viewPos - fs_in.FragPos));
+    if(texCoords.x > 1.0 || texCoords.y > 1.0 || texCoords.x < 0.0 || texCoords.y < 0.0)
+        discard;
+
+    // normal from the normal map, lit in world space like the clustered model shader
+    vec3 normal = texture(normalMap, texCoords).rgb;
+    normal = normalize(fs_in.TBN * normalize(normal * 2.0 - 1.0));
+    vec3 color = texture(diffuseMap, texCoords).rgb;
+    vec3 viewDir = normalize(viewPos - fs_in.FragPos);
+
+    vec3 result = 0.1 * color;
+    uvec2 cluster = FindCluster(fs_in.FragPos);
+    for (uint i = 0u; i < cluster.y; i++) {
+        float radius;
+        PointLight light = ClusterLight(cluster, i, radius);
+        vec3 toLight = light.position - fs_in.FragPos;
+        // the floor has no specular map, its highlights are a fifth of the light's specular color
+        if (length(toLight) <= radius)
+            result += ShadePointLight(light, toLight, normal, viewDir, color, 0.2, 32.0);
+    }
+    FragColor = vec4(result, 1.0);
+}
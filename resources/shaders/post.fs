@@ -0,0 +1,64 @@
+#version 330 core
+out vec4 FragColor;
+
+// The one full size pass after the scene: stretches the HDR scene target over the framebuffer, adds
+// the bloom, tone maps and encodes for the display. Built once per filter (main.cpp): POST_FXAA and
+// POST_SMAA filter at the output pixel's position in the scene, POST_SHARPEN is the contrast adaptive
+// sharpening for an upscaled scene without them (sharpening after FXAA/SMAA would bring the smoothed
+// steps back), none of them is a plain bilinear fetch. Separate programs rather than branches, a
+// software rasterizer pays for every branch it doesn't take.
+#include "tonemap.glsl"
+#if defined(POST_FXAA)
+#include "fxaa.glsl"
+#elif defined(POST_SMAA)
+#include "smaa.glsl"
+#endif
+
+uniform sampler2D sceneColor;
+uniform sampler2D bloom;
+uniform float bloomIntensity;
+uniform vec2 outputSize;
+// 0: weakest, 1: strongest sharpening
+uniform float sharpness;
+
+#ifdef POST_SHARPEN
+vec3 Sharpen(vec2 uv)
+{
+    vec2 texel = 1.0 / vec2(textureSize(sceneColor, 0));
+    vec3 center = texture(sceneColor, uv).rgb;
+    vec3 up = texture(sceneColor, uv + vec2(0.0, texel.y)).rgb;
+    vec3 down = texture(sceneColor, uv - vec2(0.0, texel.y)).rgb;
+    vec3 left = texture(sceneColor, uv - vec2(texel.x, 0.0)).rgb;
+    vec3 right = texture(sceneColor, uv + vec2(texel.x, 0.0)).rgb;
+
+    // a negative lobe on the four neighbours, weaker where the tone mapped neighbourhood is already
+    // close to black or white so edges don't ring or clip; the lobe itself applies to the HDR values
+    vec3 centerMapped = Tonemap(center);
+    vec3 upMapped = Tonemap(up);
+    vec3 downMapped = Tonemap(down);
+    vec3 leftMapped = Tonemap(left);
+    vec3 rightMapped = Tonemap(right);
+    vec3 minimum = min(centerMapped, min(min(upMapped, downMapped), min(leftMapped, rightMapped)));
+    vec3 maximum = max(centerMapped, max(max(upMapped, downMapped), max(leftMapped, rightMapped)));
+    vec3 amount = sqrt(clamp(min(minimum, 1.0 - maximum) / max(maximum, vec3(1e-4)), 0.0, 1.0));
+    vec3 weight = amount * (-1.0 / mix(8.0, 5.0, sharpness));
+    vec3 color = (center + (up + down + left + right) * weight) / (1.0 + 4.0 * weight);
+    return max(color, 0.0);
+}
+#endif
+
+void main()
+{
+    vec2 uv = gl_FragCoord.xy / outputSize;
+#if defined(POST_FXAA)
+    vec3 color = Fxaa(sceneColor, uv);
+#elif defined(POST_SMAA)
+    vec3 color = SmaaBlend(sceneColor, uv);
+#elif defined(POST_SHARPEN)
+    vec3 color = Sharpen(uv);
+#else
+    vec3 color = texture(sceneColor, uv).rgb;
+#endif
+    color += texture(bloom, uv).rgb * bloomIntensity;
+    FragColor = vec4(DisplayEncode(Tonemap(color)), 1.0);
+}
@@ -0,0 +1,8 @@
+// The scene's sun and its two lamps, filled once per frame by rg::LightsBuffer (rg/Lights.h) and shared
+// by every program that includes this file.
+#include "lights.glsl"
+
+layout (std140) uniform Lights {
+    DirLight dirLight;
+    PointLight pointLights[2];
+};
@@ -0,0 +1,28 @@
+// SMAA neighbourhood blending: moves the lookup towards the neighbours the blend weights of
+// smaa_weights.fs point to, so one or two bilinear fetches mix the pixel with them. Only the stronger
+// direction (left/right or up/down) is used. uv doesn't have to be a texel centre, the weights are
+// those of the texel it falls into, which keeps it usable while upscaling.
+
+uniform sampler2D smaaWeights;
+
+vec3 SmaaBlend(sampler2D color, vec2 uv)
+{
+    ivec2 size = textureSize(smaaWeights, 0);
+    ivec2 pixel = clamp(ivec2(uv * vec2(size)), ivec2(0), size - 1);
+    vec4 weights = texelFetch(smaaWeights, pixel, 0);
+    // up, down, left, right: how much of each neighbour this pixel takes
+    vec4 a = vec4(weights.r,
+                  texelFetch(smaaWeights, max(pixel - ivec2(0, 1), ivec2(0)), 0).g,
+                  weights.b,
+                  texelFetch(smaaWeights, min(pixel + ivec2(1, 0), size - 1), 0).a);
+    if (dot(a, vec4(1.0)) < 1e-5)
+        return texture(color, uv).rgb;
+
+    vec2 texel = 1.0 / vec2(size);
+    bool horizontal = max(a.z, a.w) > max(a.x, a.y);
+    vec2 weight = horizontal ? a.zw : a.xy;
+    vec2 offsetFirst = horizontal ? vec2(-a.z * texel.x, 0.0) : vec2(0.0, a.x * texel.y);
+    vec2 offsetSecond = horizontal ? vec2(a.w * texel.x, 0.0) : vec2(0.0, -a.y * texel.y);
+    weight /= weight.x + weight.y;
+    return weight.x * texture(color, uv + offsetFirst).rgb + weight.y * texture(color, uv + offsetSecond).rgb;
+}
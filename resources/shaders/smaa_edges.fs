@@ -0,0 +1,44 @@
+#version 330 core
+out vec2 Edges;
+
+// SMAA luma edge detection: r is set where the pixel differs from its left neighbour, g from the one
+// above. An edge is dropped when a neighbouring edge is much stronger (local contrast adaptation),
+// so the weaker steps of a high contrast edge don't get their own lines. Pixels without an edge are
+// discarded, the target is cleared and only pixels written here get the weight pass (stencil).
+// The luma is that of the tone mapped scene, edges are found where they will be seen.
+#include "tonemap.glsl"
+
+uniform sampler2D sceneColor;
+
+const float edgeThreshold = 0.1;
+const float localContrastFactor = 2.0;
+
+float Luma(ivec2 pixel)
+{
+    ivec2 size = textureSize(sceneColor, 0);
+    return PerceptualLuma(texelFetch(sceneColor, clamp(pixel, ivec2(0), size - 1), 0).rgb);
+}
+
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    float luma = Luma(pixel);
+    float left = Luma(pixel + ivec2(-1, 0));
+    float top = Luma(pixel + ivec2(0, 1));
+    vec2 delta = abs(luma - vec2(left, top));
+    vec2 edges = step(edgeThreshold, delta);
+    if (edges.x + edges.y == 0.0)
+        discard;
+
+    float right = Luma(pixel + ivec2(1, 0));
+    float bottom = Luma(pixel + ivec2(0, -1));
+    float leftLeft = Luma(pixel + ivec2(-2, 0));
+    float topTop = Luma(pixel + ivec2(0, 2));
+    float maxDelta = max(max(delta.x, delta.y),
+                         max(max(abs(luma - right), abs(luma - bottom)),
+                             max(abs(left - leftLeft), abs(top - topTop))));
+    edges *= step(maxDelta, localContrastFactor * delta);
+    if (edges.x + edges.y == 0.0)
+        discard;
+    Edges = edges;
+}
@@ -0,0 +1,115 @@
+#version 330 core
+out vec4 Weights;
+
+// SMAA blend weights without the precomputed area texture: for every edge the pixel has (left, top),
+// search along the edge for its two ends, look at which side the crossing edges leave it there and
+// reconstruct the silhouette as in MLAA, a line through the middle of the steps at the ends. The part
+// of each pixel the line cuts off belongs to the other side of the edge, that area is its weight.
+//   r: this pixel takes from the one above      g: the one above takes from this pixel
+//   b: this pixel takes from the one to the left a: the one to the left takes from this pixel
+// Diagonal and corner patterns of full SMAA are not detected, ends are searched up to maxSearchSteps.
+
+uniform sampler2D edges;
+
+const int maxSearchSteps = 16;
+
+ivec2 size;
+
+vec2 EdgesAt(ivec2 pixel)
+{
+    if (any(lessThan(pixel, ivec2(0))) || any(greaterThanEqual(pixel, size)))
+        return vec2(0.0);
+    return texelFetch(edges, pixel, 0).rg;
+}
+
+// pixels the edge continues in direction step, with component (0: left edges, 1: top edges)
+int SearchLength(ivec2 pixel, ivec2 dir, int component)
+{
+    int length = 0;
+    for (int i = 1; i <= maxSearchSteps; i++) {
+        if (EdgesAt(pixel + dir * i)[component] < 0.5)
+            break;
+        length = i;
+    }
+    return length;
+}
+
+// height of the line at a step's end: +0.5 when the crossing edge is on the positive side, -0.5 on the
+// negative, none or both: 0
+float EndHeight(float negative, float positive)
+{
+    return 0.5 * (step(0.5, positive) - step(0.5, negative));
+}
+
+// signed area between the edge and the line h(x) = h0 + (h1 - h0) * (x - x0) / (x1 - x0) on [x0, x1],
+// as (positive part, negative part)
+vec2 LineArea(float x0, float x1, float h0, float h1)
+{
+    if (h0 * h1 >= 0.0) {
+        float area = 0.5 * (h0 + h1) * (x1 - x0);
+        return area >= 0.0 ? vec2(area, 0.0) : vec2(0.0, -area);
+    }
+    float root = (x1 - x0) * h0 / (h0 - h1);
+    vec2 first = vec2(0.5 * h0 * root, 0.0);
+    vec2 second = vec2(0.0, -0.5 * h1 * (x1 - x0 - root));
+    return h0 > 0.0 ? first + second : vec2(-second.y, -first.x);
+}
+
+// areas cut off the pixel [d0, d0 + 1] by the line over an edge d0 + d1 + 1 pixels long with end heights
+// h0 and h1; one step at an end (L shape) runs the line to the other end, steps to the same side
+// (U shape) meet in the middle
+vec2 EdgeArea(float d0, float d1, float h0, float h1)
+{
+    float length = d0 + d1 + 1.0;
+    if (h0 == 0.0 && h1 == 0.0)
+        return vec2(0.0);
+    if (h0 * h1 <= 0.0)
+        return LineArea(d0, d0 + 1.0, mix(h0, h1, d0 / length), mix(h0, h1, (d0 + 1.0) / length));
+
+    float middle = 0.5 * length;
+    vec2 area = vec2(0.0);
+    float x0 = d0;
+    float x1 = min(d0 + 1.0, middle);
+    if (x1 > x0)
+        area += LineArea(x0, x1, h0 * (1.0 - x0 / middle), h0 * (1.0 - x1 / middle));
+    x0 = max(d0, middle);
+    x1 = d0 + 1.0;
+    if (x1 > x0)
+        area += LineArea(x0, x1, h1 * (x0 - middle) / middle, h1 * (x1 - middle) / middle);
+    return area;
+}
+
+void main()
+{
+    size = textureSize(edges, 0);
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    vec2 e = EdgesAt(pixel);
+    Weights = vec4(0.0);
+    if (e.x + e.y == 0.0)
+        return;
+
+    // top edge: runs along x, positive side is the row above
+    if (e.y > 0.5) {
+        int left = SearchLength(pixel, ivec2(-1, 0), 1);
+        int right = SearchLength(pixel, ivec2(1, 0), 1);
+        ivec2 start = pixel - ivec2(left, 0);
+        ivec2 end = pixel + ivec2(right + 1, 0);
+        float h0 = EndHeight(EdgesAt(start).x, EdgesAt(start + ivec2(0, 1)).x);
+        float h1 = EndHeight(EdgesAt(end).x, EdgesAt(end + ivec2(0, 1)).x);
+        vec2 area = EdgeArea(float(left), float(right), h0, h1);
+        // the line above the edge cuts into the pixel above
+        Weights.rg = vec2(area.y, area.x);
+    }
+
+    // left edge: runs along y, positive side is the column to the left
+    if (e.x > 0.5) {
+        int down = SearchLength(pixel, ivec2(0, -1), 0);
+        int up = SearchLength(pixel, ivec2(0, 1), 0);
+        ivec2 start = pixel - ivec2(0, down + 1);
+        ivec2 end = pixel + ivec2(0, up);
+        float h0 = EndHeight(EdgesAt(start).y, EdgesAt(start + ivec2(-1, 0)).y);
+        float h1 = EndHeight(EdgesAt(end).y, EdgesAt(end + ivec2(-1, 0)).y);
+        vec2 area = EdgeArea(float(down), float(up), h0, h1);
+        Weights.ba = vec2(area.y, area.x);
+    }
+}
@@ -0,0 +1,10 @@
+// Decodes the per-vertex tangent frame packed by rg::packTangentFrame: a unit quaternion whose w
+// sign is the bitangent's handedness. Read as 4 normalized shorts, so it is renormalized first.
+void DecodeTangentFrame(vec4 q, out vec3 tangent, out vec3 normal, out float handedness)
+{
+    handedness = q.w < 0.0 ? -1.0 : 1.0;
+    q = normalize(q);
+    // the rotated +x and +z axes; the products are the same for q and -q
+    tangent = vec3(1.0 - 2.0 * (q.y * q.y + q.z * q.z), 2.0 * (q.x * q.y + q.w * q.z), 2.0 * (q.x * q.z - q.w * q.y));
+    normal = vec3(2.0 * (q.x * q.z + q.w * q.y), 2.0 * (q.y * q.z - q.w * q.x), 1.0 - 2.0 * (q.x * q.x + q.y * q.y));
+}
@@ -0,0 +1,25 @@
+// Tone mapping of the HDR scene for the post pass, and the luma the contrast based filters (FXAA,
+// SMAA edges, sharpening) judge it by, so their thresholds apply to what ends up on screen.
+
+uniform float exposure;
+
+// Narkowicz's fit of the ACES filmic curve: a toe, then a soft shoulder towards 1.0 instead of clipping
+vec3 Tonemap(vec3 hdr)
+{
+    vec3 x = hdr * exposure;
+    return clamp((x * (2.51 * x + 0.03)) / (x * (2.43 * x + 0.59) + 0.14), 0.0, 1.0);
+}
+
+// the window's framebuffer isn't sRGB, the post pass encodes for the display itself
+vec3 DisplayEncode(vec3 color)
+{
+    return pow(color, vec3(1.0 / 2.2));
+}
+
+// close to the luma of the tone mapped, display encoded color at a fraction of the cost: Reinhard on
+// the luma, then a square root for the display's curve
+float PerceptualLuma(vec3 hdr)
+{
+    float luma = dot(hdr * exposure, vec3(0.2126, 0.7152, 0.0722));
+    return sqrt(luma / (1.0 + luma));
+}
@@ -13,19 +13,117 @@
 #include <learnopengl/shader.h>
 #include <learnopengl/camera.h>
 #include <learnopengl/model.h>
-
+#include <rg/RenderQueue.h>
+#include <rg/CommandList.h>
+#include <rg/GLState.h>
+#include <rg/ShaderReloader.h>
+#include <rg/ShaderVariants.h>
+#include <rg/ProgramState.h>
+#include <rg/FramePacer.h>
+#include <rg/FramePipeline.h>
+#include <rg/Rain.h>
+#include <rg/GLStats.h>
+#include <rg/GpuMemory.h>
+#include <rg/DeferredRenderer.h>
+#include <rg/ClusteredLighting.h>
+#include <rg/ThreadPool.h>
+#include <rg/HeadlessContext.h>
+#include <rg/OffscreenTarget.h>
+#include <rg/SceneTarget.h>
+#include <rg/SmaaTargets.h>
+#include <rg/BloomChain.h>
+#include <rg/DynamicResolution.h>
+#include <rg/Benchmark.h>
+#include <rg/Profiler.h>
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <thread>
 
 void framebuffer_size_callback(GLFWwindow *window, int width, int height);
 void mouse_callback(GLFWwindow *window, double xpos, double ypos);
 void scroll_callback(GLFWwindow *window, double xoffset, double yoffset);
-void processInput(GLFWwindow *window);
+unsigned int processInput(GLFWwindow *window);
 void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods);
 
 unsigned int loadCubemap(vector<std::string> faces);
 unsigned int loadTexture(const char *path, bool gammaCorrection);
 void renderQuad();
+void setLightingUniforms(Shader &shader, const glm::mat4 &projection, const glm::mat4 &view);
+
+// command line: [--headless] [--frames N] [--width W] [--height H] [--benchmark script] [--output file] [--seed N]
+//               [--startup-trace file] [--vsync on|adaptive|off] [--fps-limit N] [--command-lists]
+//               [--shader-cache dir] [--no-shader-cache] [--render-scale S] [--dynamic-resolution ms]
+//               [--aa none|msaa|fxaa|smaa] [--exposure E] [--no-bloom]
+struct LaunchOptions {
+    bool headless = false;
+    int frames = 0; // 0: 600 for a plain headless run, the script's length for a benchmark
+    int width = 800;
+    int height = 600;
+    std::string benchmarkScript;
+    std::string benchmarkOutput = "benchmark.json";
+    unsigned int seed = 1;
+    std::string startupTrace; // empty: no startup trace file
+    rg::SwapMode swapMode = rg::SwapMode::VSync;
+    int fpsLimit = 0; // 0: no limit
+    bool commandLists = false;
+    std::string shaderCache = "shader_cache"; // empty: every program is compiled from source
+    float renderScale = 1.0f;
+    float targetFrameTime = 0.0f; // ms, 0: fixed render scale
+    AntiAliasingMode antiAliasing = AntiAliasingMode::MSAA;
+    float exposure = 1.0f;
+    bool bloom = true;
+};
+
+bool parseLaunchOptions(int argc, char **argv, LaunchOptions &options);
+void applyScriptedCamera(Camera &camera, int frame, int frameCount);
+void triggerSceneEvent(const std::string &name);
+void cycleWeather();
+void applySwapMode(rg::SwapMode mode);
+
+// the render thread posts one request per frame: input gathered since the last one, and the time
+// the frame is for
+struct SimulationRequest {
+    std::uint64_t frame = 0;
+    double time = 0.0;
+    unsigned int movementKeys = 0; // bit (1 << Camera_Movement) per held key
+    glm::vec2 mouseOffset = glm::vec2(0.0f);
+    float scrollOffset = 0.0f;
+    float movementSpeed = SPEED;
+    std::vector<std::string> events; // scene toggles, see triggerSceneEvent
+};
+
+// everything the render thread needs from the simulation for one frame, immutable once published
+struct FramePacket {
+    std::uint64_t frame = 0;
+    Camera camera;
+    glm::mat4 airplanePose = glm::mat4(1.0f); // without the scale
+    bool planeCrash = false;
+    bool rainy = false;
+    bool sunny = true;
+    bool storm = false;
+    bool lampOn = true;
+    bool houseLampOn = false;
+    bool lightning = false;
+    glm::mat4 lightningModel = glm::mat4(1.0f);
+    std::vector<glm::mat4> rainModels; // empty while it doesn't rain
+};
+
+using SimulationPipeline = rg::FramePipeline<SimulationRequest, FramePacket>;
 
+void simulate(float dt, rg::Rain &rain);
+glm::mat4 randomLightningBolt();
+glm::mat4 airplanePose(double time, float alpha);
+void moveCamera(Camera &camera, unsigned int movementKeys, float dt);
+void printFrameStats(const std::vector<double> &frameTimes);
+bool writeBenchmarkReport(const LaunchOptions &options, const std::vector<double> &cpuTimes,
+                          const std::vector<double> &gpuTimes, const std::vector<double> &frameTimes);
+
+// scene state below is owned by the simulation thread, the render thread sees it through FramePackets
 // weather settings
 bool rainy = false;
 bool sunny = true;
@@ -37,166 +135,189 @@ bool houseLampOn = false;
 // airplane settings
 bool planeCrash = false;
 glm::vec3 currentAirplanePosition;
+glm::vec3 previousAirplanePosition; // one simulation step earlier, for interpolation
 glm::mat4 currentAirplaneRotation = glm::mat4(1.0f);
 float airplaneHeight = -95.0;
+const glm::vec3 airplaneFallVelocity = glm::vec3(24.0f, -36.0f, 3.6f); // units per second
+
+// rain settings
+const float rainSpeed = 6.0f; // Brzina pada kiše, units per second
 
-//lightning settings
+//lightning settings, counted in simulation steps
 int randomLightningSpawn = 30;
 int lightningFrameDuration = 0;
+glm::mat4 lightningModel = glm::mat4(1.0f);
+
+// camera speed for the movement keys, scaled by Camera::MovementSpeed
+const float cameraKeySpeed = 12.0f;
 
 // settings
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
 float heightScale = 0.1;
 
+// current framebuffer size, can differ from the window size on high DPI displays
+int framebufferWidth = SCR_WIDTH;
+int framebufferHeight = SCR_HEIGHT;
+
+// the scene can be rendered at a fraction of the framebuffer size and upscaled, see rg/DynamicResolution.h
+const float minRenderScale = 0.25f;
+
+// GPU frame time per anti-aliasing mode for the Renderer window. The times come back a few frames late
+// (GpuFrameTimer::Latency), so every timed frame's mode waits in pending until its time is read.
+struct AntiAliasingTimes {
+    std::deque<AntiAliasingMode> pending;
+    double average[4] = {}; // ms, exponential moving average
+    unsigned int samples[4] = {};
+
+    void collected(double ms) {
+        if (pending.empty())
+            return;
+        int mode = (int) pending.front();
+        pending.pop_front();
+        average[mode] = samples[mode] == 0 ? ms : average[mode] + 0.05 * (ms - average[mode]);
+        samples[mode]++;
+    }
+};
+AntiAliasingTimes antiAliasingTimes;
+// scene target size of the last frame, for the memory estimates in the Renderer window
+int renderWidth = SCR_WIDTH;
+int renderHeight = SCR_HEIGHT;
+// set by the Renderer window when the render scale or dynamic resolution was changed by hand, the
+// controller's frame times from before are for another scale
+bool dynamicResolutionStale = false;
+
 // camera
 float lastX = SCR_WIDTH / 2.0f;
 float lastY = SCR_HEIGHT / 2.0f;
 bool firstMouse = true;
 
-// timing
+// timing, simulation thread
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
-struct PointLight {
-    glm::vec3 position;
-    glm::vec3 ambient;
-    glm::vec3 diffuse;
-    glm::vec3 specular;
-
-    float constant;
-    float linear;
-    float quadratic;
-};
-
-struct DirLight {
-    glm::vec3 direction;
-    glm::vec3 ambient;
-    glm::vec3 diffuse;
-    glm::vec3 specular;
-};
-
-struct ProgramState {
-    glm::vec3 clearColor = glm::vec3(0);
-    bool ImGuiEnabled = false;
-    Camera camera;
-    bool CameraMouseMovementUpdateEnabled = true;
-
-    glm::vec3 islandPosition = glm::vec3(0.0f, -100.0f, 0.0f);
-    float islandScale = 0.7f;
-
-    glm::vec3 airplanePosition = glm::vec3(200.0f, 250.0f, 30.0f);
-    float airplaneScale = 3.5f;
-
-    glm::vec3 boatPosition = glm::vec3(80.0f, -97.0f, 120.0f);
-    float boatScale = 1.0f;
-
-    glm::vec3 lampPosition = glm::vec3(-10.0f, -80.0f, -10.0f);
-    float lampScale = 10.0f;
-
-    glm::vec3 tablePosition = glm::vec3(-5.0f, -77.0f, 11.0f);
-    float tableScale = 4.0f;
-
-    glm::vec3 chairPosition = glm::vec3(-5.0f, -77.0f, 8.0f);
-    float chairScale = 4.0f;
-
-    glm::vec3 houseLampPosition = glm::vec3(-13.0f, -71.0f, 9.0f);
-    float houseLampScale = 4.0f;
-
-    glm::vec3 applePosition = glm::vec3(-5.0f, -74.0f, 11.0f);
-    float appleScale = 0.05f;
-
-
-    PointLight pointLight;
-    PointLight pointLightHouse;
-    DirLight dirLight;
-
-    ProgramState()
-            : camera(glm::vec3(0.0f, 0.0f, 0.0f)) {}
-
-    void SaveToFile(std::string filename);
-
-    void LoadFromFile(std::string filename);
-};
-
-void ProgramState::SaveToFile(std::string filename) {
-    std::ofstream out(filename);
-    out << clearColor.r << '\n'
-        << clearColor.g << '\n'
-        << clearColor.b << '\n'
-        << ImGuiEnabled << '\n'
-        << camera.Position.x << '\n'
-        << camera.Position.y << '\n'
-        << camera.Position.z << '\n'
-        << camera.Front.x << '\n'
-        << camera.Front.y << '\n'
-        << camera.Front.z << '\n';
-}
-
-void ProgramState::LoadFromFile(std::string filename) {
-    std::ifstream in(filename);
-    if (in) {
-        in >> clearColor.r
-           >> clearColor.g
-           >> clearColor.b
-           >> ImGuiEnabled
-           >> camera.Position.x
-           >> camera.Position.y
-           >> camera.Position.z
-           >> camera.Front.x
-           >> camera.Front.y
-           >> camera.Front.z;
-    }
-}
+// input for the next simulation request, render thread only
+SimulationRequest pendingInput;
 
 ProgramState *programState;
 
+void renderDeferredLighting(rg::DeferredRenderer &deferredRenderer, Shader &directionalShader, Shader &pointShader,
+                            const std::vector<PointLight> &lights, const glm::mat4 &projection, const glm::mat4 &view);
+void renderBloom(rg::DeferredRenderer &deferredRenderer, rg::BloomChain &bloomChain, rg::SceneTarget &sceneTarget,
+                 Shader &prefilterShader, Shader &downsampleShader, Shader &upsampleShader, float threshold);
+void updateCoastLights(ProgramState *programState);
+float lightRadius(const PointLight &light);
+
 void DrawImGui(ProgramState *programState);
+void DrawAntiAliasingControls(ProgramState *programState);
+void DrawProfilerWindow();
+void DrawGpuMemoryWindow();
+void trackWindowFramebuffer(int width, int height);
+
+int main(int argc, char **argv) {
+    rg::startupTrace(); // starts the startup clock
+    LaunchOptions options;
+    if (!parseLaunchOptions(argc, argv, options)) {
+        std::cout << "Usage: " << argv[0] << " [--headless] [--frames N] [--width W] [--height H]"
+                  << " [--benchmark script] [--output file] [--seed N] [--startup-trace file]"
+                  << " [--vsync on|adaptive|off] [--fps-limit N] [--command-lists]"
+                  << " [--shader-cache dir] [--no-shader-cache] [--render-scale S] [--dynamic-resolution ms]"
+                  << " [--aa none|msaa|fxaa|smaa] [--exposure E] [--no-bloom]" << std::endl;
+        return -1;
+    }
 
-int main() {
-    // glfw: initialize and configure
-    // ------------------------------
-    glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    // benchmark: camera and scene toggles replayed from a script with a fixed time step and seeded
+    // randomness, so every run renders exactly the same frames
+    // -------------------------------------------------------------------------------------------------
+    const bool benchmark = !options.benchmarkScript.empty();
+    const bool scripted = benchmark || options.headless;
+    const float fixedTimeStep = 1.0f / 60.0f;
+    rg::CameraScript cameraScript;
+    if (benchmark) {
+        if (!cameraScript.load(options.benchmarkScript))
+            return -1;
+        if (options.frames == 0)
+            options.frames = (int) (cameraScript.duration() / fixedTimeStep) + 1;
+    }
+    if (options.frames == 0)
+        options.frames = 600;
+    if (scripted)
+        srand(options.seed);
+
+    // headless: no window, the scene is rendered into an offscreen framebuffer for a fixed number of frames
+    // ------------------------------------------------------------------------------------------------------
+    GLFWwindow *window = NULL;
+    rg::HeadlessContext headlessContext;
+    GLADloadproc loadProc = (GLADloadproc) glfwGetProcAddress;
+    std::int64_t initStart = rg::startupTrace().now();
+    if (options.headless) {
+        if (!headlessContext.create()) {
+            std::cout << "Failed to create headless OpenGL context" << std::endl;
+            return -1;
+        }
+        loadProc = (GLADloadproc) rg::HeadlessContext::getProcAddress;
+        framebufferWidth = options.width;
+        framebufferHeight = options.height;
+    } else {
+        // glfw: initialize and configure
+        // ------------------------------
+        glfwInit();
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
 #ifdef __APPLE__
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
 
-    glfwWindowHint(GLFW_SAMPLES, 4);
+        // the scene is drawn into its own targets (see rg/SceneTarget.h), the window only gets the post
+        // pass and ImGui: no samples, depth or stencil
+        glfwWindowHint(GLFW_SAMPLES, 0);
+        glfwWindowHint(GLFW_DEPTH_BITS, 0);
+        glfwWindowHint(GLFW_STENCIL_BITS, 0);
 
-    // glfw window creation
-    // --------------------
-    GLFWwindow *window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
-    if (window == NULL) {
-        std::cout << "Failed to create GLFW window" << std::endl;
-        glfwTerminate();
-        return -1;
+        // glfw window creation
+        // --------------------
+        window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+        if (window == NULL) {
+            std::cout << "Failed to create GLFW window" << std::endl;
+            glfwTerminate();
+            return -1;
+        }
+        glfwMakeContextCurrent(window);
+        glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+        glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+        glfwSetCursorPosCallback(window, mouse_callback);
+        glfwSetScrollCallback(window, scroll_callback);
+        glfwSetKeyCallback(window, key_callback);
+        // tell GLFW to capture our mouse
+        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
     }
-    glfwMakeContextCurrent(window);
-    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-    glfwSetCursorPosCallback(window, mouse_callback);
-    glfwSetScrollCallback(window, scroll_callback);
-    glfwSetKeyCallback(window, key_callback);
-    // tell GLFW to capture our mouse
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    rg::startupTrace().record({options.headless ? "EGL context" : "GLFW init and window", "init",
+                               initStart, rg::startupTrace().now(), {}});
 
     // glad: load all OpenGL function pointers
     // ---------------------------------------
-    if (!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress)) {
+    initStart = rg::startupTrace().now();
+    if (!gladLoadGLLoader(loadProc)) {
         std::cout << "Failed to initialize GLAD" << std::endl;
         return -1;
     }
+    rg::startupTrace().record({"GLAD load", "init", initStart, rg::startupTrace().now(), {}});
+    rg::glStats().install();
+    rg::programBinaryCache().init(loadProc, options.shaderCache);
+    if (window)
+        trackWindowFramebuffer(framebufferWidth, framebufferHeight);
 
-    glEnable(GL_MULTISAMPLE);
+    rg::glState().enable(GL_MULTISAMPLE);
 
     // tell stb_image.h to flip loaded texture's on the y-axis (before loading model).
     stbi_set_flip_vertically_on_load(false);
 
     programState = new ProgramState;
-    programState->LoadFromFile("resources/program_state.txt");
+    // headless and benchmark runs always start from the defaults so they are comparable
+    if (!scripted)
+        programState->LoadFromFile("resources/program_state.txt");
     if (programState->ImGuiEnabled) {
         glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
     }
@@ -207,26 +328,95 @@ int main() {
     (void) io;
 
 
+    if (window) {
+        ImGui_ImplGlfw_InitForOpenGL(window, true);
+        ImGui_ImplOpenGL3_Init("#version 330 core");
+    }
 
-    ImGui_ImplGlfw_InitForOpenGL(window, true);
-    ImGui_ImplOpenGL3_Init("#version 330 core");
+    // stands in for the default framebuffer when running headless, single sampled like the window's one
+    rg::OffscreenTarget *offscreenTarget = NULL;
+    unsigned int outputFramebuffer = 0;
+    if (options.headless) {
+        offscreenTarget = new rg::OffscreenTarget(framebufferWidth, framebufferHeight, 0);
+        outputFramebuffer = offscreenTarget->framebuffer();
+    }
+    programState->swapMode = options.swapMode;
+    programState->fpsLimit = options.fpsLimit;
+    programState->recordCommandLists = options.commandLists;
+    programState->renderScale = options.renderScale;
+    programState->antiAliasing = options.antiAliasing;
+    programState->exposure = options.exposure;
+    programState->bloom = options.bloom;
+    if (options.targetFrameTime > 0.0f) {
+        programState->dynamicResolution = true;
+        programState->targetFrameTime = options.targetFrameTime;
+    }
+    if (benchmark) {
+        // measure the renderer, not the display's refresh rate
+        programState->swapMode = rg::SwapMode::Uncapped;
+        programState->fpsLimit = 0;
+    }
+    rg::SwapMode appliedSwapMode = programState->swapMode;
+    if (window)
+        applySwapMode(appliedSwapMode);
+    // every frame is timed, scripted runs keep the times for the report
+    rg::GpuFrameTimer gpuFrameTimer(scripted);
+    rg::DynamicResolution dynamicResolution(0.5f, 1.0f);
+    rg::SceneTarget sceneTarget;
+    rg::SmaaTargets smaaTargets;
+    rg::BloomChain bloomChain;
+    std::vector<double> cpuTimes;
+    std::vector<double> frameTimes;
+    int frameIndex = 0;
+
+    rg::FrameLimiter frameLimiter;
 
     // configure global opengl state
     // -----------------------------
-    glEnable(GL_DEPTH_TEST);
+    rg::glState().enable(GL_DEPTH_TEST);
+    rg::glState().depthFunc(GL_LESS);
 
     // Face culling
-    glEnable(GL_CULL_FACE);
+    rg::glState().enable(GL_CULL_FACE);
     glCullFace(GL_BACK);
     glFrontFace(GL_CCW);
 
     // build and compile shaders
     // -------------------------
-    Shader ourShader("resources/shaders/model.vs", "resources/shaders/model.fs");
+    // forward model programs, one variant per combination of maps the materials have; a variant is
+    // compiled when the first mesh needing it is drawn
+    const std::string modelDefines = "#define NUM_POINT_LIGHTS 2\n";
+    rg::ShaderVariants modelShaders("resources/shaders/model.vs", "resources/shaders/model.fs", modelDefines);
+    rg::ShaderVariants instancedShaders("resources/shaders/model_instanced.vs", "resources/shaders/model.fs",
+                                        modelDefines);
     Shader skyboxShader("resources/shaders/skybox.vs", "resources/shaders/skybox.fs");
     Shader blendingShader("resources/shaders/blending.vs", "resources/shaders/blending.fs");
+    Shader rainShader("resources/shaders/blending_instanced.vs", "resources/shaders/blending.fs");
     Shader parallaxShader("resources/shaders/parallax_mapping.vs", "resources/shaders/parallax_mapping.fs");
 
+    // deferred path
+    Shader gbufferShader("resources/shaders/gbuffer.vs", "resources/shaders/gbuffer.fs");
+    Shader gbufferInstancedShader("resources/shaders/gbuffer_instanced.vs", "resources/shaders/gbuffer.fs");
+    Shader deferredDirectionalShader("resources/shaders/deferred_light.vs", "resources/shaders/deferred_directional.fs");
+    Shader deferredPointShader("resources/shaders/deferred_light.vs", "resources/shaders/deferred_point.fs");
+    Shader deferredPresentShader("resources/shaders/deferred_light.vs", "resources/shaders/deferred_present.fs");
+
+    // post: anti-aliasing and upscaling to the framebuffer, one program per filter
+    Shader postShader("resources/shaders/deferred_light.vs", "resources/shaders/post.fs");
+    Shader postSharpenShader("resources/shaders/deferred_light.vs", "resources/shaders/post.fs", nullptr, "#define POST_SHARPEN\n");
+    Shader postFxaaShader("resources/shaders/deferred_light.vs", "resources/shaders/post.fs", nullptr, "#define POST_FXAA\n");
+    Shader postSmaaShader("resources/shaders/deferred_light.vs", "resources/shaders/post.fs", nullptr, "#define POST_SMAA\n");
+    Shader smaaEdgesShader("resources/shaders/deferred_light.vs", "resources/shaders/smaa_edges.fs");
+    Shader smaaWeightsShader("resources/shaders/deferred_light.vs", "resources/shaders/smaa_weights.fs");
+    Shader bloomPrefilterShader("resources/shaders/deferred_light.vs", "resources/shaders/bloom_downsample.fs", nullptr, "#define BLOOM_PREFILTER\n");
+    Shader bloomDownsampleShader("resources/shaders/deferred_light.vs", "resources/shaders/bloom_downsample.fs");
+    Shader bloomUpsampleShader("resources/shaders/deferred_light.vs", "resources/shaders/bloom_upsample.fs");
+
+    // clustered forward path
+    Shader clusteredShader("resources/shaders/gbuffer.vs", "resources/shaders/model_clustered.fs");
+    Shader clusteredInstancedShader("resources/shaders/gbuffer_instanced.vs", "resources/shaders/model_clustered.fs");
+    Shader parallaxClusteredShader("resources/shaders/parallax_mapping.vs", "resources/shaders/parallax_mapping_clustered.fs");
+
     // load models
     // -----------
 
@@ -268,23 +458,25 @@ int main() {
 
     // Point light
     // -----------
+    // the scene is lit in HDR, the lamps are bright next to their bulbs and fall off physically
+    // (constant 1) rather than being dimmed by the attenuation's constant term to stay under 1.0
     PointLight& pointLight = programState->pointLight;
     pointLight.position = glm::vec3(-10.8f, -59.0f, -9.56f);
-    pointLight.ambient = glm::vec3(10.0, 10.0, 10.0);
-    pointLight.diffuse = glm::vec3(0.6, 0.6, 0.6);
-    pointLight.specular = glm::vec3(1.0, 1.0, 1.0);
+    pointLight.ambient = glm::vec3(4.5, 4.5, 4.5);
+    pointLight.diffuse = glm::vec3(0.34, 0.34, 0.34);
+    pointLight.specular = glm::vec3(0.57, 0.57, 0.57);
 
-    pointLight.constant = 14.0f;
+    pointLight.constant = 1.0f;
     pointLight.linear = 0.09f;
     pointLight.quadratic = 0.032f;
 
     PointLight& pointLightHouse = programState->pointLightHouse;
     pointLightHouse.position = glm::vec3(-11.8f, -71.0f, 8.0f);
-    pointLightHouse.ambient = glm::vec3(10.0, 10.0, 10.0);
-    pointLightHouse.diffuse = glm::vec3(10.3, 10.3, 10.3);
-    pointLightHouse.specular = glm::vec3(5.1, 5.1, 5.1);
+    pointLightHouse.ambient = glm::vec3(0.52, 0.52, 0.0);
+    pointLightHouse.diffuse = glm::vec3(2.2, 2.2, 2.2);
+    pointLightHouse.specular = glm::vec3(1.1, 1.1, 1.1);
 
-    pointLightHouse.constant = 19.0f;
+    pointLightHouse.constant = 1.0f;
     pointLightHouse.linear = 0.09f;
     pointLightHouse.quadratic = 0.032f;
 
@@ -347,17 +539,8 @@ int main() {
     };
 
     // rain positions
-    vector<glm::vec3> rainPositions;
-    vector<float> rainRotation;
-
-    for (int i = 0; i < 30000; i++) {
-        float x = static_cast<float>(rand() % 201 - 100); // x koordinate u rasponu [-100, 100]
-        float y = static_cast<float>(rand() % 401 - 200); // y koordinate u rasponu [-200, 200]
-        float z = static_cast<float>(rand() % 201 - 100); // z koordinate u rasponu [-100, 100]
-
-        rainPositions.push_back(glm::vec3(x, y, z));
-        rainRotation.push_back(static_cast<float>(i % 180)); // Rotacija u rasponu [0, 179]
-    }
+    rg::Rain rain;
+    rain.spawn(30000);
 
     // skybox VAO VBO
     unsigned int skyboxVAO, skyboxVBO;
@@ -366,6 +549,7 @@ int main() {
     glBindVertexArray(skyboxVAO);
     glBindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW);
+    rg::gpuMemory().track(rg::GpuMemory::Kind::Buffer, skyboxVBO, "scene geometry", sizeof(skyboxVertices), "skybox");
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
 
@@ -376,12 +560,35 @@ int main() {
     glBindVertexArray(transparentVAO);
     glBindBuffer(GL_ARRAY_BUFFER, transparentVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(transparentVertices), transparentVertices, GL_STATIC_DRAW);
+    rg::gpuMemory().track(rg::GpuMemory::Kind::Buffer, transparentVBO, "scene geometry", sizeof(transparentVertices),
+                          "transparent quad");
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
     glEnableVertexAttribArray(1);
     glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
     glBindVertexArray(0);
 
+    // rain VAO, shares the quad with the transparent VAO and adds a per-instance model matrix
+    unsigned int rainVAO, rainInstanceVBO;
+    glGenVertexArrays(1, &rainVAO);
+    glGenBuffers(1, &rainInstanceVBO);
+    glBindVertexArray(rainVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, transparentVBO);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
+    glBindBuffer(GL_ARRAY_BUFFER, rainInstanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, rain.models.size() * sizeof(glm::mat4), NULL, GL_STREAM_DRAW);
+    rg::gpuMemory().track(rg::GpuMemory::Kind::Buffer, rainInstanceVBO, "instances", rain.models.size() * sizeof(glm::mat4),
+                          "rain");
+    for (unsigned int column = 0; column < 4; column++) {
+        glEnableVertexAttribArray(2 + column);
+        glVertexAttribPointer(2 + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(column * sizeof(glm::vec4)));
+        glVertexAttribDivisor(2 + column, 1);
+    }
+    glBindVertexArray(0);
+
     // load textures
     // -------------
 
@@ -393,8 +600,8 @@ int main() {
 
     // floor texture
     unsigned int diffuseMap = loadTexture(FileSystem::getPath("resources/textures/floor/wood_0041_color_2k.jpg").c_str(), true);
-    unsigned int normalMap  = loadTexture(FileSystem::getPath("resources/textures/floor/wood_0041_normal_opengl_2k.png").c_str(), true);
-    unsigned int heightMap  = loadTexture(FileSystem::getPath("resources/textures/floor/wood_0041_height_2k.png").c_str(), true);
+    unsigned int normalMap  = loadTexture(FileSystem::getPath("resources/textures/floor/wood_0041_normal_opengl_2k.png").c_str(), false);
+    unsigned int heightMap  = loadTexture(FileSystem::getPath("resources/textures/floor/wood_0041_height_2k.png").c_str(), false);
     
     // skybox textures
     stbi_set_flip_vertically_on_load(false);
@@ -431,96 +638,323 @@ int main() {
     unsigned int cubemapTextureSunny = loadCubemap(facesSunny);
     unsigned int cubemapTextureStorm = loadCubemap(facesStorm);
 
-    // shader configuration
-    // --------------------
-    skyboxShader.use();
-    skyboxShader.setInt("skybox",0);
+    // shader configuration, again whenever a hot reload replaced a program
+    // ------------------------------------------------------------------------
+    // the light grid goes on units above any the models use for their own textures
+    const unsigned int clusterTextureUnit = 8;
+    auto configureShaders = [&]() {
+        skyboxShader.use();
+        skyboxShader.setInt("skybox",0);
+
+        blendingShader.use();
+        blendingShader.setInt("texture1", 0);
+
+        rainShader.use();
+        rainShader.setInt("texture1", 0);
+
+        parallaxShader.use();
+        parallaxShader.setInt("diffuseMap", 0);
+        parallaxShader.setInt("normalMap", 1);
+        parallaxShader.setInt("depthMap", 2);
+
+        for (Shader *lightShader : {&deferredDirectionalShader, &deferredPointShader}) {
+            lightShader->use();
+            lightShader->setInt("gPosition", 0);
+            lightShader->setInt("gNormal", 1);
+            lightShader->setInt("gAlbedoSpec", 2);
+        }
+        deferredPresentShader.use();
+        deferredPresentShader.setInt("lightBuffer", 0);
+        deferredPresentShader.setBool("fullscreen", true);
+        for (Shader *shader : {&postShader, &postSharpenShader, &postFxaaShader, &postSmaaShader}) {
+            shader->use();
+            shader->setInt("sceneColor", 0);
+            shader->setInt("bloom", 2);
+            shader->setBool("fullscreen", true);
+        }
+        postSmaaShader.setInt("smaaWeights", 1);
+        smaaEdgesShader.use();
+        smaaEdgesShader.setInt("sceneColor", 0);
+        smaaEdgesShader.setBool("fullscreen", true);
+        smaaWeightsShader.use();
+        smaaWeightsShader.setInt("edges", 0);
+        smaaWeightsShader.setBool("fullscreen", true);
+        for (Shader *shader : {&bloomPrefilterShader, &bloomDownsampleShader, &bloomUpsampleShader}) {
+            shader->use();
+            shader->setInt("source", 0);
+            shader->setBool("fullscreen", true);
+        }
 
-    blendingShader.use();
-    blendingShader.setInt("texture1", 0);
+        for (Shader *shader : {&clusteredShader, &clusteredInstancedShader, &parallaxClusteredShader}) {
+            shader->use();
+            shader->setInt("clusterLights", clusterTextureUnit);
+            shader->setInt("clusterGrid", clusterTextureUnit + 1);
+            shader->setInt("clusterIndices", clusterTextureUnit + 2);
+        }
+        parallaxClusteredShader.setInt("diffuseMap", 0);
+        parallaxClusteredShader.setInt("normalMap", 1);
+        parallaxClusteredShader.setInt("depthMap", 2);
+
+        // programs using the Lights block read it from the uniform buffer, see rg/Lights.h
+        for (Shader *shader : {&deferredDirectionalShader, &clusteredShader, &clusteredInstancedShader})
+            rg::checkLightsLayout(shader->ID, shader->sourcePaths().back());
+        for (rg::ShaderVariants *variants : {&modelShaders, &instancedShaders})
+            variants->forEach([](Shader &shader) { rg::checkLightsLayout(shader.ID, shader.sourcePaths().back()); });
+    };
+    configureShaders();
+
+    // interactive runs rebuild the programs whose source files are saved, while the scene keeps running
+    rg::ShaderReloader shaderReloader;
+    if (!scripted) {
+        shaderReloader.init(loadProc);
+        for (Shader *shader : {&skyboxShader, &blendingShader, &rainShader, &parallaxShader, &gbufferShader,
+                               &gbufferInstancedShader, &deferredDirectionalShader, &deferredPointShader,
+                               &deferredPresentShader, &postShader, &postSharpenShader, &postFxaaShader,
+                               &postSmaaShader, &smaaEdgesShader, &smaaWeightsShader, &bloomPrefilterShader,
+                               &bloomDownsampleShader, &bloomUpsampleShader,
+                               &clusteredShader, &clusteredInstancedShader, &parallaxClusteredShader})
+            shaderReloader.add(*shader);
+    }
+    for (rg::ShaderVariants *variants : {&modelShaders, &instancedShaders}) {
+        variants->onBuild([&shaderReloader, scripted](Shader &shader) {
+            rg::checkLightsLayout(shader.ID, shader.sourcePaths().back());
+            if (!scripted)
+                shaderReloader.add(shader);
+        });
+    }
+    rg::LightsBuffer lightsBuffer;
 
-    parallaxShader.use();
-    parallaxShader.setInt("diffuseMap", 0);
-    parallaxShader.setInt("normalMap", 1);
-    parallaxShader.setInt("depthMap", 2);
+    rg::DeferredRenderer deferredRenderer;
+    rg::ClusteredLighting clusteredLighting;
+    rg::ThreadPool threadPool;
+    std::vector<PointLight> sceneLights;
+    std::vector<rg::ClusterLight> clusterLights;
 
     //draw in wireframe
     //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
+    // every draw of a frame is submitted here and executed sorted by pass, program, material and depth
+    rg::RenderQueue renderQueue(1000.0f);
+
+    // command list mode: model draws are recorded into one list each by the thread pool while the queue
+    // is sorted, the queue then only replays them on the GL thread
+    std::deque<rg::CommandList> commandLists;
+    std::vector<std::function<void(rg::CommandList &)>> recordJobs;
+    rg::UniformLocationCache uniformLocations;
+    auto recordCommandList = [&commandLists, &recordJobs](std::function<void(rg::CommandList &)> job) {
+        if (recordJobs.size() == commandLists.size())
+            commandLists.emplace_back();
+        recordJobs.push_back(std::move(job));
+        return &commandLists[recordJobs.size() - 1];
+    };
+
+    const std::vector<unsigned int> allMeshes = {Model::AllMeshes};
+    auto submitModel = [&renderQueue, &modelShaders, &gbufferShader, &clusteredShader, &recordCommandList,
+                        &uniformLocations, &allMeshes](const char *name, Model &model, const glm::mat4 &modelMatrix) {
+        float depth = glm::distance(programState->camera.Position, glm::vec3(modelMatrix[3]));
+        glm::mat3 normalMatrix = rg::normalMatrix(modelMatrix);
+        bool deferred = programState->lightingMode == LightingMode::Deferred;
+        Shader *shader = deferred ? &gbufferShader : &clusteredShader;
+        // forward draws are split by material features, one queue item per shader variant; the deferred
+        // and clustered programs draw every mesh
+        bool variants = programState->lightingMode == LightingMode::Forward;
+        for (unsigned int features : variants ? model.featureSets : allMeshes) {
+            if (variants)
+                shader = &modelShaders.get(features);
+            std::function<void()> draw;
+            if (programState->recordCommandLists) {
+                rg::CommandList *list = recordCommandList([shader, &model, modelMatrix, normalMatrix,
+                                                           features](rg::CommandList &list) {
+                    list.setUniform(shader->ID, "model", modelMatrix);
+                    list.setUniform(shader->ID, "normalMatrix", normalMatrix);
+                    model.RecordVariant(list, *shader, features);
+                });
+                draw = [list, &uniformLocations]() {
+                    list->execute(uniformLocations);
+                };
+            } else {
+                draw = [shader, &model, modelMatrix, normalMatrix, features]() {
+                    shader->setMat4("model", modelMatrix);
+                    shader->setMat3("normalMatrix", normalMatrix);
+                    model.DrawVariant(*shader, features);
+                };
+            }
+            renderQueue.submit(deferred ? rg::RenderPass::Geometry : rg::RenderPass::Opaque, shader->ID,
+                               model.MaterialId(), depth, std::move(draw), name);
+        }
+    };
+
+    // textures, VAOs and programs were bound directly while loading, start the cache from scratch
+    rg::glState().invalidate();
+
+    // simulation thread: input, camera, airplane, rain and lightning. It builds the packet of frame
+    // N + 1 while the render thread draws frame N; the scene moves in fixed 60 Hz steps whatever the
+    // frame rate and every packet is interpolated between the last two steps
+    // ---------------------------------------------------------------------------------------------
+    SimulationPipeline pipeline;
+    std::thread simulationThread([&pipeline, &rain, &cameraScript, benchmark, scripted, fixedTimeStep,
+                                  frameCount = options.frames, camera = programState->camera]() mutable {
+        rg::FixedTimestep simulation(fixedTimeStep);
+        SimulationRequest request;
+        while (pipeline.waitRequest(request)) {
+            PROFILE_CPU_SCOPE("simulation");
+            float currentFrame = scripted ? request.frame * fixedTimeStep : (float) request.time;
+            if (request.frame == 0)
+                lastFrame = currentFrame;
+            deltaTime = currentFrame - lastFrame;
+            lastFrame = currentFrame;
+
+            // input
+            // -----
+            for (const std::string &event : request.events)
+                triggerSceneEvent(event);
+            if (benchmark) {
+                glm::vec3 cameraPosition, cameraTarget;
+                cameraScript.sample(currentFrame, cameraPosition, cameraTarget);
+                camera.Position = cameraPosition;
+                camera.LookAt(cameraTarget);
+                for (const rg::CameraScript::Event &event : cameraScript.eventsBetween(currentFrame - fixedTimeStep, currentFrame))
+                    triggerSceneEvent(event.name);
+            } else if (scripted) {
+                applyScriptedCamera(camera, (int) request.frame, frameCount);
+            } else {
+                camera.MovementSpeed = request.movementSpeed;
+                moveCamera(camera, request.movementKeys, deltaTime);
+                if (request.mouseOffset.x != 0.0f || request.mouseOffset.y != 0.0f)
+                    camera.ProcessMouseMovement(request.mouseOffset.x, request.mouseOffset.y);
+                if (request.scrollOffset != 0.0f)
+                    camera.ProcessMouseScroll(request.scrollOffset);
+            }
+
+            // scripted runs take exactly one step per frame so they stay reproducible
+            int steps = simulation.advance(scripted ? fixedTimeStep : deltaTime);
+            for (int step = 0; step < steps; step++)
+                simulate((float) simulation.step(), rain);
+            float alpha = simulation.alpha();
+
+            FramePacket &packet = pipeline.packet();
+            packet.frame = request.frame;
+            packet.camera = camera;
+            packet.airplanePose = airplanePose(simulation.renderTime(), alpha);
+            packet.planeCrash = planeCrash;
+            packet.rainy = rainy;
+            packet.sunny = sunny;
+            packet.storm = storm;
+            packet.lampOn = lampOn;
+            packet.houseLampOn = houseLampOn;
+            packet.lightning = storm && lightningFrameDuration == 0;
+            packet.lightningModel = lightningModel;
+            // the drops are drawn where they were between the last two steps
+            if (rainy || storm)
+                rain.buildModels(packet.rainModels, rainy ? 1.5f : 2.0f, (1.0f - alpha) * rainSpeed * fixedTimeStep);
+            else
+                packet.rainModels.clear();
+            pipeline.publish();
+        }
+    });
+
     // render loop
     // -----------
-    while (!glfwWindowShouldClose(window)) {
+    std::uint64_t packetIndex = 0;
+    pendingInput.time = window && !scripted ? glfwGetTime() : 0.0;
+    pipeline.request(pendingInput);
+    while (!(window && glfwWindowShouldClose(window)) && (!scripted || frameIndex < options.frames)) {
         // per-frame time logic
         // --------------------
         //randomLightningSpawn = rand()%15;
-        float currentFrame = glfwGetTime();
-        deltaTime = currentFrame - lastFrame;
-        lastFrame = currentFrame;
+        auto frameStart = std::chrono::steady_clock::now();
+        rg::profiler().beginFrame();
+        if (window && programState->swapMode != appliedSwapMode) {
+            appliedSwapMode = programState->swapMode;
+            applySwapMode(appliedSwapMode);
+        }
+
+        if (shaderReloader.update()) {
+            configureShaders();
+            uniformLocations.clear();
+        }
+
+        // take this frame's packet and let the simulation start on the next one right away
+        // ----------------------------------------------------------------------------------
+        const FramePacket *packet;
+        {
+            PROFILE_CPU_SCOPE("wait for simulation");
+            packet = pipeline.waitPacket();
+        }
+        if (window)
+            pendingInput.movementKeys = processInput(window);
+        pendingInput.frame = ++packetIndex;
+        pendingInput.time = window && !scripted ? glfwGetTime() : 0.0;
+        pendingInput.movementSpeed = programState->camera.MovementSpeed;
+        pipeline.request(pendingInput);
+        pendingInput.mouseOffset = glm::vec2(0.0f);
+        pendingInput.scrollOffset = 0.0f;
+        pendingInput.events.clear();
+
+        // the camera settings edited in ImGui stay with the render thread
+        float movementSpeed = programState->camera.MovementSpeed;
+        programState->camera = packet->camera;
+        programState->camera.MovementSpeed = movementSpeed;
+
+        if (dynamicResolutionStale) {
+            dynamicResolution.reset();
+            dynamicResolutionStale = false;
+        }
+        // the GPU time read back is a few frames old, the controller allows for that
+        if (gpuFrameTimer.begin()) {
+            antiAliasingTimes.collected(gpuFrameTimer.latest());
+            if (programState->dynamicResolution)
+                programState->renderScale = dynamicResolution.update(programState->renderScale, gpuFrameTimer.latest(),
+                                                                     programState->targetFrameTime);
+        }
+        AntiAliasingMode antiAliasing = programState->antiAliasing;
+        antiAliasingTimes.pending.push_back(antiAliasing);
 
-        // input
-        // -----
-        processInput(window);
+        // the scene goes into its own target at the render scale's size, the post pass copies it out
+        // -------------------------------------------------------------------------------------------
+        renderWidth = rg::DynamicResolution::scaledSize(framebufferWidth, programState->renderScale);
+        renderHeight = rg::DynamicResolution::scaledSize(framebufferHeight, programState->renderScale);
+        bool upscale = renderWidth < framebufferWidth || renderHeight < framebufferHeight;
+        sceneTarget.resize(renderWidth, renderHeight, antiAliasing == AntiAliasingMode::MSAA ? 4 : 1);
+        unsigned int sceneFramebuffer = sceneTarget.framebuffer();
 
         // render
         // ------
+        glBindFramebuffer(GL_FRAMEBUFFER, sceneFramebuffer);
+        glViewport(0, 0, renderWidth, renderHeight);
         glClearColor(programState->clearColor.r, programState->clearColor.g, programState->clearColor.b, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        // don't forget to enable shader before setting uniforms
-        ourShader.use();
-
         // Point light
         // -----------
         //outdoor
-        if (lampOn) {
-            pointLight.ambient = glm::vec3(8.0, 8.0, 8.0);
+        if (packet->lampOn) {
+            pointLight.ambient = glm::vec3(4.5, 4.5, 4.5);
         } else {
             pointLight.ambient = glm::vec3(0.0, 0.0, 0.0);
         }
 
-        ourShader.setVec3("pointLight.position", pointLight.position);
-        ourShader.setVec3("pointLight.ambient", pointLight.ambient);
-        ourShader.setVec3("pointLight.diffuse", pointLight.diffuse);
-        ourShader.setVec3("pointLight.specular", pointLight.specular);
-        ourShader.setFloat("pointLight.constant", pointLight.constant);
-        ourShader.setFloat("pointLight.linear", pointLight.linear);
-        ourShader.setFloat("pointLight.quadratic", pointLight.quadratic);
-        ourShader.setVec3("viewPosition", programState->camera.Position);
-        ourShader.setVec3("lightPos", pointLight.position);
-        ourShader.setFloat("material.shininess", 32.0f);
-
         // indoor
-        if (houseLampOn) {
-            pointLightHouse.ambient = glm::vec3(2.5f, 2.5f, 0.0f);
+        if (packet->houseLampOn) {
+            pointLightHouse.ambient = glm::vec3(0.52f, 0.52f, 0.0f);
         } else {
             pointLightHouse.ambient = glm::vec3(0.0, 0.0, 0.0);
         }
 
-        ourShader.setVec3("pointLightHouse.position", pointLightHouse.position);
-        ourShader.setVec3("pointLightHouse.ambient", pointLightHouse.ambient);
-        ourShader.setVec3("pointLightHouse.diffuse", pointLightHouse.diffuse);
-        ourShader.setVec3("pointLightHouse.specular", pointLightHouse.specular);
-        ourShader.setFloat("pointLightHouse.constant", pointLightHouse.constant);
-        ourShader.setFloat("pointLightHouse.linear", pointLightHouse.linear);
-        ourShader.setFloat("pointLightHouse.quadratic", pointLightHouse.quadratic);
-        ourShader.setVec3("viewPosition", programState->camera.Position);
-        ourShader.setVec3("lightPos", pointLightHouse.position);
-        ourShader.setFloat("material.shininess", 32.0f);
-
 
         // Directional light
-        if(rainy) {
+        if(packet->rainy) {
             dirLight.direction = glm::vec3(0.0f, -30.0f, -42.0f);
             dirLight.ambient = glm::vec3(0.25f);
             dirLight.diffuse = glm::vec3( 0.25f);
             dirLight.specular = glm::vec3(0.25f);
-        } else if(sunny) {
+        } else if(packet->sunny) {
             dirLight.direction = glm::vec3(0.0f, -30.0f, -42.0f);
             dirLight.ambient = glm::vec3(0.3f);
             dirLight.diffuse = glm::vec3( 0.3f);
             dirLight.specular = glm::vec3(0.3f);
         } else {
-            if(storm && lightningFrameDuration == 0) {
+            if(packet->lightning) {
                 dirLight.ambient = glm::vec3(0.1f);
             } else {
                 dirLight.ambient = glm::vec3(0.0f);
@@ -529,57 +963,21 @@ int main() {
             dirLight.diffuse = glm::vec3( 0.2f);
             dirLight.specular = glm::vec3(0.2f);
         }
-        ourShader.setVec3("dirLight.direction", dirLight.direction);
-        ourShader.setVec3("dirLight.ambient", dirLight.ambient);
-        ourShader.setVec3("dirLight.diffuse", dirLight.diffuse);
-        ourShader.setVec3("dirLight.specular", dirLight.specular);
 
         // view/projection transformations
         glm::mat4 projection = glm::perspective(glm::radians(programState->camera.Zoom),
-                                                (float) SCR_WIDTH / (float) SCR_HEIGHT, 0.1f, 1000.0f);
+                                                (float) framebufferWidth / (float) framebufferHeight, 0.1f, 1000.0f);
         glm::mat4 view = programState->camera.GetViewMatrix();
-        ourShader.setMat4("projection", projection);
-        ourShader.setMat4("view", view);
 
-        // render the loaded model
-        //------------------------
+        // queue the scene
+        //----------------
+        renderQueue.clear();
 
         // airplane
-        glm::mat4 airplaneModel = glm::mat4(1.0f);
-        airplaneModel = glm::translate(airplaneModel, programState->airplanePosition);
-
-        if (planeCrash == false) {
-            glm::vec3 rotationCenter = glm::vec3(30, 10, 10);
-            glm::mat4 translateToOrigin = glm::translate(glm::mat4(1.0f), -rotationCenter);
-            glm::mat4 rotationMatrix = glm::rotate(glm::mat4(1.0f), (float) currentFrame, glm::vec3(0.0f, 1.0f, 0.0f));
-            glm::mat4 translateBack = glm::translate(glm::mat4(1.0f), rotationCenter);
-            airplaneModel = translateBack * rotationMatrix * translateToOrigin;
-            airplaneModel = glm::scale(airplaneModel, glm::vec3(programState->airplaneScale));
-            currentAirplanePosition = glm::vec3(airplaneModel[3]);
-            currentAirplaneRotation = rotationMatrix;
-        } else {
-            // Airplane falling down
-            airplaneModel = glm::scale(airplaneModel, glm::vec3(programState->airplaneScale));
-            glm::mat4 rotationMatrix = glm::rotate(glm::mat4(1.0f), glm::radians(40.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-            airplaneModel *= rotationMatrix;
-            airplaneModel *= currentAirplaneRotation;
-            programState->airplanePosition = currentAirplanePosition;
-
-            if (currentAirplanePosition.y > airplaneHeight) {
-                if (currentAirplaneRotation[0][0] < 0 && currentAirplaneRotation[1][1] > 0) {
-                    // Drugi kvadrant
-                    glm::mat4 correctionRotation = glm::rotate(glm::mat4(1.0f), glm::radians(180.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-                    airplaneModel *= correctionRotation;
-                } else if (currentAirplaneRotation[0][0] < 0 && currentAirplaneRotation[1][1] < 0) {
-                    // Treći kvadrant
-                    glm::mat4 correctionRotation = glm::rotate(glm::mat4(1.0f), glm::radians(180.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-                    airplaneModel *= correctionRotation;
-                }
-                currentAirplanePosition += glm::vec3(0.4f, -0.6f, 0.06f);
-            }
-        }
-        ourShader.setMat4("model", airplaneModel);
-        airplane.Draw(ourShader);
+        glm::mat4 airplaneModel = glm::scale(packet->airplanePose, glm::vec3(programState->airplaneScale));
+        if (packet->planeCrash)
+            programState->airplanePosition = glm::vec3(packet->airplanePose[3]);
+        submitModel("airplane", airplane, airplaneModel);
 
         // boat
         glm::mat4 boatModel = glm::mat4(1.0f);
@@ -587,8 +985,7 @@ int main() {
                                    programState->boatPosition);
         boatModel = glm::scale(boatModel, glm::vec3(programState->boatScale));
         boatModel = glm::rotate(boatModel, glm::radians(-60.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-        ourShader.setMat4("model", boatModel);
-        boat.Draw(ourShader);
+        submitModel("boat", boat, boatModel);
 
         // island
         glm::mat4 islandModel = glm::mat4(1.0f);
@@ -596,8 +993,7 @@ int main() {
                                programState->islandPosition);
         islandModel = glm::scale(islandModel, glm::vec3(programState->islandScale));
         islandModel = glm::rotate(islandModel, glm::radians(0.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-        ourShader.setMat4("model", islandModel);
-        island.Draw(ourShader);
+        submitModel("island", island, islandModel);
 
         // lamp
         glm::mat4 lampModel = glm::mat4(1.0f);
@@ -605,8 +1001,7 @@ int main() {
                                      programState->lampPosition);
         lampModel = glm::scale(lampModel, glm::vec3(programState->lampScale));
         lampModel = glm::rotate(lampModel, glm::radians(0.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-        ourShader.setMat4("model", lampModel);
-        lamp.Draw(ourShader);
+        submitModel("lamp", lamp, lampModel);
 
         // table
         glm::mat4 tableModel = glm::mat4(1.0f);
@@ -614,25 +1009,42 @@ int main() {
                                    programState->tablePosition);
         tableModel = glm::scale(tableModel, glm::vec3(programState->tableScale));
         tableModel = glm::rotate(tableModel, glm::radians(74.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-        ourShader.setMat4("model", tableModel);
-        table.Draw(ourShader);
+        submitModel("table", table, tableModel);
 
-        // chairs
+        // chairs, every placement goes through one instanced draw
         glm::mat4 chairModel1 = glm::mat4(1.0f);
         chairModel1 = glm::translate(chairModel1,
                                     programState->chairPosition);
         chairModel1 = glm::scale(chairModel1, glm::vec3(programState->chairScale));
         chairModel1 = glm::rotate(chairModel1, glm::radians(74.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-        ourShader.setMat4("model", chairModel1);
-        chair.Draw(ourShader);
 
         glm::mat4 chairModel2 = glm::mat4(1.0f);
         chairModel2 = glm::translate(chairModel2,
                                      programState->chairPosition + glm::vec3(0.0f,0.0f,6.0f));
         chairModel2 = glm::scale(chairModel2, glm::vec3(programState->chairScale));
         chairModel2 = glm::rotate(chairModel2, glm::radians(74.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-        ourShader.setMat4("model", chairModel2);
-        chair.Draw(ourShader);
+
+        float chairDepth = glm::distance(programState->camera.Position, glm::vec3(chairModel1[3]));
+        bool deferred = programState->lightingMode == LightingMode::Deferred;
+        Shader *chairShader = deferred ? &gbufferInstancedShader : &clusteredInstancedShader;
+        bool chairVariants = programState->lightingMode == LightingMode::Forward;
+        for (unsigned int features : chairVariants ? chair.featureSets : allMeshes) {
+            if (chairVariants)
+                chairShader = &instancedShaders.get(features);
+            std::function<void()> drawChairs = [chairShader, &chair, features, chairModel1, chairModel2]() {
+                chair.DrawInstancedVariant(*chairShader, features, {chairModel1, chairModel2});
+            };
+            if (programState->recordCommandLists) {
+                rg::CommandList *list = recordCommandList([chairShader, &chair, features, chairModel1, chairModel2](rg::CommandList &list) {
+                    chair.RecordInstancedVariant(list, *chairShader, features, {chairModel1, chairModel2});
+                });
+                drawChairs = [list, &uniformLocations]() {
+                    list->execute(uniformLocations);
+                };
+            }
+            renderQueue.submit(deferred ? rg::RenderPass::Geometry : rg::RenderPass::Opaque,
+                               chairShader->ID, chair.MaterialId(), chairDepth, std::move(drawChairs), "chairs");
+        }
 
         // house lamp
         glm::mat4 houseLampModel = glm::mat4(1.0f);
@@ -641,165 +1053,731 @@ int main() {
         houseLampModel = glm::scale(houseLampModel, glm::vec3(programState->houseLampScale));
         houseLampModel = glm::rotate(houseLampModel, glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
         houseLampModel = glm::rotate(houseLampModel, glm::radians(-76.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-        ourShader.setMat4("model", houseLampModel);
-        houselamp.Draw(ourShader);
+        submitModel("house lamp", houselamp, houseLampModel);
 
         //apple
         glm::mat4 appleModel = glm::mat4(1.0f);
         appleModel = glm::translate(appleModel,
                                         programState->applePosition);
         appleModel = glm::scale(appleModel, glm::vec3(programState->appleScale));
-        ourShader.setMat4("model", appleModel);
-        apple.Draw(ourShader);
+        submitModel("apple", apple, appleModel);
 
         // House floor
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, diffuseMap);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, normalMap);
-        glActiveTexture(GL_TEXTURE2);
-        glBindTexture(GL_TEXTURE_2D, heightMap);
-
-        parallaxShader.use();
-
-        parallaxShader.setMat4("projection", projection);
-        parallaxShader.setMat4("view", view);
-        parallaxShader.setVec3("viewPos", programState->camera.Position);
-        parallaxShader.setVec3("lightPos", pointLight.position);
-        parallaxShader.setFloat("heightScale", heightScale);
-
         glm::mat4 quad = glm::mat4(1.0f);
         quad = glm::translate(quad, glm::vec3(-5.0f, -76.5f, 11.5f));
         quad = glm::rotate(quad, glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
         quad = glm::rotate(quad, glm::radians(-17.5f), glm::vec3(0.0f, 0.0f, 1.0f));
         quad = glm::scale(quad, glm::vec3(11.0f, 6.7f, 7.5f));
-        parallaxShader.setMat4("model", quad);
-        renderQuad();
+        float floorDepth = glm::distance(programState->camera.Position, glm::vec3(quad[3]));
+        Shader *floorShader = programState->lightingMode == LightingMode::Clustered ? &parallaxClusteredShader : &parallaxShader;
+        renderQueue.submit(rg::RenderPass::Opaque, floorShader->ID, diffuseMap, floorDepth,
+                           [floorShader, diffuseMap, normalMap, heightMap, quad]() {
+            rg::glState().bindTexture(GL_TEXTURE_2D, 0, diffuseMap);
+            rg::glState().bindTexture(GL_TEXTURE_2D, 1, normalMap);
+            rg::glState().bindTexture(GL_TEXTURE_2D, 2, heightMap);
+            floorShader->setMat4("model", quad);
+            renderQuad();
+        }, "parallax floor");
+
+        // rain, the packet stays valid until the next one is taken so the queue can read it directly
+        if(!packet->rainModels.empty()) {
+            // all drops in a single instanced draw, buffer is orphaned so the driver doesn't stall on last frame's data
+            const std::vector<glm::mat4> *rainModels = &packet->rainModels;
+            float rainDepth = glm::length(programState->camera.Position);
+            renderQueue.submit(rg::RenderPass::Transparent, rainShader.ID, rainTexture, rainDepth,
+                               [rainModels, rainInstanceVBO, rainVAO, rainTexture]() {
+                glBindBuffer(GL_ARRAY_BUFFER, rainInstanceVBO);
+                glBufferData(GL_ARRAY_BUFFER, rainModels->size() * sizeof(glm::mat4), NULL, GL_STREAM_DRAW);
+                glBufferSubData(GL_ARRAY_BUFFER, 0, rainModels->size() * sizeof(glm::mat4), rainModels->data());
+                rg::glState().bindVertexArray(rainVAO);
+                rg::glState().bindTexture(GL_TEXTURE_2D, 0, rainTexture);
+                glDrawArraysInstanced(GL_TRIANGLES, 0, 6, rainModels->size());
+            }, "rain");
+        }
 
+        // the Lights block every lit program shares, uploaded once instead of per program
+        lightsBuffer.update(programState->dirLight, pointLight, pointLightHouse);
+
+        // lights for the deferred and clustered paths
+        sceneLights.clear();
+        sceneLights.push_back(pointLight);
+        sceneLights.push_back(pointLightHouse);
+        updateCoastLights(programState);
+        sceneLights.insert(sceneLights.end(), programState->coastLights.begin(), programState->coastLights.end());
+
+        // lightning, visible for the simulation step it was spawned in
+        if(packet->lightning) {
+            glm::mat4 lightningM = packet->lightningModel;
+            float lightningDepth = glm::distance(programState->camera.Position, glm::vec3(lightningM[3]));
+            renderQueue.submit(rg::RenderPass::Transparent, blendingShader.ID, lightningTexture, lightningDepth,
+                               [&blendingShader, transparentVAO, lightningTexture, lightningM]() {
+                rg::glState().bindVertexArray(transparentVAO);
+                rg::glState().bindTexture(GL_TEXTURE_2D, 0, lightningTexture);
+                blendingShader.setMat4("model", lightningM);
+                glDrawArrays(GL_TRIANGLES, 0, 6);
+            }, "lightning");
+
+            // the flash lights up the island while the bolt is visible
+            PointLight flash;
+            flash.position = glm::vec3(lightningM[3]);
+            flash.ambient = glm::vec3(0.0f);
+            flash.diffuse = glm::vec3(4.0f, 4.0f, 5.0f);
+            flash.specular = glm::vec3(2.0f);
+            flash.constant = 1.0f;
+            flash.linear = 0.007f;
+            flash.quadratic = 0.0002f;
+            sceneLights.push_back(flash);
+        }
 
-        // rain
-        blendingShader.use();
-        glm::mat4 rainM = glm::mat4(1.0f);
-        blendingShader.setMat4("projection", projection);
-        blendingShader.setMat4("view", view);
-        glBindVertexArray(transparentVAO);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, rainTexture);
-        float rainSpeed = 0.1f; // Brzina pada kiše
-        if(rainy || storm) {
-            for (unsigned int i = 0; i < 30000; i++) {
-                // Ažuriranje pozicije kišnih kapljica
-                rainPositions[i].y -= rainSpeed;
-
-                // Provera da li je kapljica van granica ekrana
-                if (rainPositions[i].y < -50.0f) {
-                    // Ako je van granica, postavite je na vrh ekrana
-                    rainPositions[i].y = 50.0f;
-                }
+        // skybox
+        unsigned int cubemapTexture;
+        if(packet->rainy) {
+            cubemapTexture = cubemapTextureRainy;
+        } else if (packet->sunny){
+            cubemapTexture = cubemapTextureSunny;
+        } else {
+            cubemapTexture = cubemapTextureStorm;
+        }
+        renderQueue.submit(rg::RenderPass::Sky, skyboxShader.ID, cubemapTexture, 0.0f,
+                           [skyboxVAO, cubemapTexture]() {
+            rg::glState().depthFunc(GL_LEQUAL);  // change depth function so depth test passes when values are equal to depth buffer's content
+            rg::glState().bindVertexArray(skyboxVAO);
+            rg::glState().bindTexture(GL_TEXTURE_CUBE_MAP, 0, cubemapTexture);
+            glDrawArrays(GL_TRIANGLES, 0, 36);
+            rg::glState().depthFunc(GL_LESS); // set depth function back to default
+        }, "skybox");
+
+        // per-program state, uniforms stay with the program so the queue only has to bind it
+        // ------------------------------------------------------------------------------------
+        for (rg::ShaderVariants *variants : {&modelShaders, &instancedShaders}) {
+            variants->forEach([&projection, &view](Shader &shader) {
+                shader.use();
+                setLightingUniforms(shader, projection, view);
+            });
+        }
 
-                rainM = glm::mat4(1.0f);
-                if(rainy)
-                    rainM = glm::scale(rainM, glm::vec3(1.5f));
-                else
-                    rainM = glm::scale(rainM, glm::vec3(2.0f));
-                
-                rainM = glm::translate(rainM, rainPositions[i]);
-                rainM = glm::rotate(rainM ,glm::radians(rainRotation[i]), glm::vec3(0.0f ,1.0f, 0.0f));
-                blendingShader.setMat4("model", rainM);
-                glDrawArrays(GL_TRIANGLES, 0, 6);
+        for (Shader *shader : {&gbufferShader, &gbufferInstancedShader}) {
+            shader->use();
+            shader->setMat4("projection", projection);
+            shader->setMat4("view", view);
+        }
+
+        for (Shader *shader : {&parallaxShader, &parallaxClusteredShader}) {
+            shader->use();
+            shader->setMat4("projection", projection);
+            shader->setMat4("view", view);
+            shader->setVec3("viewPos", programState->camera.Position);
+            shader->setVec3("lightPos", pointLight.position);
+            shader->setFloat("heightScale", heightScale);
+            shader->setInt("parallaxMode", (int) programState->parallaxMode);
+        }
+
+        if (programState->lightingMode == LightingMode::Clustered) {
+            clusterLights.clear();
+            for (const PointLight &light : sceneLights) {
+                rg::ClusterLight clusterLight;
+                clusterLight.position = light.position;
+                clusterLight.radius = lightRadius(light);
+                clusterLight.ambient = light.ambient;
+                clusterLight.diffuse = light.diffuse;
+                clusterLight.specular = light.specular;
+                clusterLight.constant = light.constant;
+                clusterLight.linear = light.linear;
+                clusterLight.quadratic = light.quadratic;
+                if (clusterLight.radius > 0.0f)
+                    clusterLights.push_back(clusterLight);
+            }
+            clusteredLighting.update(clusterLights, view, projection, 0.1f, 1000.0f, threadPool);
+            clusteredLighting.bind(clusterTextureUnit);
+
+            for (Shader *shader : {&clusteredShader, &clusteredInstancedShader}) {
+                shader->use();
+                setLightingUniforms(*shader, projection, view);
+            }
+            for (Shader *shader : {&clusteredShader, &clusteredInstancedShader, &parallaxClusteredShader}) {
+                shader->use();
+                clusteredLighting.setUniforms(*shader, (float) renderWidth, (float) renderHeight);
             }
         }
-        glEnable(GL_CULL_FACE);
 
-        // lightning
+        rainShader.use();
+        rainShader.setMat4("projection", projection);
+        rainShader.setMat4("view", view);
+
         blendingShader.use();
-        glm::mat4 lightningM = glm::mat4(1.0f);
         blendingShader.setMat4("projection", projection);
         blendingShader.setMat4("view", view);
-        glBindVertexArray(transparentVAO);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, lightningTexture);
-        if(storm && lightningFrameDuration == 0) {
-            lightningM = glm::mat4(1.0f);
-            lightningM = glm::scale(lightningM, glm::vec3(200.0f, rand() % 200 + 600.0f, 200.0f));
-            float x = rand() % 6;
-            float z = rand() % 6;
-            lightningM = glm::translate(lightningM, glm::vec3(x-2.5 ,0.3f, z-2.5));
-            lightningM = glm::rotate(lightningM,glm::radians(90.0f), glm::vec3(0.0f ,1.0f, 0.0f));
-            blendingShader.setMat4("model", lightningM);
-            glDrawArrays(GL_TRIANGLES, 0, 6);
-        }
-        glEnable(GL_CULL_FACE);
 
-        randomLightningSpawn = 60 + rand() % 50;
-        lightningFrameDuration++;
-        if(lightningFrameDuration > randomLightningSpawn)
-            lightningFrameDuration = 0;
-
-        // draw skybox
-        glDepthFunc(GL_LEQUAL);  // change depth function so depth test passes when values are equal to depth buffer's content
         skyboxShader.use();
-        view = glm::mat4(glm::mat3(programState->camera.GetViewMatrix())); // remove translation from the view matrix
-        skyboxShader.setMat4("view", view);
+        skyboxShader.setMat4("view", glm::mat4(glm::mat3(view))); // remove translation from the view matrix
         skyboxShader.setMat4("projection", projection);
-        // skybox cube
-        glBindVertexArray(skyboxVAO);
-        glActiveTexture(GL_TEXTURE0);
-
-        if(rainy) {
-            glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTextureRainy);
-        } else if (sunny){
-            glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTextureSunny);
+
+        // the workers record the command lists, one more job sorts the queue meanwhile
+        if (!recordJobs.empty()) {
+            PROFILE_CPU_SCOPE("record command lists");
+            unsigned int jobCount = recordJobs.size();
+            threadPool.parallelFor(jobCount + 1, [&commandLists, &recordJobs, &renderQueue, jobCount](unsigned int index) {
+                if (index == jobCount) {
+                    renderQueue.sort();
+                    return;
+                }
+                commandLists[index].clear();
+                recordJobs[index](commandLists[index]);
+            });
+            recordJobs.clear();
+        }
+
+        // render
+        // ------
+        if (programState->lightingMode == LightingMode::Deferred) {
+            deferredRenderer.resize(renderWidth, renderHeight);
+
+            // geometry pass, an all-zero normal marks pixels no geometry was written to
+            {
+                PROFILE_SCOPE("geometry pass");
+                deferredRenderer.bindGeometryTarget();
+                glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                renderQueue.execute(rg::RenderPass::Geometry, rg::RenderPass::Geometry);
+            }
+
+            // lighting pass, then the forward-only draws on top, depth tested against the G-buffer depth
+            deferredRenderer.bindLightingTarget();
+            glClearColor(programState->clearColor.r, programState->clearColor.g, programState->clearColor.b, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+            renderDeferredLighting(deferredRenderer, deferredDirectionalShader, deferredPointShader,
+                                   sceneLights, projection, view);
+            renderQueue.execute(rg::RenderPass::Opaque, rg::RenderPass::Transparent);
+
+            // present, the scene target is multisampled with MSAA so it can't be a blit target
+            PROFILE_SCOPE("present");
+            glBindFramebuffer(GL_FRAMEBUFFER, sceneFramebuffer);
+            glViewport(0, 0, renderWidth, renderHeight);
+            rg::glState().disable(GL_DEPTH_TEST);
+            deferredPresentShader.use();
+            deferredPresentShader.setVec2("screenSize", (float) renderWidth, (float) renderHeight);
+            deferredRenderer.bindLightTexture(0);
+            deferredRenderer.drawFullscreenQuad();
+            rg::glState().enable(GL_DEPTH_TEST);
         } else {
-            glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTextureStorm);
+            renderQueue.execute();
         }
 
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-        glBindVertexArray(0);
-        glDepthFunc(GL_LESS); // set depth function back to default
+        // post: resolve MSAA, blur the bloom on its half size and smaller chain, find SMAA's edges and
+        // blend weights at the scene's size, then one full size pass filters (FXAA, SMAA) or sharpens
+        // (upscaled) the scene, adds the bloom, tone maps and encodes it into the framebuffer; ImGui
+        // stays full size
+        {
+            PROFILE_SCOPE("post");
+            sceneTarget.resolve();
+            rg::glState().disable(GL_DEPTH_TEST);
+            bloomChain.resize(renderWidth, renderHeight);
+            if (programState->bloom)
+                renderBloom(deferredRenderer, bloomChain, sceneTarget, bloomPrefilterShader, bloomDownsampleShader,
+                            bloomUpsampleShader, programState->bloomThreshold);
+            else
+                bloomChain.clear();
+            if (antiAliasing == AntiAliasingMode::SMAA) {
+                smaaTargets.resize(renderWidth, renderHeight);
+                smaaTargets.bindEdgesTarget();
+                smaaEdgesShader.use();
+                smaaEdgesShader.setFloat("exposure", programState->exposure);
+                sceneTarget.bindColorTexture(0);
+                deferredRenderer.drawFullscreenQuad();
+                smaaTargets.bindWeightsTarget();
+                smaaWeightsShader.use();
+                smaaTargets.bindEdgesTexture(0);
+                deferredRenderer.drawFullscreenQuad();
+                smaaTargets.endPasses();
+                smaaTargets.bindWeightsTexture(1);
+            }
+            glBindFramebuffer(GL_FRAMEBUFFER, outputFramebuffer);
+            glViewport(0, 0, framebufferWidth, framebufferHeight);
+            Shader *post = &postShader;
+            if (antiAliasing == AntiAliasingMode::FXAA)
+                post = &postFxaaShader;
+            else if (antiAliasing == AntiAliasingMode::SMAA)
+                post = &postSmaaShader;
+            else if (upscale && programState->sharpness > 0.0f)
+                post = &postSharpenShader;
+            post->use();
+            post->setVec2("outputSize", (float) framebufferWidth, (float) framebufferHeight);
+            post->setFloat("sharpness", programState->sharpness);
+            post->setFloat("exposure", programState->exposure);
+            // level 0 holds the sum of the chain's levels
+            post->setFloat("bloomIntensity", programState->bloomIntensity / bloomChain.levels());
+            sceneTarget.bindColorTexture(0);
+            bloomChain.bindLevelTexture(0, 2);
+            deferredRenderer.drawFullscreenQuad();
+            rg::glState().enable(GL_DEPTH_TEST);
+        }
 
-        if (programState->ImGuiEnabled)
+        if (programState->ImGuiEnabled) {
+            PROFILE_SCOPE("ImGui");
             DrawImGui(programState);
+            // the ImGui backend changes program, VAO, textures and enable bits without the cache
+            rg::glState().invalidate();
+        }
+        rg::glState().endFrame();
+        rg::glStats().endFrame();
+        rg::profiler().endFrame();
+
+        gpuFrameTimer.end();
+        if (scripted) {
+            cpuTimes.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count());
+            frameIndex++;
+        }
 
-        // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
-        // -------------------------------------------------------------------------------
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        if (window) {
+            // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
+            // -------------------------------------------------------------------------------
+            glfwSwapBuffers(window);
+            // the limiter waits before polling, so the next frame starts with the freshest input
+            if (!scripted) {
+                frameLimiter.setTargetFps(programState->fpsLimit);
+                frameLimiter.wait();
+            }
+            glfwPollEvents();
+        }
+        if (scripted) {
+            // without a swap nothing paces the loop, wait for the GPU so each frame time covers its rendering
+            if (!window)
+                glFinish();
+            frameTimes.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count());
+        }
+        if (rg::startupTrace().recording()) {
+            // the first frame is out, everything recorded so far was startup
+            rg::startupTrace().finish();
+            if (!options.startupTrace.empty()) {
+                if (!rg::startupTrace().write(options.startupTrace))
+                    std::cout << "Failed to write startup trace to " << options.startupTrace << std::endl;
+                rg::startupTrace().printSummary(std::cout);
+                if (rg::programBinaryCache().enabled())
+                    std::cout << "program binary cache: " << rg::programBinaryCache().hits() << " hits, "
+                              << rg::programBinaryCache().misses() << " misses, "
+                              << rg::programBinaryCache().rejected() << " rejected" << std::endl;
+            }
+        }
     }
 
-    programState->SaveToFile("resources/program_state.txt");
+    pipeline.stop();
+    simulationThread.join();
+
+    if (scripted) {
+        gpuFrameTimer.finish();
+        printFrameStats(frameTimes);
+        if (benchmark && !writeBenchmarkReport(options, cpuTimes, gpuFrameTimer.times(), frameTimes))
+            std::cout << "Failed to write benchmark report to " << options.benchmarkOutput << std::endl;
+    }
+    rg::gpuMemory().report(std::cout);
+    if (options.headless) {
+        delete offscreenTarget;
+    } else {
+        if (!scripted)
+            programState->SaveToFile("resources/program_state.txt");
+        ImGui_ImplOpenGL3_Shutdown();
+        ImGui_ImplGlfw_Shutdown();
+    }
     delete programState;
-    ImGui_ImplOpenGL3_Shutdown();
-    ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
 
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
     glDeleteVertexArrays(1, &skyboxVAO);
     glDeleteVertexArrays(1, &skyboxVBO);
+    glDeleteVertexArrays(1, &rainVAO);
+    glDeleteBuffers(1, &rainInstanceVBO);
 
-    glfwTerminate();
+    if (window)
+        glfwTerminate();
     return 0;
 }
 
+bool parseLaunchOptions(int argc, char **argv, LaunchOptions &options) {
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--headless") == 0) {
+            options.headless = true;
+        } else if (std::strcmp(argv[i], "--frames") == 0 && hasValue) {
+            options.frames = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--width") == 0 && hasValue) {
+            options.width = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--height") == 0 && hasValue) {
+            options.height = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--benchmark") == 0 && hasValue) {
+            options.benchmarkScript = argv[++i];
+        } else if (std::strcmp(argv[i], "--output") == 0 && hasValue) {
+            options.benchmarkOutput = argv[++i];
+        } else if (std::strcmp(argv[i], "--seed") == 0 && hasValue) {
+            options.seed = std::strtoul(argv[++i], NULL, 10);
+        } else if (std::strcmp(argv[i], "--startup-trace") == 0 && hasValue) {
+            options.startupTrace = argv[++i];
+        } else if (std::strcmp(argv[i], "--vsync") == 0 && hasValue) {
+            const char *mode = argv[++i];
+            if (std::strcmp(mode, "on") == 0)
+                options.swapMode = rg::SwapMode::VSync;
+            else if (std::strcmp(mode, "adaptive") == 0)
+                options.swapMode = rg::SwapMode::Adaptive;
+            else if (std::strcmp(mode, "off") == 0)
+                options.swapMode = rg::SwapMode::Uncapped;
+            else
+                return false;
+        } else if (std::strcmp(argv[i], "--command-lists") == 0) {
+            options.commandLists = true;
+        } else if (std::strcmp(argv[i], "--fps-limit") == 0 && hasValue) {
+            options.fpsLimit = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--shader-cache") == 0 && hasValue) {
+            options.shaderCache = argv[++i];
+        } else if (std::strcmp(argv[i], "--no-shader-cache") == 0) {
+            options.shaderCache.clear();
+        } else if (std::strcmp(argv[i], "--render-scale") == 0 && hasValue) {
+            options.renderScale = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--dynamic-resolution") == 0 && hasValue) {
+            options.targetFrameTime = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--aa") == 0 && hasValue) {
+            const char *mode = argv[++i];
+            if (std::strcmp(mode, "none") == 0)
+                options.antiAliasing = AntiAliasingMode::None;
+            else if (std::strcmp(mode, "msaa") == 0)
+                options.antiAliasing = AntiAliasingMode::MSAA;
+            else if (std::strcmp(mode, "fxaa") == 0)
+                options.antiAliasing = AntiAliasingMode::FXAA;
+            else if (std::strcmp(mode, "smaa") == 0)
+                options.antiAliasing = AntiAliasingMode::SMAA;
+            else
+                return false;
+        } else if (std::strcmp(argv[i], "--exposure") == 0 && hasValue) {
+            options.exposure = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--no-bloom") == 0) {
+            options.bloom = false;
+        } else {
+            return false;
+        }
+    }
+    return options.frames >= 0 && options.width > 0 && options.height > 0 && options.fpsLimit >= 0
+           && options.renderScale >= minRenderScale && options.renderScale <= 1.0f && options.targetFrameTime >= 0.0f
+           && options.exposure > 0.0f;
+}
+
+// one slow orbit around the island over the whole run, looking at the house
+// -------------------------------------------------------------------------
+void applyScriptedCamera(Camera &camera, int frame, int frameCount) {
+    float angle = glm::radians(360.0f * frame / frameCount);
+    glm::vec3 target = programState->tablePosition;
+    camera.Position = target + glm::vec3(60.0f * cos(angle), 25.0f, 60.0f * sin(angle));
+    camera.LookAt(target);
+}
+
+// one fixed simulation step: everything that moves, so its speed doesn't depend on the frame rate
+// ------------------------------------------------------------------------------------------------
+void simulate(float dt, rg::Rain &rain) {
+    // Airplane falling down until it hits the sea
+    previousAirplanePosition = currentAirplanePosition;
+    if (planeCrash && currentAirplanePosition.y > airplaneHeight)
+        currentAirplanePosition += airplaneFallVelocity * dt;
+
+    if (rainy || storm)
+        rain.fall(rainSpeed * dt);
+
+    randomLightningSpawn = 60 + rand() % 50;
+    lightningFrameDuration++;
+    if (lightningFrameDuration > randomLightningSpawn)
+        lightningFrameDuration = 0;
+    if (storm && lightningFrameDuration == 0)
+        lightningModel = randomLightningBolt();
+}
+
+// the airplane's transform at the given time, without its scale. It orbits until the crash, then
+// falls, interpolated between the last two steps
+glm::mat4 airplanePose(double time, float alpha) {
+    if (planeCrash == false) {
+        glm::vec3 rotationCenter = glm::vec3(30, 10, 10);
+        glm::mat4 translateToOrigin = glm::translate(glm::mat4(1.0f), -rotationCenter);
+        glm::mat4 rotationMatrix = glm::rotate(glm::mat4(1.0f), (float) time, glm::vec3(0.0f, 1.0f, 0.0f));
+        glm::mat4 translateBack = glm::translate(glm::mat4(1.0f), rotationCenter);
+        glm::mat4 pose = translateBack * rotationMatrix * translateToOrigin;
+        currentAirplanePosition = glm::vec3(pose[3]);
+        previousAirplanePosition = currentAirplanePosition;
+        currentAirplaneRotation = rotationMatrix;
+        return pose;
+    }
+
+    // Airplane falling down
+    glm::mat4 pose = glm::translate(glm::mat4(1.0f), glm::mix(previousAirplanePosition, currentAirplanePosition, alpha));
+    pose *= glm::rotate(glm::mat4(1.0f), glm::radians(40.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+    pose *= currentAirplaneRotation;
+    if (currentAirplanePosition.y > airplaneHeight) {
+        if (currentAirplaneRotation[0][0] < 0 && currentAirplaneRotation[1][1] > 0) {
+            // Drugi kvadrant
+            pose *= glm::rotate(glm::mat4(1.0f), glm::radians(180.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+        } else if (currentAirplaneRotation[0][0] < 0 && currentAirplaneRotation[1][1] < 0) {
+            // Treći kvadrant
+            pose *= glm::rotate(glm::mat4(1.0f), glm::radians(180.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+        }
+    }
+    return pose;
+}
+
+glm::mat4 randomLightningBolt() {
+    glm::mat4 lightningM = glm::mat4(1.0f);
+    lightningM = glm::scale(lightningM, glm::vec3(200.0f, rand() % 200 + 600.0f, 200.0f));
+    float x = rand() % 6;
+    float z = rand() % 6;
+    lightningM = glm::translate(lightningM, glm::vec3(x-2.5 ,0.3f, z-2.5));
+    lightningM = glm::rotate(lightningM,glm::radians(90.0f), glm::vec3(0.0f ,1.0f, 0.0f));
+    return lightningM;
+}
+
+// adaptive vsync needs EXT_swap_control_tear, without it a negative interval is an error
+// -------------------------------------------------------------------------------------
+void applySwapMode(rg::SwapMode mode) {
+    int interval = 1;
+    if (mode == rg::SwapMode::Uncapped) {
+        interval = 0;
+    } else if (mode == rg::SwapMode::Adaptive) {
+        if (glfwExtensionSupported("WGL_EXT_swap_control_tear") || glfwExtensionSupported("GLX_EXT_swap_control_tear"))
+            interval = -1;
+        else
+            std::cout << "Adaptive vsync is not supported, using vsync" << std::endl;
+    }
+    glfwSwapInterval(interval);
+}
+
+// the scene toggles a benchmark script can fire, named after what the keys do
+// ---------------------------------------------------------------------------
+void triggerSceneEvent(const std::string &name) {
+    if (name == "weather")
+        cycleWeather();
+    else if (name == "crash")
+        planeCrash = !planeCrash;
+    else if (name == "lamp")
+        lampOn = !lampOn;
+    else if (name == "houselamp")
+        houseLampOn = !houseLampOn;
+    else
+        std::cout << "Unknown benchmark event: " << name << std::endl;
+}
+
+// sun -> rain -> storm -> sun
+// ---------------------------
+void cycleWeather() {
+    if (rainy) {
+        rainy = false;
+        storm = true;
+    } else if (sunny) {
+        sunny = false;
+        rainy = true;
+    } else {
+        storm = false;
+        sunny = true;
+    }
+}
+
+// timing summary of a headless or benchmark run
+// ---------------------------------------------
+void printFrameStats(const std::vector<double> &frameTimes) {
+    if (frameTimes.empty())
+        return;
+    double total = 0.0;
+    for (double time : frameTimes)
+        total += time;
+    double average = total / frameTimes.size();
+
+    std::cout << "frames:    " << frameTimes.size() << '\n'
+              << "total:     " << total / 1000.0 << " s\n"
+              << "average:   " << average << " ms (" << 1000.0 / average << " fps)\n"
+              << "p50:       " << rg::percentile(frameTimes, 50.0) << " ms\n"
+              << "p95:       " << rg::percentile(frameTimes, 95.0) << " ms\n"
+              << "p99:       " << rg::percentile(frameTimes, 99.0) << " ms\n"
+              << "max:       " << rg::percentile(frameTimes, 100.0) << " ms" << std::endl;
+}
+
+// JSON report of a benchmark run, one value per line so two runs can be diffed directly
+// --------------------------------------------------------------------------------------
+bool writeBenchmarkReport(const LaunchOptions &options, const std::vector<double> &cpuTimes,
+                          const std::vector<double> &gpuTimes, const std::vector<double> &frameTimes) {
+    std::ofstream out(options.benchmarkOutput);
+    if (!out)
+        return false;
+    const char *lightingModes[] = {"forward", "deferred", "clustered"};
+    const char *parallaxModes[] = {"offset", "occlusion"};
+    const char *antiAliasingModes[] = {"none", "msaa", "fxaa", "smaa"};
+    out << "{\n"
+        << "  \"script\": \"" << options.benchmarkScript << "\",\n"
+        << "  \"renderer\": \"" << glGetString(GL_RENDERER) << "\",\n"
+        << "  \"lighting\": \"" << lightingModes[(int) programState->lightingMode] << "\",\n"
+        << "  \"parallax\": \"" << parallaxModes[(int) programState->parallaxMode] << "\",\n"
+        << "  \"anti_aliasing\": \"" << antiAliasingModes[(int) programState->antiAliasing] << "\",\n"
+        << "  \"dynamic_resolution\": " << (programState->dynamicResolution ? "true" : "false") << ",\n"
+        << "  \"render_scale\": " << programState->renderScale << ",\n"
+        << "  \"exposure\": " << programState->exposure << ",\n"
+        << "  \"bloom\": " << (programState->bloom ? "true" : "false") << ",\n"
+        << "  \"seed\": " << options.seed << ",\n"
+        << "  \"width\": " << framebufferWidth << ",\n"
+        << "  \"height\": " << framebufferHeight << ",\n"
+        << "  \"frames\": " << frameTimes.size() << ",\n";
+    rg::writeTimingJson(out, "cpu_ms", cpuTimes, false);
+    rg::writeTimingJson(out, "gpu_ms", gpuTimes, false);
+    rg::writeTimingJson(out, "frame_ms", frameTimes, false);
+    rg::GLStats::writeJson(out, "gl_per_frame", rg::glStats().average(), true);
+    out << "}" << std::endl;
+    return (bool) out;
+}
+
+// uploads the camera and view/projection transformations to a lit model shader, the lights are in the Lights block
+// ---------------------------------------------------------------------------------------------------------------
+void setLightingUniforms(Shader &shader, const glm::mat4 &projection, const glm::mat4 &view) {
+    shader.setVec3("viewPosition", programState->camera.Position);
+    shader.setVec3("lightPos", programState->pointLightHouse.position);
+    shader.setFloat("material.shininess", 32.0f);
+
+    shader.setMat4("projection", projection);
+    shader.setMat4("view", view);
+}
+
+// accumulates every light of the frame into the deferred lighting target: the directional
+// light as a fullscreen pass, each point light as a sphere volume covering only the pixels it reaches
+// ----------------------------------------------------------------------------------------------------
+void renderDeferredLighting(rg::DeferredRenderer &deferredRenderer, Shader &directionalShader, Shader &pointShader,
+                            const std::vector<PointLight> &lights, const glm::mat4 &projection, const glm::mat4 &view) {
+    PROFILE_SCOPE("deferred lighting");
+    glm::vec2 screenSize((float) deferredRenderer.width(), (float) deferredRenderer.height());
+
+    deferredRenderer.bindGBufferTextures(0);
+    rg::glState().disable(GL_DEPTH_TEST);
+    rg::glState().enable(GL_BLEND);
+    rg::glState().blendFunc(GL_ONE, GL_ONE);
+
+    directionalShader.use();
+    directionalShader.setBool("fullscreen", true);
+    directionalShader.setVec2("screenSize", screenSize);
+    directionalShader.setVec3("viewPosition", programState->camera.Position);
+    directionalShader.setFloat("shininess", 32.0f);
+    deferredRenderer.drawFullscreenQuad();
+
+    // back faces only, so the volume still covers the screen when the camera is inside it
+    glCullFace(GL_FRONT);
+    pointShader.use();
+    pointShader.setBool("fullscreen", false);
+    pointShader.setVec2("screenSize", screenSize);
+    pointShader.setVec3("viewPosition", programState->camera.Position);
+    pointShader.setFloat("shininess", 32.0f);
+    glm::mat4 viewProjection = projection * view;
+    for (const PointLight &light : lights) {
+        float radius = lightRadius(light);
+        if (radius <= 0.0f)
+            continue;
+
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), light.position);
+        model = glm::scale(model, glm::vec3(radius));
+        pointShader.setMat4("mvp", viewProjection * model);
+        pointShader.setFloat("radius", radius);
+        pointShader.setVec3("pointLight.position", light.position);
+        pointShader.setVec3("pointLight.ambient", light.ambient);
+        pointShader.setVec3("pointLight.diffuse", light.diffuse);
+        pointShader.setVec3("pointLight.specular", light.specular);
+        pointShader.setFloat("pointLight.constant", light.constant);
+        pointShader.setFloat("pointLight.linear", light.linear);
+        pointShader.setFloat("pointLight.quadratic", light.quadratic);
+        deferredRenderer.drawSphere();
+    }
+    glCullFace(GL_BACK);
+
+    rg::glState().disable(GL_BLEND);
+    rg::glState().enable(GL_DEPTH_TEST);
+}
+
+// blurs what is brighter than the threshold down and back up the bloom chain, see rg/BloomChain.h;
+// level 0 ends up holding the bloom at half the scene's size
+// ------------------------------------------------------------------------------------------------
+void renderBloom(rg::DeferredRenderer &deferredRenderer, rg::BloomChain &bloomChain, rg::SceneTarget &sceneTarget,
+                 Shader &prefilterShader, Shader &downsampleShader, Shader &upsampleShader, float threshold) {
+    PROFILE_SCOPE("bloom");
+    prefilterShader.use();
+    prefilterShader.setFloat("threshold", threshold);
+    prefilterShader.setVec2("targetSize", (float) bloomChain.levelWidth(0), (float) bloomChain.levelHeight(0));
+    bloomChain.bindLevelTarget(0);
+    sceneTarget.bindColorTexture(0);
+    deferredRenderer.drawFullscreenQuad();
+
+    downsampleShader.use();
+    for (int level = 1; level < bloomChain.levels(); ++level) {
+        downsampleShader.setVec2("targetSize", (float) bloomChain.levelWidth(level), (float) bloomChain.levelHeight(level));
+        bloomChain.bindLevelTarget(level);
+        bloomChain.bindLevelTexture(level - 1, 0);
+        deferredRenderer.drawFullscreenQuad();
+    }
+
+    rg::glState().enable(GL_BLEND);
+    rg::glState().blendFunc(GL_ONE, GL_ONE);
+    upsampleShader.use();
+    for (int level = bloomChain.levels() - 1; level > 0; --level) {
+        upsampleShader.setVec2("targetSize", (float) bloomChain.levelWidth(level - 1), (float) bloomChain.levelHeight(level - 1));
+        bloomChain.bindLevelTarget(level - 1);
+        bloomChain.bindLevelTexture(level, 0);
+        deferredRenderer.drawFullscreenQuad();
+    }
+    rg::glState().disable(GL_BLEND);
+}
+
+// distance beyond which a point light's contribution is too small to see
+// ------------------------------------------------------------------------
+float lightRadius(const PointLight &light) {
+    glm::vec3 brightest = glm::max(light.ambient, glm::max(light.diffuse, light.specular));
+    float maxBrightness = std::max(brightest.r, std::max(brightest.g, brightest.b));
+    return rg::DeferredRenderer::lightVolumeRadius(light.constant, light.linear, light.quadratic, maxBrightness);
+}
+
+// street lamps spread evenly along the coast, regenerated when the count is changed in ImGui
+// -------------------------------------------------------------------------------------------
+void updateCoastLights(ProgramState *programState) {
+    std::vector<PointLight> &lights = programState->coastLights;
+    if ((int) lights.size() == programState->coastLightCount)
+        return;
+
+    lights.clear();
+    for (int i = 0; i < programState->coastLightCount; i++) {
+        float angle = glm::radians(360.0f * i / programState->coastLightCount);
+        PointLight light;
+        light.position = programState->islandPosition + glm::vec3(70.0f * cos(angle), 12.0f, 70.0f * sin(angle));
+        light.ambient = glm::vec3(0.05f, 0.04f, 0.02f);
+        light.diffuse = glm::vec3(2.0f, 1.6f, 1.0f);
+        light.specular = glm::vec3(1.0f, 0.9f, 0.7f);
+        light.constant = 1.0f;
+        light.linear = 0.09f;
+        light.quadratic = 0.032f;
+        lights.push_back(light);
+    }
+}
+
 // process all input: query GLFW whether relevant keys are pressed/released this frame and react accordingly
 // ---------------------------------------------------------------------------------------------------------
-void processInput(GLFWwindow *window) {
+unsigned int processInput(GLFWwindow *window) {
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
 
+    unsigned int movementKeys = 0;
     if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-        programState->camera.ProcessKeyboard(FORWARD, 0.20);
+        movementKeys |= 1u << FORWARD;
     if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-        programState->camera.ProcessKeyboard(BACKWARD, 0.20);
+        movementKeys |= 1u << BACKWARD;
     if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-        programState->camera.ProcessKeyboard(LEFT, 0.20);
+        movementKeys |= 1u << LEFT;
     if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-        programState->camera.ProcessKeyboard(RIGHT, 0.20);
+        movementKeys |= 1u << RIGHT;
     if (glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS)
-        programState->camera.ProcessKeyboard(DOWN, 0.20);
+        movementKeys |= 1u << DOWN;
     if (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS)
-        programState->camera.ProcessKeyboard(UP, 0.20);
+        movementKeys |= 1u << UP;
+    return movementKeys;
+}
+
+// simulation thread: applies the movement keys held when the frame was requested
+// -------------------------------------------------------------------------------
+void moveCamera(Camera &camera, unsigned int movementKeys, float dt) {
+    for (Camera_Movement direction : {FORWARD, BACKWARD, LEFT, RIGHT, UP, DOWN})
+        if (movementKeys & (1u << direction))
+            camera.ProcessKeyboard(direction, cameraKeySpeed * dt);
 }
 
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
@@ -808,6 +1786,16 @@ void framebuffer_size_callback(GLFWwindow *window, int width, int height) {
     // make sure the viewport matches the new window dimensions; note that width and
     // height will be significantly larger than specified on retina displays.
     glViewport(0, 0, width, height);
+    framebufferWidth = width;
+    framebufferHeight = height;
+    trackWindowFramebuffer(width, height);
+}
+
+// the window's buffers aren't GL objects, estimate them: the front and back color buffers
+// ----------------------------------------------------------------------------------------
+void trackWindowFramebuffer(int width, int height) {
+    std::uint64_t bytes = 2 * rg::GpuMemory::textureBytes(GL_RGBA8, width, height);
+    rg::gpuMemory().track(rg::GpuMemory::Kind::Surface, 0, "render targets", bytes, "window framebuffer");
 }
 
 // glfw: whenever the mouse moves, this callback is called
@@ -826,13 +1814,185 @@ void mouse_callback(GLFWwindow *window, double xpos, double ypos) {
     lastY = ypos;
 
     if (programState->CameraMouseMovementUpdateEnabled)
-        programState->camera.ProcessMouseMovement(xoffset, yoffset);
+        pendingInput.mouseOffset += glm::vec2(xoffset, yoffset);
 }
 
 // glfw: whenever the mouse scroll wheel scrolls, this callback is called
 // ----------------------------------------------------------------------
 void scroll_callback(GLFWwindow *window, double xoffset, double yoffset) {
-    programState->camera.ProcessMouseScroll(yoffset);
+    pendingInput.scrollOffset += yoffset;
+}
+
+// one lane of the flame graph: the events of one thread, nested scopes stacked downwards
+// ---------------------------------------------------------------------------------------
+void DrawFlameGraphLane(const std::vector<rg::ProfileEvent> &events, unsigned int thread,
+                        std::int64_t start, std::int64_t end) {
+    unsigned int rows = 0;
+    for (const rg::ProfileEvent &event : events)
+        if (event.thread == thread)
+            rows = std::max(rows, event.depth + 1);
+    if (rows == 0)
+        return;
+
+    ImGui::Text("%s", rg::Profiler::threadName(thread).c_str());
+    const float rowHeight = ImGui::GetTextLineHeightWithSpacing();
+    const float width = ImGui::GetContentRegionAvail().x;
+    ImVec2 origin = ImGui::GetCursorScreenPos();
+    ImGui::PushID(thread);
+    ImGui::InvisibleButton("lane", ImVec2(width, rows * rowHeight));
+    ImGui::PopID();
+
+    ImDrawList *drawList = ImGui::GetWindowDrawList();
+    double scale = width / (double) std::max<std::int64_t>(end - start, 1);
+    for (const rg::ProfileEvent &event : events) {
+        if (event.thread != thread)
+            continue;
+        ImVec2 min(origin.x + (float) ((event.start - start) * scale), origin.y + event.depth * rowHeight);
+        ImVec2 max(origin.x + (float) ((event.end - start) * scale), min.y + rowHeight - 1.0f);
+        max.x = std::max(max.x, min.x + 1.0f);
+        // same name, same color in every lane
+        float hue = (std::hash<std::string>()(event.name) % 360) / 360.0f;
+        drawList->AddRectFilled(min, max, ImColor::HSV(hue, 0.5f, 0.8f));
+        drawList->PushClipRect(min, max, true);
+        drawList->AddText(ImVec2(min.x + 2.0f, min.y), IM_COL32_BLACK, event.name);
+        drawList->PopClipRect();
+        if (ImGui::IsMouseHoveringRect(min, max))
+            ImGui::SetTooltip("%s: %.3f ms", event.name, (event.end - event.start) / 1.0e6);
+    }
+}
+
+void DrawProfilerWindow() {
+    rg::Profiler &profiler = rg::profiler();
+    ImGui::Begin("Profiler");
+    bool enabled = profiler.enabled();
+    if (ImGui::Checkbox("Record", &enabled))
+        profiler.setEnabled(enabled);
+    ImGui::SameLine();
+    static std::string exportStatus;
+    if (ImGui::Button("Export Chrome trace"))
+        exportStatus = profiler.exportChromeTrace("profile_trace.json") ? "wrote profile_trace.json" : "export failed";
+    ImGui::SameLine();
+    ImGui::TextUnformatted(exportStatus.c_str());
+
+    const rg::ProfileFrame &cpuFrame = profiler.lastCpuFrame();
+    const std::vector<rg::ProfileEvent> &gpuEvents = profiler.lastGpuFrame();
+    std::int64_t gpuStart = gpuEvents.empty() ? 0 : gpuEvents.front().start;
+    std::int64_t gpuEnd = gpuStart;
+    for (const rg::ProfileEvent &event : gpuEvents) {
+        gpuStart = std::min(gpuStart, event.start);
+        gpuEnd = std::max(gpuEnd, event.end);
+    }
+    ImGui::Text("CPU frame: %.3f ms   GPU work: %.3f ms   dropped events: %u",
+                (cpuFrame.cpuEnd - cpuFrame.cpuStart) / 1.0e6, (gpuEnd - gpuStart) / 1.0e6, profiler.droppedEvents());
+    ImGui::Separator();
+
+    unsigned int threads = profiler.threadCount();
+    for (unsigned int thread = 0; thread < threads; thread++)
+        DrawFlameGraphLane(cpuFrame.cpu, thread, cpuFrame.cpuStart, cpuFrame.cpuEnd);
+    DrawFlameGraphLane(gpuEvents, rg::Profiler::GpuThread, gpuStart, gpuEnd);
+    ImGui::End();
+}
+
+void DrawGpuMemoryWindow() {
+    const rg::GpuMemory &memory = rg::gpuMemory();
+    ImGui::Begin("GPU memory");
+    ImGui::Text("%.2f MB in %u allocations", rg::GpuMemory::megabytes(memory.total()),
+                (unsigned int) memory.allocationCount());
+
+    auto groupTable = [](const char *id, const char *column,
+                         const std::vector<std::pair<std::string, std::uint64_t>> &groups) {
+        if (ImGui::BeginTable(id, 2, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+            ImGui::TableSetupColumn(column);
+            ImGui::TableSetupColumn("MB", ImGuiTableColumnFlags_WidthFixed, 80.0f);
+            ImGui::TableHeadersRow();
+            for (const auto &group : groups) {
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(group.first.c_str());
+                ImGui::TableNextColumn();
+                ImGui::Text("%.2f", rg::GpuMemory::megabytes(group.second));
+            }
+            ImGui::EndTable();
+        }
+    };
+    if (ImGui::CollapsingHeader("By category", ImGuiTreeNodeFlags_DefaultOpen))
+        groupTable("categories", "Category", memory.byCategory());
+    if (ImGui::CollapsingHeader("By owner", ImGuiTreeNodeFlags_DefaultOpen))
+        groupTable("owners", "Owner", memory.byOwner());
+    if (ImGui::CollapsingHeader("Largest allocations")) {
+        if (ImGui::BeginTable("largest", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+            ImGui::TableSetupColumn("Resource");
+            ImGui::TableSetupColumn("Category");
+            ImGui::TableSetupColumn("Owner");
+            ImGui::TableSetupColumn("MB", ImGuiTableColumnFlags_WidthFixed, 80.0f);
+            ImGui::TableHeadersRow();
+            for (const rg::GpuMemory::Allocation *allocation : memory.largest(20)) {
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                if (allocation->label.empty())
+                    ImGui::Text("#%u", allocation->id);
+                else
+                    ImGui::TextUnformatted(allocation->label.c_str());
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(allocation->category.c_str());
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(allocation->owner.c_str());
+                ImGui::TableNextColumn();
+                ImGui::Text("%.2f", rg::GpuMemory::megabytes(allocation->bytes));
+            }
+            ImGui::EndTable();
+        }
+    }
+    ImGui::End();
+}
+
+// anti-aliasing mode with the measured GPU frame time of each mode and what its targets cost at the
+// current render size
+// ---------------------------------------------------------------------------------------------------
+void DrawAntiAliasingControls(ProgramState *programState) {
+    const char *modes[] = {"None", "MSAA 4x", "FXAA", "SMAA"};
+    int mode = (int) programState->antiAliasing;
+    if (ImGui::Combo("Anti-aliasing", &mode, modes, IM_ARRAYSIZE(modes)))
+        programState->antiAliasing = (AntiAliasingMode) mode;
+
+    const char *quality[] = {
+            "aliased edges",
+            "geometry edges only, not shading or alpha tested",
+            "all edges, softens texture detail",
+            "all edges, sharper than FXAA, no subpixel AA"
+    };
+    std::uint64_t color = rg::GpuMemory::textureBytes(rg::SceneTarget::ColorFormat, renderWidth, renderHeight);
+    std::uint64_t depth = rg::GpuMemory::textureBytes(GL_DEPTH24_STENCIL8, renderWidth, renderHeight);
+    std::uint64_t smaa = rg::GpuMemory::textureBytes(GL_RG8, renderWidth, renderHeight)
+                         + rg::GpuMemory::textureBytes(GL_RGBA8, renderWidth, renderHeight) + depth;
+    std::uint64_t targetBytes[] = {
+            color + depth,
+            5 * color + 4 * depth, // 4 samples and the resolved color
+            color + depth,
+            color + depth + smaa
+    };
+    if (ImGui::BeginTable("antiAliasingModes", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+        ImGui::TableSetupColumn("Mode", ImGuiTableColumnFlags_WidthFixed, 70.0f);
+        ImGui::TableSetupColumn("GPU ms", ImGuiTableColumnFlags_WidthFixed, 60.0f);
+        ImGui::TableSetupColumn("Targets MB", ImGuiTableColumnFlags_WidthFixed, 80.0f);
+        ImGui::TableSetupColumn("Quality");
+        ImGui::TableHeadersRow();
+        for (int i = 0; i < IM_ARRAYSIZE(modes); i++) {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(modes[i]);
+            ImGui::TableNextColumn();
+            if (antiAliasingTimes.samples[i] > 0)
+                ImGui::Text("%.2f", antiAliasingTimes.average[i]);
+            else
+                ImGui::TextUnformatted("-");
+            ImGui::TableNextColumn();
+            ImGui::Text("%.2f", rg::GpuMemory::megabytes(targetBytes[i]));
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(quality[i]);
+        }
+        ImGui::EndTable();
+    }
 }
 
 void DrawImGui(ProgramState *programState) {
@@ -862,6 +2022,65 @@ void DrawImGui(ProgramState *programState) {
         ImGui::End();
     }
 
+    {
+        ImGui::Begin("Renderer");
+        ImGui::Text("GL state calls issued: %u", rg::glState().issuedCallsLastFrame());
+        ImGui::Text("GL state calls filtered: %u", rg::glState().filteredCallsLastFrame());
+        const char *lightingModes[] = {"Forward", "Deferred", "Clustered forward"};
+        int lightingMode = (int) programState->lightingMode;
+        if (ImGui::Combo("Lighting (G)", &lightingMode, lightingModes, IM_ARRAYSIZE(lightingModes)))
+            programState->lightingMode = (LightingMode) lightingMode;
+        const char *parallaxModes[] = {"Offset", "Occlusion"};
+        int parallaxMode = (int) programState->parallaxMode;
+        if (ImGui::Combo("Parallax (X)", &parallaxMode, parallaxModes, IM_ARRAYSIZE(parallaxModes)))
+            programState->parallaxMode = (ParallaxMode) parallaxMode;
+        ImGui::SliderFloat("Height scale (Q/E)", &heightScale, 0.0f, 1.0f);
+        ImGui::SliderInt("Coast lights", &programState->coastLightCount, 0, 512);
+        ImGui::Checkbox("Record command lists on workers", &programState->recordCommandLists);
+        const char *swapModes[] = {"VSync", "Adaptive vsync", "Uncapped"};
+        int swapMode = (int) programState->swapMode;
+        if (ImGui::Combo("Swap", &swapMode, swapModes, IM_ARRAYSIZE(swapModes)))
+            programState->swapMode = (rg::SwapMode) swapMode;
+        ImGui::SliderInt("FPS limit (0: off)", &programState->fpsLimit, 0, 240);
+        if (ImGui::SliderFloat("Render scale", &programState->renderScale, minRenderScale, 1.0f))
+            dynamicResolutionStale = true;
+        if (ImGui::Checkbox("Dynamic resolution", &programState->dynamicResolution))
+            dynamicResolutionStale = true;
+        ImGui::SliderFloat("Target GPU frame time (ms)", &programState->targetFrameTime, 4.0f, 50.0f);
+        ImGui::SliderFloat("Upscale sharpness", &programState->sharpness, 0.0f, 1.0f);
+        ImGui::SliderFloat("Exposure", &programState->exposure, 0.1f, 4.0f);
+        ImGui::Checkbox("Bloom", &programState->bloom);
+        ImGui::SliderFloat("Bloom threshold", &programState->bloomThreshold, 0.0f, 4.0f);
+        ImGui::SliderFloat("Bloom intensity", &programState->bloomIntensity, 0.0f, 2.0f);
+        DrawAntiAliasingControls(programState);
+        ImGui::Text("%.1f FPS", ImGui::GetIO().Framerate);
+        ImGui::End();
+    }
+
+    DrawProfilerWindow();
+    DrawGpuMemoryWindow();
+
+    {
+        ImGui::Begin("Stats");
+        const rg::GLFrameStats &stats = rg::glStats().lastFrame();
+        ImGui::Text("Draw calls:        %llu", (unsigned long long) stats.drawCalls);
+        ImGui::Text("Triangles:         %llu", (unsigned long long) stats.triangles);
+        ImGui::Text("Uniform uploads:   %llu", (unsigned long long) stats.uniformUploads);
+        ImGui::Text("Uniform lookups:   %llu", (unsigned long long) stats.uniformLookups);
+        ImGui::Text("Texture binds:     %llu", (unsigned long long) stats.textureBinds);
+        ImGui::Text("Program switches:  %llu", (unsigned long long) stats.programSwitches);
+        ImGui::Text("Buffer uploads:    %.1f KB", stats.bufferBytes / 1024.0);
+        ImGui::Text("GL errors:         %llu", (unsigned long long) stats.errors);
+        if (ImGui::Button("Dump to gl_stats.json")) {
+            std::ofstream out("gl_stats.json");
+            out << "{\n";
+            rg::GLStats::writeJson(out, "last_frame", stats, false);
+            rg::GLStats::writeJson(out, "average", rg::glStats().average(), true);
+            out << "}" << std::endl;
+        }
+        ImGui::End();
+    }
+
     {
         ImGui::Begin("Camera info");
         const Camera& c = programState->camera;
@@ -897,29 +2116,25 @@ void key_callback(GLFWwindow *window, int key, int scancode, int action, int mod
             glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
     }
 
+    // scene toggles go to the simulation thread with the next request
     if (key == GLFW_KEY_R && action == GLFW_PRESS) {
-        if (rainy) {
-            rainy = false;
-            storm = true;
-        } else if (sunny) {
-            sunny = false;
-            rainy = true;
-        } else {
-            storm = false;
-            sunny = true;
-        }
+        pendingInput.events.push_back("weather");
+    }
+
+    if (key == GLFW_KEY_G && action == GLFW_PRESS) {
+        programState->lightingMode = (LightingMode) (((int) programState->lightingMode + 1) % 3);
     }
 
     if (key == GLFW_KEY_P && action == GLFW_PRESS) {
-        lampOn = !lampOn;
+        pendingInput.events.push_back("lamp");
     }
 
     if (key == GLFW_KEY_O && action == GLFW_PRESS) {
-        houseLampOn = !houseLampOn;
+        pendingInput.events.push_back("houselamp");
     }
 
     if (glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS){
-        planeCrash = !planeCrash;
+        pendingInput.events.push_back("crash");
     }
 
     if (key == GLFW_KEY_Q && action == GLFW_PRESS){
@@ -935,23 +2150,34 @@ void key_callback(GLFWwindow *window, int key, int scancode, int action, int mod
         else
             heightScale = 1.0f;
     }
+
+    if (key == GLFW_KEY_X && action == GLFW_PRESS) {
+        programState->parallaxMode = programState->parallaxMode == ParallaxMode::Offset ? ParallaxMode::Occlusion
+                                                                                          : ParallaxMode::Offset;
+    }
 }
 
 unsigned int loadCubemap(vector<std::string> faces)
 {
+    rg::StartupScope trace("cubemap", faces.empty() ? "" : faces[0].substr(0, faces[0].find_last_of('/')));
     unsigned int textureID;
     glGenTextures(1, &textureID);
     glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
 
     int width, height, nrChannels;
+    std::uint64_t cubemapBytes = 0;
     for (unsigned int i = 0; i < faces.size(); i++)
     {
-        unsigned char *data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
+        unsigned char *data = rg::loadImageTraced(faces[i], &width, &height, &nrChannels);
         if (data)
         {
+            rg::StartupScope upload("upload", faces[i]);
+            upload.arg("bytes", (std::uint64_t) width * height * nrChannels);
+            // sRGB colors, sampled as linear values like the lighting
             glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
-                         0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data
+                         0, GL_SRGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data
             );
+            cubemapBytes += rg::GpuMemory::textureBytes(GL_SRGB, width, height);
             stbi_image_free(data);
         }
         else
@@ -965,19 +2191,24 @@ unsigned int loadCubemap(vector<std::string> faces)
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    rg::gpuMemory().track(rg::GpuMemory::Kind::Texture, textureID, "cubemaps", cubemapBytes,
+                          faces.empty() ? "" : faces[0].substr(0, faces[0].find_last_of('/')));
 
     return textureID;
 }
 
 unsigned int loadTexture(char const * path, bool gammaCorrection)
 {
+    rg::StartupScope trace("texture", path);
     unsigned int textureID;
     glGenTextures(1, &textureID);
 
     int width, height, nrComponents;
-    unsigned char *data = stbi_load(path, &width, &height, &nrComponents, 0);
+    unsigned char *data = rg::loadImageTraced(path, &width, &height, &nrComponents);
     if (data)
     {
+        rg::StartupScope upload("upload", path);
+        upload.arg("bytes", (std::uint64_t) width * height * nrComponents);
         GLenum internalFormat;
         GLenum dataFormat;
         if (nrComponents == 1)
@@ -998,6 +2229,8 @@ unsigned int loadTexture(char const * path, bool gammaCorrection)
         glBindTexture(GL_TEXTURE_2D, textureID);
         glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, dataFormat, GL_UNSIGNED_BYTE, data);
         glGenerateMipmap(GL_TEXTURE_2D);
+        rg::gpuMemory().track(rg::GpuMemory::Kind::Texture, textureID, "textures",
+                              rg::GpuMemory::textureBytes(internalFormat, width, height, 0), path);
 
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
@@ -1077,34 +2310,30 @@ void renderQuad()
         bitangent2.z = f * (-deltaUV2.x * edge1.z + deltaUV1.x * edge2.z);
         bitangent2 = glm::normalize(bitangent2);
 
-        float quadVertices[] = {
-                // positions            // normal         // texcoords  // tangent                          // bitangent
-                pos1.x, pos1.y, pos1.z, nm.x, nm.y, nm.z, uv1.x, uv1.y, tangent1.x, tangent1.y, tangent1.z, bitangent1.x, bitangent1.y, bitangent1.z,
-                pos2.x, pos2.y, pos2.z, nm.x, nm.y, nm.z, uv2.x, uv2.y, tangent1.x, tangent1.y, tangent1.z, bitangent1.x, bitangent1.y, bitangent1.z,
-                pos3.x, pos3.y, pos3.z, nm.x, nm.y, nm.z, uv3.x, uv3.y, tangent1.x, tangent1.y, tangent1.z, bitangent1.x, bitangent1.y, bitangent1.z,
-
-                pos1.x, pos1.y, pos1.z, nm.x, nm.y, nm.z, uv1.x, uv1.y, tangent2.x, tangent2.y, tangent2.z, bitangent2.x, bitangent2.y, bitangent2.z,
-                pos3.x, pos3.y, pos3.z, nm.x, nm.y, nm.z, uv3.x, uv3.y, tangent2.x, tangent2.y, tangent2.z, bitangent2.x, bitangent2.y, bitangent2.z,
-                pos4.x, pos4.y, pos4.z, nm.x, nm.y, nm.z, uv4.x, uv4.y, tangent2.x, tangent2.y, tangent2.z, bitangent2.x, bitangent2.y, bitangent2.z
-        };
+        // the same vertex layout as Mesh, with the frame packed into a quaternion
+        Vertex quadVertices[6];
+        const glm::vec3 positions[6] = {pos1, pos2, pos3, pos1, pos3, pos4};
+        const glm::vec2 uvs[6] = {uv1, uv2, uv3, uv1, uv3, uv4};
+        for (int i = 0; i < 6; i++) {
+            quadVertices[i].Position = positions[i];
+            quadVertices[i].TexCoords = uvs[i];
+            rg::packTangentFrame(nm, i < 3 ? tangent1 : tangent2, i < 3 ? bitangent1 : bitangent2,
+                                 quadVertices[i].TangentFrame);
+        }
         // configure plane VAO
         glGenVertexArrays(1, &quadVAO);
         glGenBuffers(1, &quadVBO);
-        glBindVertexArray(quadVAO);
+        rg::glState().bindVertexArray(quadVAO);
         glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
         glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
+        rg::gpuMemory().track(rg::GpuMemory::Kind::Buffer, quadVBO, "scene geometry", sizeof(quadVertices), "parallax quad");
         glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 14 * sizeof(float), (void*)0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Position));
         glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 14 * sizeof(float), (void*)(3 * sizeof(float)));
+        glVertexAttribPointer(1, 4, GL_SHORT, GL_TRUE, sizeof(Vertex), (void*)offsetof(Vertex, TangentFrame));
         glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 14 * sizeof(float), (void*)(6 * sizeof(float)));
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 14 * sizeof(float), (void*)(8 * sizeof(float)));
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, 14 * sizeof(float), (void*)(11 * sizeof(float)));
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
     }
-    glBindVertexArray(quadVAO);
+    rg::glState().bindVertexArray(quadVAO);
     glDrawArrays(GL_TRIANGLES, 0, 6);
-    glBindVertexArray(0);
 }
\ No newline at end of file